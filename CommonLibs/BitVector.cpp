@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <sstream>
 #include <math.h>
+#include <string.h>
 
 using namespace std;
 
@@ -298,11 +299,31 @@ ostream& operator<<(ostream& os, const SoftVector& sv)
 
 
 
+/*
+	Whole bytes go eight bits at a time through a 64-bit word: the multiply
+	gathers the low bit of each char into the top byte MSB-first, and the
+	reverse spreads a byte back out to one 0/1 char per bit.
+	Both rely on little-endian byte order; other hosts use the field loops.
+*/
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define BIT_WORD_PACK
+#endif
+
+#define BIT_LANES	0x0101010101010101ULL
+
 void BitVector::pack(unsigned char* targ) const
 {
 	// Assumes MSB-first packing.
 	unsigned bytes = size()/8;
-	for (unsigned i=0; i<bytes; i++) {
+	unsigned i = 0;
+#ifdef BIT_WORD_PACK
+	for (; i<bytes; i++) {
+		uint64_t word;
+		memcpy(&word, mStart + i*8, 8);
+		targ[i] = ((word & BIT_LANES) * 0x8040201008040201ULL) >> 56;
+	}
+#endif
+	for (; i<bytes; i++) {
 		targ[i] = peekField(i*8,8);
 	}
 	unsigned whole = bytes*8;
@@ -316,7 +337,15 @@ void BitVector::unpack(const unsigned char* src)
 {
 	// Assumes MSB-first packing.
 	unsigned bytes = size()/8;
-	for (unsigned i=0; i<bytes; i++) {
+	unsigned i = 0;
+#ifdef BIT_WORD_PACK
+	for (; i<bytes; i++) {
+		uint64_t word = (src[i] * BIT_LANES) & 0x0102040810204080ULL;
+		word = ((word + 0x7f * BIT_LANES) >> 7) & BIT_LANES;
+		memcpy(mStart + i*8, &word, 8);
+	}
+#endif
+	for (; i<bytes; i++) {
 		fillField(i*8,src[i],8);
 	}
 	unsigned whole = bytes*8;
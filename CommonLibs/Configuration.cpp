@@ -72,15 +72,35 @@ static std::string replaceAll(const std::string input, const std::string search,
 }
 
 
-float ConfigurationRecord::floatNumber() const
-{
-	float val;
-	sscanf(mValue.c_str(),"%f",&val);
-	return val;
-}
+/**
+	Marks a reader of the published snapshot.
+	Writers only free replaced snapshots while no reader is active.
+*/
+class SnapshotReader {
+
+	private:
+
+	std::atomic<unsigned>& mReaders;
+
+	public:
+
+	SnapshotReader(std::atomic<unsigned>& wReaders)
+		:mReaders(wReaders)
+	{
+		mReaders.fetch_add(1);
+	}
+
+	~SnapshotReader()
+	{
+		mReaders.fetch_sub(1);
+	}
+};
 
 
 ConfigurationTable::ConfigurationTable(const char* filename, const char *wCmdName, ConfigurationKeyMap wSchema)
+	:mSnapshot(new ConfigurationSnapshot),
+	mReaders(0),
+	mWriting(false)
 {
 	gLogEarly(LOG_INFO, "opening configuration table from path %s", filename);
 	// Connect to the database.
@@ -152,6 +172,9 @@ ConfigurationTable::ConfigurationTable(const char* filename, const char *wCmdNam
 
 	// Init the cross checking callback to something predictable
 	mCrossCheck = NULL;
+
+	// Publish the initial contents.
+	publish(loadSnapshot());
 }
 
 string ConfigurationTable::getDefaultSQL(const std::string& program, const std::string& version)
@@ -283,7 +306,7 @@ string ConfigurationTable::getTeX(const std::string& program, const std::string&
 bool ConfigurationTable::defines(const string& key)
 {
 	try {
-		ScopedLock lock(mLock);
+		SnapshotReader reader(mReaders);
 		return lookup(key).defined();
 	} catch (ConfigurationTableKeyNotFound) {
 		debugLogEarly(LOG_ALERT, "configuration parameter %s not found", key.c_str());
@@ -536,43 +559,13 @@ ConfigurationKeyMap ConfigurationTable::getSimilarKeys(const std::string& snippe
 	return tmp;
 }
 
-const ConfigurationRecord& ConfigurationTable::lookup(const string& key)
+const ConfigurationRecord& ConfigurationTable::lookup(const string& key) const
 {
-	assert(mDB);
-	checkCacheAge();
-	// We assume the caller holds mLock.
-	// So it is OK to return a reference into the cache.
-
-	// Check the cache.
-	// This is cheap.
-	ConfigurationMap::const_iterator where = mCache.find(key);
-	if (where!=mCache.end()) {
-		if (where->second.defined()) return where->second;
-		throw ConfigurationTableKeyNotFound(key);
-	}
-
-	// Check the database.
-	// This is more expensive.
-	char *value = NULL;
-	sqlite3_single_lookup(mDB,"CONFIG",
-			"KEYSTRING",key.c_str(),"VALUESTRING",value);
-
-	// value found, cache the result
-	if (value) {
-		mCache[key] = ConfigurationRecord(value);
-	// key definition found, cache the default
-	} else if (keyDefinedInSchema(key)) {
-		mCache[key] = ConfigurationRecord(mSchema[key].getDefaultValue());
-	// total miss, cache the error
-	} else {
-		mCache[key] = ConfigurationRecord(false);
-		throw ConfigurationTableKeyNotFound(key);
-	}
-
-	free(value);
-
-	// Leave mLock locked.  The caller holds it still.
-	return mCache[key];
+	// We assume the caller holds a SnapshotReader,
+	// so the snapshot cannot be freed under the returned reference.
+	const ConfigurationRecord* rec = mSnapshot.load()->find(key);
+	if (!rec) throw ConfigurationTableKeyNotFound(key);
+	return *rec;
 }
 
 
@@ -591,9 +584,9 @@ bool ConfigurationTable::isStatic(const string& key)
 
 string ConfigurationTable::getStr(const string& key)
 {
-	// We need the lock because rec is a reference into the cache.
+	// We need the reader because rec is a reference into the snapshot.
 	try {
-		ScopedLock lock(mLock);
+		SnapshotReader reader(mReaders);
 		return lookup(key).value();
 	} catch (ConfigurationTableKeyNotFound) {
 		// Raise an alert and re-throw the exception.
@@ -617,9 +610,9 @@ bool ConfigurationTable::getBool(const string& key)
 
 long ConfigurationTable::getNum(const string& key)
 {
-	// We need the lock because rec is a reference into the cache.
+	// We need the reader because rec is a reference into the snapshot.
 	try {
-		ScopedLock lock(mLock);
+		SnapshotReader reader(mReaders);
 		return lookup(key).number();
 	} catch (ConfigurationTableKeyNotFound) {
 		// Raise an alert and re-throw the exception.
@@ -632,7 +625,7 @@ long ConfigurationTable::getNum(const string& key)
 float ConfigurationTable::getFloat(const string& key)
 {
 	try {
-		ScopedLock lock(mLock);
+		SnapshotReader reader(mReaders);
 		return lookup(key).floatNumber();
 	} catch (ConfigurationTableKeyNotFound) {
 		// Raise an alert and re-throw the exception.
@@ -646,7 +639,7 @@ std::vector<string> ConfigurationTable::getVectorOfStrings(const string& key)
 	// Look up the string.
 	char *line=NULL;
 	try {
-		ScopedLock lock(mLock);
+		SnapshotReader reader(mReaders);
 		const ConfigurationRecord& rec = lookup(key);
 		line = strdup(rec.value().c_str());
 	} catch (ConfigurationTableKeyNotFound) {
@@ -677,7 +670,7 @@ std::vector<unsigned> ConfigurationTable::getVector(const string& key)
 	// Look up the string.
 	char *line=NULL;
 	try {
-		ScopedLock lock(mLock);
+		SnapshotReader reader(mReaders);
 		const ConfigurationRecord& rec = lookup(key);
 		line = strdup(rec.value().c_str());
 	} catch (ConfigurationTableKeyNotFound) {
@@ -708,12 +701,17 @@ bool ConfigurationTable::remove(const string& key)
 	assert(mDB);
 
 	ScopedLock lock(mLock);
-	// Clear the cache entry and the database.
-	ConfigurationMap::iterator where = mCache.find(key);
-	if (where!=mCache.end()) mCache.erase(where);
 	// Really remove it.
 	string cmd = "DELETE FROM CONFIG WHERE KEYSTRING=='"+key+"'";
-	return sqlite3_command(mDB,cmd.c_str());
+	mWriting = true;
+	bool success = sqlite3_command(mDB,cmd.c_str());
+	mWriting = false;
+	// Fall back to the default, if any.
+	if (success) {
+		update(key,NULL);
+		logLevelCheck(key);
+	}
+	return success;
 }
 
 
@@ -771,9 +769,14 @@ bool ConfigurationTable::set(const string& key, const string& value)
 	assert(mDB);
 	ScopedLock lock(mLock);
 	string cmd = "INSERT OR REPLACE INTO CONFIG (KEYSTRING,VALUESTRING,OPTIONAL) VALUES (\"" + key + "\",\"" + value + "\",1)";
+	mWriting = true;
 	bool success = sqlite3_command(mDB,cmd.c_str());
-	// Cache the result.
-	if (success) mCache[key] = ConfigurationRecord(value);
+	mWriting = false;
+	// Publish the result.
+	if (success) {
+		update(key,value.c_str());
+		logLevelCheck(key);
+	}
 	return success;
 }
 
@@ -790,40 +793,92 @@ bool ConfigurationTable::set(const string& key)
 	assert(mDB);
 	ScopedLock lock(mLock);
 	string cmd = "INSERT OR REPLACE INTO CONFIG (KEYSTRING,VALUESTRING,OPTIONAL) VALUES (\"" + key + "\",NULL,1)";
+	mWriting = true;
 	bool success = sqlite3_command(mDB,cmd.c_str());
-	if (success) mCache[key] = ConfigurationRecord(true);
+	mWriting = false;
+	// A NULL value reads like a missing row, see loadSnapshot().
+	if (success) {
+		update(key,NULL);
+		logLevelCheck(key);
+	}
 	return success;
 }
 
 
-void ConfigurationTable::checkCacheAge()
+void ConfigurationTable::purge()
+{
+	ScopedLock lock(mLock);
+	// sqlite does not allow queries from inside its update hook.
+	if (mWriting) return;
+	publish(loadSnapshot());
+	// A purge usually follows an external change, so re-resolve log levels.
+	gLogLevelsChanged();
+}
+
+
+unsigned ConfigurationTable::version() const
 {
-	// mLock is set by caller 
-	static time_t timeOfLastPurge = 0;
-	time_t now = time(NULL);
-	// purge every 3 seconds
-	// purge period cannot be configuration parameter
-	if (now - timeOfLastPurge < 3) return;
-	timeOfLastPurge = now;
-	// this is purge() without the lock
-	ConfigurationMap::iterator mp = mCache.begin();
-	while (mp != mCache.end()) {
-		ConfigurationMap::iterator prev = mp;
+	return mSnapshot.load()->version();
+}
+
+
+ConfigurationSnapshot* ConfigurationTable::loadSnapshot()
+{
+	ConfigurationSnapshot *snap = new ConfigurationSnapshot;
+	snap->mRecords = getAllPairs();
+
+	// Rows with NULL values fall back to the default, like missing rows.
+	ConfigurationKeyMap::const_iterator kp;
+	for (kp = mSchema.begin(); kp != mSchema.end(); kp++) {
+		ConfigurationRecordMap::iterator where = snap->mRecords.find(kp->first);
+		if (where == snap->mRecords.end() || !where->second.defined())
+			snap->mRecords[kp->first] = ConfigurationRecord(kp->second.getDefaultValue());
+	}
+
+	ConfigurationRecordMap::iterator mp = snap->mRecords.begin();
+	while (mp != snap->mRecords.end()) {
+		ConfigurationRecordMap::iterator prev = mp;
 		mp++;
-		mCache.erase(prev);
+		if (!prev->second.defined()) snap->mRecords.erase(prev);
 	}
+
+	return snap;
 }
 
 
-void ConfigurationTable::purge()
+void ConfigurationTable::update(const string& key, const char* value)
 {
-	ScopedLock lock(mLock);
-	ConfigurationMap::iterator mp = mCache.begin();
-	while (mp != mCache.end()) {
-		ConfigurationMap::iterator prev = mp;
-		mp++;
-		mCache.erase(prev);
+	// mLock is set by caller
+	ConfigurationSnapshot *next = new ConfigurationSnapshot(*mSnapshot.load());
+	if (value) {
+		next->mRecords[key] = ConfigurationRecord(value);
+	} else if (keyDefinedInSchema(key)) {
+		next->mRecords[key] = ConfigurationRecord(mSchema[key].getDefaultValue());
+	} else {
+		next->mRecords.erase(key);
 	}
+	publish(next);
+}
+
+
+void ConfigurationTable::publish(ConfigurationSnapshot* next)
+{
+	// mLock is set by caller
+	next->mVersion = mSnapshot.load()->version() + 1;
+	mRetired.push_back(mSnapshot.exchange(next));
+
+	// Readers announce themselves before loading the pointer, so if none
+	// is active now, none can still hold a replaced snapshot.
+	if (mReaders.load() != 0) return;
+	for (unsigned i=0; i<mRetired.size(); i++) delete mRetired[i];
+	mRetired.clear();
+}
+
+
+void ConfigurationTable::logLevelCheck(const string& key)
+{
+	// Logging call sites cache their level, see LogLevelSlot.
+	if (key.compare(0,9,"Log.Level")==0) gLogLevelsChanged();
 }
 
 
@@ -42,6 +42,7 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <atomic>
 
 #include <Threads.h>
 #include <stdint.h>
@@ -75,23 +76,28 @@ class ConfigurationRecord {
 
 	std::string mValue;
 	long mNumber;
+	float mFloat;
 	bool mDefined;
 
 	public:
 
 	ConfigurationRecord(bool wDefined=true):
+		mNumber(0),
+		mFloat(0),
 		mDefined(wDefined)
 	{ }
 
 	ConfigurationRecord(const std::string& wValue):
 		mValue(wValue),
 		mNumber(strtol(wValue.c_str(),NULL,0)),
+		mFloat(strtof(wValue.c_str(),NULL)),
 		mDefined(true)
 	{ }
 
 	ConfigurationRecord(const char* wValue):
 		mValue(std::string(wValue)),
 		mNumber(strtol(wValue,NULL,0)),
+		mFloat(strtof(wValue,NULL)),
 		mDefined(true)
 	{ }
 
@@ -100,7 +106,7 @@ class ConfigurationRecord {
 	long number() const { return mNumber; }
 	bool defined() const { return mDefined; }
 
-	float floatNumber() const;
+	float floatNumber() const { return mFloat; }
 
 };
 
@@ -174,18 +180,56 @@ typedef std::map<HashString, ConfigurationRecord> ConfigurationMap;
 class ConfigurationKey;
 typedef std::map<std::string, ConfigurationKey> ConfigurationKeyMap;
 
+
+/**
+	An immutable copy of every defined value in a ConfigurationTable,
+	with schema defaults filled in for keys missing from the database.
+	A new snapshot is published for every change and never modified after.
+*/
+class ConfigurationSnapshot {
+
+	friend class ConfigurationTable;
+
+	private:
+
+	ConfigurationRecordMap mRecords;
+	unsigned mVersion;
+
+	public:
+
+	ConfigurationSnapshot(unsigned wVersion=0)
+		:mVersion(wVersion)
+	{ }
+
+	/** Return the record for key, or NULL if it has no defined value. */
+	const ConfigurationRecord* find(const std::string& key) const
+	{
+		ConfigurationRecordMap::const_iterator where = mRecords.find(key);
+		return where==mRecords.end() ? NULL : &where->second;
+	}
+
+	unsigned version() const { return mVersion; }
+	size_t size() const { return mRecords.size(); }
+};
+
+
 /**
 	A class for maintaining a configuration key-value table,
-	based on sqlite3 and a local map-based cache.
+	based on sqlite3 and a published snapshot of its contents.
 	Thread-safe, too.
+	Readers never lock or touch the database; writers serialize on mLock,
+	update sqlite and then swap in a new snapshot.
 */
 class ConfigurationTable {
 
 	private:
 
 	sqlite3* mDB;				///< database connection
-	ConfigurationMap mCache;	///< cache of recently access configuration values
-	mutable Mutex mLock;		///< control for multithreaded access to the cache
+	std::atomic<const ConfigurationSnapshot*> mSnapshot;	///< current values, read without locking
+	mutable std::atomic<unsigned> mReaders;	///< readers currently holding a snapshot pointer
+	std::vector<const ConfigurationSnapshot*> mRetired;	///< replaced snapshots not yet freed
+	bool mWriting;				///< a database write is in progress
+	mutable Mutex mLock;		///< control for multithreaded writers
 	std::vector<std::string> (*mCrossCheck)(const std::string&);	///< cross check callback pointer
 
 	public:
@@ -289,21 +333,37 @@ class ConfigurationTable {
 	/** Execute the application specific value cross checking logic. */
 	std::vector<std::string> crossCheck(const std::string& key);
 
-	/** purege cache if it exceeds a certain age */
-	void checkCacheAge();
-
-	/** Delete all records from the cache. */
+	/**
+		Reload the snapshot from the database and schema.
+		Called from inside a write of this table, it is a no-op,
+		since the write publishes its own snapshot when it completes.
+	*/
 	void purge();
 
+	/** Return the version of the current snapshot, bumped on every change. */
+	unsigned version() const;
+
 
 	private:
 
 	/**
-		Attempt to lookup a record, cache if needed.
+		Find a record in the current snapshot.
 		Throw ConfigurationTableKeyNotFound if not found.
-		Caller should hold mLock because the returned reference points into the cache.
+		Caller should hold a SnapshotReader because the returned reference points into the snapshot.
 	*/
-	const ConfigurationRecord& lookup(const std::string& key);
+	const ConfigurationRecord& lookup(const std::string& key) const;
+
+	/** Build a snapshot of the whole database plus schema defaults. */
+	ConfigurationSnapshot* loadSnapshot();
+
+	/** Publish a snapshot with key updated to value, or to its default if value is NULL. */
+	void update(const std::string& key, const char* value);
+
+	/** Swap in a new snapshot and free unreferenced old ones, caller holds mLock. */
+	void publish(ConfigurationSnapshot* next);
+
+	/** Invalidate cached logging levels if key is a logging level. */
+	void logLevelCheck(const std::string& key);
 
 };
 
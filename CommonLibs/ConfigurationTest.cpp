@@ -27,8 +27,10 @@
 
 
 #include "Configuration.h"
+#include "Threads.h"
 #include <iostream>
 #include <string>
+#include <time.h>
 
 using namespace std;
 
@@ -42,6 +44,69 @@ void purgeConfig(void*,int,char const*, char const*, sqlite3_int64)
 }
 
 
+static double timeNow()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const long sWrites = 20000;
+static volatile bool sReaderFail = false;
+
+/* Readers must only ever see values the writer published, in order. */
+static void *readerTask(void *)
+{
+	long last = 0;
+	while (last < sWrites - 1) {
+		long num = gConfig.getNum("snapkey");
+		std::string str = gConfig.getStr("snapkey");
+		if (num < last || num >= sWrites || strtol(str.c_str(),NULL,0) < num) {
+			sReaderFail = true;
+			break;
+		}
+		last = num;
+	}
+	return NULL;
+}
+
+static bool testSnapshotReaders()
+{
+	Thread readers[4];
+
+	gConfig.set("snapkey",0L);
+	unsigned version = gConfig.version();
+	for (int i=0; i<4; i++)
+		readers[i].start(readerTask, NULL);
+	for (long n=1; n<sWrites; n++)
+		gConfig.set("snapkey",n);
+	for (int i=0; i<4; i++)
+		readers[i].join();
+
+	bool pass = !sReaderFail && gConfig.version() - version == (unsigned) sWrites - 1;
+	cout << "snapshot readers " << (pass ? "PASS" : "FAIL") << endl;
+	return pass;
+}
+
+static void benchmark()
+{
+	const int reps = 1000000;
+	long sum = 0;
+
+	double t0 = timeNow();
+	for (int i=0; i<reps; i++)
+		sum += gConfig.getNum("numnumber");
+	double t1 = timeNow();
+	for (int i=0; i<reps; i++)
+		sum += gConfig.getFloat("fkey") > 0;
+	double t2 = timeNow();
+
+	cout << "getNum   " << (t1-t0) / reps * 1e9 << " ns" << endl;
+	cout << "getFloat " << (t2-t1) / reps * 1e9 << " ns" << endl;
+	if (sum == 0) cout << endl;
+}
+
+
 int main(int argc, char *argv[])
 {
 
@@ -105,6 +170,12 @@ int main(int argc, char *argv[])
 	} catch (ConfigurationTableKeyNotFound) {
 		cout << "ConfigurationTableKeyNotFound exception successfully caught." << endl;
 	}
+
+	gConfig.set("fkey","123.456");
+	bool pass = testSnapshotReaders();
+	benchmark();
+
+	return pass ? 0 : 1;
 }
 
 ConfigurationKeyMap getConfigurationKeys()
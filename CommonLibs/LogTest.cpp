@@ -26,6 +26,7 @@
 
 #include <iostream>
 #include <iterator>
+#include <time.h>
 
 #include "Logger.h"
 #include "Configuration.h"
@@ -41,6 +42,53 @@ void printAlarms()
     std::copy( alarms.begin(), alarms.end(), output );
 }
 
+static double timeNow()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool infoEnabled() { return IS_LOG_LEVEL(INFO); }
+
+// A level change must reach call sites that have already cached their level.
+bool testLevelChange()
+{
+	gConfig.set("Log.Level","NOTICE");
+	bool before = infoEnabled();
+	gConfig.set("Log.Level","INFO");
+	bool after = infoEnabled();
+	gConfig.set("Log.Level","NOTICE");
+	bool restored = infoEnabled();
+
+	bool pass = !before && after && !restored;
+	std::cout << "level change " << (pass ? "PASS" : "FAIL") << std::endl;
+	return pass;
+}
+
+// Cost of a suppressed and of an enabled (but not printed) log call.
+void benchmark()
+{
+	const int disabled = 10000000, enabled = 100000;
+
+	double start = timeNow();
+	for (int i = 0 ; i < disabled ; ++i) {
+		LOG(INFO) << i;
+	}
+	double elapsed = timeNow() - start;
+	std::cout << "disabled LOG: " << elapsed / disabled * 1e9 << " ns" << std::endl;
+
+	bool console = gLogToConsole;
+	gLogToConsole = false;
+	start = timeNow();
+	for (int i = 0 ; i < enabled ; ++i) {
+		LOG(NOTICE) << i;
+	}
+	elapsed = timeNow() - start;
+	gLogToConsole = console;
+	std::cout << "enabled LOG: " << elapsed / enabled * 1e9 << " ns" << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
 	gLogInit("LogTest","NOTICE",LOG_LOCAL7);
@@ -63,6 +111,11 @@ int main(int argc, char *argv[])
     }
     std::cout << "you should see ten lines with the numbers 10..19:" << std::endl;
     printAlarms();
+
+    bool pass = testLevelChange();
+    benchmark();
+
+    return pass ? 0 : 1;
 }
 
 
@@ -194,6 +194,42 @@ int gGetLoggingLevel(const char* filename)
 
 
 
+/**@ Call site logging level slots. */
+//@{
+static std::atomic<unsigned> sLogGeneration(0);
+static std::atomic<LogLevelSlot*> sLogSlots(NULL);
+//@}
+
+int gResolveLoggingLevel(LogLevelSlot &slot, const char* filename)
+{
+	// Called once per call site and configuration change, not on the fast path.
+	unsigned generation = sLogGeneration.load();
+	int level = getLoggingLevel(filename);
+
+	if (!slot.registered.exchange(true)) {
+		LogLevelSlot *head = sLogSlots.load();
+		do {
+			slot.next = head;
+		} while (!sLogSlots.compare_exchange_weak(head, &slot));
+	}
+
+	// If the configuration changed while resolving, the level may be stale
+	// and the invalidation may have missed this slot, so resolve again next time.
+	slot.level.store(level);
+	if (sLogGeneration.load() != generation)
+		slot.level.store(LogLevelSlot::UNRESOLVED);
+
+	return level;
+}
+
+void gLogLevelsChanged()
+{
+	sLogGeneration++;
+	for (LogLevelSlot *slot = sLogSlots.load(); slot; slot = slot->next)
+		slot->level.store(LogLevelSlot::UNRESOLVED);
+}
+
+
 // copies the alarm list and returns it. list supposed to be small.
 list<string> gGetLoggerAlarms()
 {
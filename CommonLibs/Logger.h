@@ -35,16 +35,54 @@
 #include <syslog.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <atomic>
 #include <sstream>
 #include <list>
 #include <map>
 #include <string>
 
+/**
+	Per call site cache of the logging level for the file of the call site.
+	A slot starts out unresolved and is resolved from the configuration on
+	first use, so that a disabled LOG() costs a relaxed atomic load and a
+	compare. Resolved slots are registered and reset by gLogLevelsChanged()
+	whenever the logging configuration changes.
+*/
+struct LogLevelSlot {
+	static const int UNRESOLVED = 0x7fffffff;
+
+	std::atomic<int> level;
+	std::atomic<bool> registered;
+	LogLevelSlot *next;
+
+	constexpr LogLevelSlot()
+		:level(UNRESOLVED), registered(false), next(NULL)
+	{ }
+};
+
+/** Resolve a call site slot from the configuration, see LogLevelSlot. */
+int gResolveLoggingLevel(LogLevelSlot &slot, const char *filename);
+
+/** Invalidate all call site slots after a logging configuration change. */
+void gLogLevelsChanged();
+
+static inline bool gLogLevelEnabled(LogLevelSlot &slot, const char *filename,
+				    int level)
+{
+	int current = slot.level.load(std::memory_order_relaxed);
+	if (current < level) return false;
+	if (current == LogLevelSlot::UNRESOLVED)
+		current = gResolveLoggingLevel(slot, filename);
+	return current >= level;
+}
+
 #define _LOG(level) \
 	Log(LOG_##level).get() << pthread_self() \
 	<< timestr() << " " __FILE__  ":"  << __LINE__ << ":" << __FUNCTION__ << ": "
 
-#define IS_LOG_LEVEL(wLevel) (gGetLoggingLevel(__FILE__)>=LOG_##wLevel)
+#define IS_LOG_LEVEL(wLevel) \
+	([]() -> bool { static LogLevelSlot sLogSlot; \
+		return gLogLevelEnabled(sLogSlot, __FILE__, LOG_##wLevel); }())
 
 #ifdef NDEBUG
 #define LOG(wLevel) \
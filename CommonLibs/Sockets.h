@@ -134,6 +134,9 @@ public:
 	/** Close the socket. */
 	void close();
 
+	/** Return the underlying file descriptor, e.g. for polling. */
+	int fd() const { return mSocketFD; }
+
 };
 
 
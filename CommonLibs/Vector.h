@@ -30,18 +30,119 @@
 #define VECTOR_H
 
 #include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <iostream>
 #include <assert.h>
+#include <new>
 // We cant use Logger.h in this file...
 extern int gVectorDebug;
 #define BVDEBUG(msg) if (gVectorDebug) {std::cout << msg;}
 
 
+/** Alignment of all Vector storage, enough for any SIMD load. */
+#define VECTOR_ALIGN	64
+
+
+/**
+	Source of Vector storage.
+	Every block returned must be aligned to VECTOR_ALIGN bytes.
+*/
+class VectorAllocator {
+
+	public:
+
+	virtual ~VectorAllocator() { }
+
+	/** Return a block of at least bytes, or NULL. */
+	virtual void *allocate(size_t bytes) = 0;
+
+	/** Release a block returned by allocate(). */
+	virtual void deallocate(void *ptr, size_t bytes) = 0;
+
+	/** The aligned heap, used unless a Vector is given another allocator. */
+	static VectorAllocator *heap();
+};
+
+
+/** Allocate each block from the heap. */
+class VectorHeapAllocator : public VectorAllocator {
+
+	public:
+
+	void *allocate(size_t bytes)
+	{
+		void *ptr;
+		if (posix_memalign(&ptr, VECTOR_ALIGN, bytes)) return NULL;
+		return ptr;
+	}
+
+	void deallocate(void *ptr, size_t) { free(ptr); }
+};
+
+
+inline VectorAllocator *VectorAllocator::heap()
+{
+	static VectorHeapAllocator sHeap;
+	return &sHeap;
+}
+
+
+/**
+	Allocate blocks from one fixed region by bumping a pointer.
+	Individual blocks are not freed, the whole arena is recycled by reset(),
+	so this suits scratch vectors with a bounded lifetime, such as the
+	temporaries of one burst. Requests that do not fit go to the heap.
+	Not thread-safe, use one arena per thread.
+*/
+class VectorArena : public VectorAllocator {
+
+	private:
+
+	char *mBase;		///< start of the region
+	size_t mSize;		///< size of the region in bytes
+	size_t mUsed;		///< bytes handed out since the last reset
+
+	public:
+
+	VectorArena(size_t wSize)
+		:mBase((char *) heap()->allocate(wSize)),mSize(mBase ? wSize : 0),mUsed(0)
+	{ }
+
+	~VectorArena() { heap()->deallocate(mBase, mSize); }
+
+	void *allocate(size_t bytes)
+	{
+		size_t used = (mUsed + bytes + VECTOR_ALIGN - 1) & ~((size_t) VECTOR_ALIGN - 1);
+		if (used > mSize) return heap()->allocate(bytes);
+		void *ptr = mBase + mUsed;
+		mUsed = used;
+		return ptr;
+	}
+
+	void deallocate(void *ptr, size_t bytes)
+	{
+		if (!owns(ptr)) heap()->deallocate(ptr, bytes);
+	}
+
+	/** Recycle the whole region. Vectors allocated from it must be gone or unused. */
+	void reset() { mUsed = 0; }
+
+	bool owns(const void *ptr) const { return ptr >= mBase && ptr < mBase + mSize; }
+	size_t used() const { return mUsed; }
+
+	private:
+
+	VectorArena(const VectorArena&);
+	void operator=(const VectorArena&);
+};
+
 
 /**
 	A simplified Vector template with aliases.
 	Unlike std::vector, this class does not support dynamic resizing.
 	Unlike std::vector, this class does support "aliases" and subvectors.
+	Storage comes from a VectorAllocator and is aligned to VECTOR_ALIGN bytes.
 */
 template <class T> class Vector {
 
@@ -60,6 +161,8 @@ template <class T> class Vector {
 	T* mData;		///< allocated data block, if any
 	T* mStart;		///< start of useful data
 	T* mEnd;		///< end of useful data + 1
+	size_t mCapacity;	///< number of elements in mData
+	VectorAllocator* mAllocator;	///< source of mData
 
 	public:
 
@@ -82,12 +185,23 @@ template <class T> class Vector {
 	/** Return size in bytes. */
 	size_t bytes() const { return size()*sizeof(T); }
 
-	/** Change the size of the Vector, discarding content. */
+	/**
+		Change the size of the Vector, discarding content.
+		Owned storage is reused if it is large enough.
+	*/
 	void resize(size_t newSize)
 	{
-		if (mData!=NULL) delete[] mData;
-		if (newSize==0) mData=NULL;
-		else mData = new T[newSize];
+		if (mData==NULL || newSize>mCapacity || newSize==0) {
+			release();
+			if (newSize) {
+				mData = (T*) mAllocator->allocate(newSize*sizeof(T));
+				assert(mData);
+				mCapacity = newSize;
+			}
+		} else {
+			destroy(mData,mCapacity);
+		}
+		for (size_t i=0; i<mCapacity; i++) new (mData+i) T;
 		mStart = mData;
 		mEnd = mStart + newSize;
 	}
@@ -116,29 +230,41 @@ template <class T> class Vector {
 	//@{
 
 	/** Build an empty Vector of a given size. */
-	Vector(size_t wSize=0):mData(NULL) { resize(wSize); }
+	Vector(size_t wSize=0)
+		:mData(NULL),mCapacity(0),mAllocator(VectorAllocator::heap())
+	{ resize(wSize); }
 
-	/** Build a Vector by moving another. */
+	/** Build an empty Vector of a given size with storage from an allocator. */
+	Vector(size_t wSize, VectorAllocator* wAllocator)
+		:mData(NULL),mCapacity(0),mAllocator(wAllocator)
+	{ resize(wSize); }
+
+	/** Build a Vector by moving another, which is left empty. Aliases stay aliases. */
 	Vector(Vector<T>&& other)
-		:mData(other.mData),mStart(other.mStart),mEnd(other.mEnd)
-	{ other.mData=NULL; }
+		:mData(other.mData),mStart(other.mStart),mEnd(other.mEnd),
+		mCapacity(other.mCapacity),mAllocator(other.mAllocator)
+	{ other.forget(); }
 
-	/** Build a Vector by copying another. */
-	Vector(const Vector<T>& other):mData(NULL) { clone(other); }
+	/** Build a Vector by copying another into storage from the heap. */
+	Vector(const Vector<T>& other)
+		:mData(NULL),mCapacity(0),mAllocator(VectorAllocator::heap())
+	{ clone(other); }
 
-	/** Build a Vector with explicit values. */
+	/** Build a Vector with explicit values, wData is NOT deleted upon destruction. */
 	Vector(T* wData, T* wStart, T* wEnd)
-		:mData(wData),mStart(wStart),mEnd(wEnd)
-	{ }
+		:mData(NULL),mStart(wStart),mEnd(wEnd),
+		mCapacity(0),mAllocator(VectorAllocator::heap())
+	{ assert(wData==NULL); }
 
 	/** Build a vector from an existing block, NOT to be deleted upon destruction. */
 	Vector(T* wStart, size_t span)
-		:mData(NULL),mStart(wStart),mEnd(wStart+span)
+		:mData(NULL),mStart(wStart),mEnd(wStart+span),
+		mCapacity(0),mAllocator(VectorAllocator::heap())
 	{ }
 
 	/** Build a Vector by concatenation. */
 	Vector(const Vector<T>& other1, const Vector<T>& other2)
-		:mData(NULL)
+		:mData(NULL),mCapacity(0),mAllocator(VectorAllocator::heap())
 	{
 		resize(other1.size()+other2.size());
 		memcpy(mStart, other1.mStart, other1.bytes());
@@ -148,28 +274,71 @@ template <class T> class Vector {
 	//@}
 
 	/** Destroy a Vector, deleting held memory. */
-	~Vector() { clear(); }
+	~Vector() { release(); }
 
 
 
 
 	//@{
 
-	/** Assign from another Vector, shifting ownership. */
-	void operator=(Vector<T>& other)
+	/** Assign from another Vector, taking its storage or alias. */
+	Vector<T>& operator=(Vector<T>&& other)
 	{
-		clear();
+		if (this==&other) return *this;
+		release();
 		mData=other.mData;
 		mStart=other.mStart;
 		mEnd=other.mEnd;
-		other.mData=NULL;
+		mCapacity=other.mCapacity;
+		mAllocator=other.mAllocator;
+		other.forget();
+		return *this;
 	}
 
-	/** Assign from another Vector, copying. */
-	void operator=(const Vector<T>& other) { clone(other); }
+	/** Assign from another Vector, copying into storage owned by this one. */
+	Vector<T>& operator=(const Vector<T>& other)
+	{
+		if (this!=&other) clone(other);
+		return *this;
+	}
 
 	//@}
 
+	/** The allocator that provides storage for this Vector. */
+	VectorAllocator* allocator() const { return mAllocator; }
+
+	/** Return true if the useful data starts on an align byte boundary. */
+	bool isAligned(size_t align=VECTOR_ALIGN) const { return ((uintptr_t) mStart % align)==0; }
+
+
+	protected:
+
+	/** Free owned storage and clear pointers. */
+	void release()
+	{
+		if (mData!=NULL) {
+			destroy(mData,mCapacity);
+			mAllocator->deallocate(mData,mCapacity*sizeof(T));
+		}
+		mData=mStart=mEnd=NULL;
+		mCapacity=0;
+	}
+
+	/** Drop storage without freeing it, after it moved elsewhere. */
+	void forget()
+	{
+		mData=mStart=mEnd=NULL;
+		mCapacity=0;
+	}
+
+	static void destroy(T* data, size_t count)
+	{
+		for (size_t i=0; i<count; i++) data[i].~T();
+	}
+
+
+	public:
+
 
 	//@{
 
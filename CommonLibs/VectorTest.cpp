@@ -27,6 +27,7 @@
 
 #include "Vector.h"
 #include <iostream>
+#include <utility>
 
 // We must have a gConfig now to include Vector.
 #include "Configuration.h"
@@ -63,5 +64,45 @@ int main(int argc, char *argv[])
 		cout << testD << endl;
 	}
 
-	return 0;
+	bool pass = true;
+
+	// Storage is aligned for SIMD.
+	for (int i=1; i<100; i++) {
+		TestVector testA(i);
+		if (!testA.isAligned()) pass = false;
+	}
+	cout << "aligned " << pass << endl;
+
+	// Copy assignment leaves the source intact, move assignment takes its storage.
+	{
+		TestVector testE(3);
+		testE = test1;
+		test1[0] = 100;
+		cout << testE << test1 << endl;
+		if (testE[0]!=0 || test1[0]!=100) pass = false;
+		test1[0] = 0;
+
+		const int *data = test2.begin();
+		testE = std::move(test2);
+		cout << testE << endl;
+		if (testE.begin()!=data || test2.size()!=0) pass = false;
+	}
+
+	// Arena storage is aligned, recycled and overflows to the heap.
+	{
+		VectorArena arena(1024);
+		const int *first;
+		for (int n=0; n<3; n++) {
+			TestVector testF(10,&arena);
+			TestVector testG(7,&arena);
+			TestVector testH(1000,&arena);
+			if (n==0) first = testF.begin();
+			if (testF.begin()!=first || !testG.isAligned()) pass = false;
+			if (!arena.owns(testG.begin()) || arena.owns(testH.begin())) pass = false;
+			arena.reset();
+		}
+	}
+
+	cout << "allocator " << (pass ? "PASS" : "FAIL") << endl;
+	return pass ? 0 : 1;
 }
@@ -0,0 +1,228 @@
+/*
+ * Incremental receive burst statistics
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <math.h>
+#include "BurstStats.h"
+
+/* Burst window and smoothing factor of the per-timeslot averages */
+#define SLOT_WINDOW		32
+#define SLOT_ALPHA		(1.0f / 16.0f)
+
+/* Histogram ranges: RSSI in 2 dB bins below full scale, TOA in 1 symbol bins */
+#define RSSI_HIST_MIN		0.0f
+#define RSSI_HIST_WIDTH		2.0f
+#define RSSI_HIST_BINS		60
+#define TOA_HIST_MIN		-8.0f
+#define TOA_HIST_WIDTH		1.0f
+#define TOA_HIST_BINS		80
+
+/* Detections needed before a timing window is trusted */
+#define TOA_WINDOW_MIN		8
+
+/* Counters have a single writer, so a plain load and store suffices */
+static inline void bump(std::atomic<unsigned> &counter)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + 1,
+		      std::memory_order_relaxed);
+}
+
+AvgStat::AvgStat(size_t window, float alpha)
+	: mWindow(window ? window : 1), mAlpha(alpha)
+{
+	reset();
+}
+
+void AvgStat::reset()
+{
+	mPos = 0;
+	mFill = 0;
+	mSum = 0.0;
+	mScale = 0.0;
+
+	mEwma.store(0.0f, std::memory_order_relaxed);
+	mEwmVar.store(0.0f, std::memory_order_relaxed);
+	mMean.store(0.0f, std::memory_order_relaxed);
+	mCount.store(0, std::memory_order_relaxed);
+}
+
+/*
+ * The windowed sum is updated by the difference between the new and the
+ * evicted value. It is recomputed once per window wrap, which bounds
+ * rounding drift and still averages out to O(1) per update.
+ */
+void AvgStat::update(float val)
+{
+	if (mFill < mWindow.size()) {
+		mFill++;
+		mScale = 1.0 / mFill;
+		mSum += val;
+	} else {
+		mSum += val - mWindow[mPos];
+	}
+
+	mWindow[mPos] = val;
+
+	if (++mPos == mWindow.size()) {
+		mPos = 0;
+		mSum = 0.0;
+		for (size_t i = 0; i < mFill; i++)
+			mSum += mWindow[i];
+	}
+
+	unsigned count = mCount.load(std::memory_order_relaxed);
+	float ewma = mEwma.load(std::memory_order_relaxed);
+	float var = mEwmVar.load(std::memory_order_relaxed);
+
+	if (!count) {
+		ewma = val;
+		var = 0.0f;
+	} else {
+		float diff = val - ewma;
+		ewma += mAlpha * diff;
+		var = (1.0f - mAlpha) * (var + mAlpha * diff * diff);
+	}
+
+	mEwma.store(ewma, std::memory_order_relaxed);
+	mEwmVar.store(var, std::memory_order_relaxed);
+	mMean.store(mSum * mScale, std::memory_order_relaxed);
+	mCount.store(count + 1, std::memory_order_relaxed);
+}
+
+HistStat::HistStat(float min, float width, size_t bins)
+	: mMin(min), mWidth(width), mBins(bins ? bins : 1)
+{
+	mCounts = new std::atomic<unsigned>[mBins];
+	reset();
+}
+
+HistStat::~HistStat()
+{
+	delete[] mCounts;
+}
+
+void HistStat::reset()
+{
+	for (size_t i = 0; i < mBins; i++)
+		mCounts[i].store(0, std::memory_order_relaxed);
+}
+
+void HistStat::update(float val)
+{
+	float pos = (val - mMin) / mWidth;
+	size_t bin;
+
+	if (!(pos > 0.0f))
+		bin = 0;
+	else if (pos >= mBins)
+		bin = mBins - 1;
+	else
+		bin = (size_t) pos;
+
+	bump(mCounts[bin]);
+}
+
+unsigned HistStat::count(size_t bin) const
+{
+	if (bin >= mBins)
+		return 0;
+
+	return mCounts[bin].load(std::memory_order_relaxed);
+}
+
+SlotStats::SlotStats()
+	: rssiAvg(SLOT_WINDOW, SLOT_ALPHA), toaAvg(SLOT_WINDOW, SLOT_ALPHA),
+	  rssiHist(RSSI_HIST_MIN, RSSI_HIST_WIDTH, RSSI_HIST_BINS),
+	  toaHist(TOA_HIST_MIN, TOA_HIST_WIDTH, TOA_HIST_BINS),
+	  mDetectRate(SLOT_WINDOW, SLOT_ALPHA)
+{
+	reset();
+}
+
+void SlotStats::reset()
+{
+	rssiAvg.reset();
+	toaAvg.reset();
+	rssiHist.reset();
+	toaHist.reset();
+	mDetectRate.reset();
+
+	mBursts.store(0, std::memory_order_relaxed);
+	mDetected.store(0, std::memory_order_relaxed);
+	mMissed.store(0, std::memory_order_relaxed);
+	mClipped.store(0, std::memory_order_relaxed);
+	mTrackHits.store(0, std::memory_order_relaxed);
+	mTrackMisses.store(0, std::memory_order_relaxed);
+}
+
+void SlotStats::rssi(float dB)
+{
+	bump(mBursts);
+	rssiAvg.update(dB);
+	rssiHist.update(dB);
+}
+
+void SlotStats::detected(float toa)
+{
+	bump(mDetected);
+	toaAvg.update(toa);
+	toaHist.update(toa);
+	mDetectRate.update(1.0f);
+}
+
+void SlotStats::missed()
+{
+	bump(mMissed);
+	mDetectRate.update(0.0f);
+}
+
+/* A clipped burst is not detected, so it also counts as a miss */
+void SlotStats::clipped()
+{
+	bump(mClipped);
+	missed();
+}
+
+/* Whether a search of the toaWindow() range found the burst */
+void SlotStats::tracked(bool hit)
+{
+	bump(hit ? mTrackHits : mTrackMisses);
+}
+
+/*
+ * Mean arrival time plus or minus k standard deviations, widened by one
+ * symbol to cover the resolution of the estimates
+ */
+bool SlotStats::toaWindow(float &lo, float &hi, float k) const
+{
+	if (toaAvg.count() < TOA_WINDOW_MIN)
+		return false;
+
+	float mean = toaAvg.ewma();
+	float dev = k * sqrtf(toaAvg.ewmVar()) + 1.0f;
+
+	lo = mean - dev;
+	hi = mean + dev;
+	return true;
+}
+
+ChanStats::ChanStats(size_t noiseWindow)
+	: noise(noiseWindow, 1.0f / noiseWindow)
+{
+}
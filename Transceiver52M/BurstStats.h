@@ -0,0 +1,127 @@
+/*
+ * Incremental receive burst statistics
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef _BURST_STATS_H_
+#define _BURST_STATS_H_
+
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+/*
+ * Every statistic has a single writer, the receive thread of its channel,
+ * so updates take no locks and cost O(1). Published values are atomics
+ * that other threads, such as the control interface, may read at any time.
+ */
+
+/* Exponential and windowed average of one quantity */
+class AvgStat {
+public:
+	AvgStat(size_t window, float alpha);
+
+	/* Writer side */
+	void update(float val);
+	void reset();
+
+	/* Reader side */
+	float ewma() const { return mEwma.load(std::memory_order_relaxed); }
+	float ewmVar() const { return mEwmVar.load(std::memory_order_relaxed); }
+	float mean() const { return mMean.load(std::memory_order_relaxed); }
+	unsigned count() const { return mCount.load(std::memory_order_relaxed); }
+
+private:
+	std::vector<float> mWindow;
+	size_t mPos, mFill;
+	double mSum, mScale;
+	float mAlpha;
+
+	std::atomic<float> mEwma, mEwmVar, mMean;
+	std::atomic<unsigned> mCount;
+};
+
+/* Fixed width histogram, values outside the range land in the end bins */
+class HistStat {
+public:
+	HistStat(float min, float width, size_t bins);
+	~HistStat();
+
+	void update(float val);
+	void reset();
+
+	size_t bins() const { return mBins; }
+	float binStart(size_t bin) const { return mMin + bin * mWidth; }
+	unsigned count(size_t bin) const;
+
+private:
+	float mMin, mWidth;
+	size_t mBins;
+	std::atomic<unsigned> *mCounts;
+};
+
+/* Statistics of one channel timeslot */
+class SlotStats {
+public:
+	SlotStats();
+
+	/* Writer side, one call per processed burst */
+	void rssi(float dB);		/* level below full scale */
+	void detected(float toa);
+	void missed();
+	void clipped();
+	void tracked(bool hit);		/* tracked timing window search */
+	void reset();
+
+	/* Reader side */
+	unsigned bursts() const { return mBursts.load(std::memory_order_relaxed); }
+	unsigned detections() const { return mDetected.load(std::memory_order_relaxed); }
+	unsigned misses() const { return mMissed.load(std::memory_order_relaxed); }
+	unsigned clips() const { return mClipped.load(std::memory_order_relaxed); }
+	unsigned trackHits() const { return mTrackHits.load(std::memory_order_relaxed); }
+	unsigned trackMisses() const { return mTrackMisses.load(std::memory_order_relaxed); }
+
+	/* Detection rate over recent bursts, 0 to 1 */
+	float detectRate() const { return mDetectRate.ewma(); }
+
+	/** Expected time-of-arrival range of the next burst in symbols
+	    @param k width of the range in standard deviations
+	    @return false if there are not enough detections to tell
+	*/
+	bool toaWindow(float &lo, float &hi, float k = 3.0f) const;
+
+	AvgStat rssiAvg, toaAvg;
+	HistStat rssiHist, toaHist;
+
+private:
+	AvgStat mDetectRate;
+	std::atomic<unsigned> mBursts, mDetected, mMissed, mClipped;
+	std::atomic<unsigned> mTrackHits, mTrackMisses;
+};
+
+/* Statistics of one channel */
+class ChanStats {
+public:
+	ChanStats(size_t noiseWindow);
+
+	/* Noise amplitude measured on idle timeslots */
+	AvgStat noise;
+	SlotStats slots[8];
+};
+
+#endif /* _BURST_STATS_H_ */
@@ -0,0 +1,206 @@
+/*
+ * Multi-ARFCN carrier layout
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <sstream>
+#include <algorithm>
+
+#include "CarrierPlan.h"
+#include "Logger.h"
+
+/* GSM rate at 4 sps is 3250000 / 3 Hz */
+#define GSM_RATE4_NUM		3250000
+#define GSM_RATE4_DEN		3
+
+static size_t gcd(size_t a, size_t b)
+{
+	while (b) {
+		size_t t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+bool CarrierPlan::fftSize(size_t m)
+{
+	if (!m)
+		return false;
+
+	while (!(m % 2))
+		m /= 2;
+	while (!(m % 3))
+		m /= 3;
+	while (!(m % 5))
+		m /= 5;
+
+	return m == 1;
+}
+
+CarrierPlan::CarrierPlan()
+	: mSize(0), mSpacing(0.0), mP(0), mQ(0)
+{
+}
+
+/*
+ * The default layout reproduces the original fixed configurations: four
+ * paths at 800 kHz with up to three carriers on offsets 0, +1 and -1.
+ * Larger blocks grow the channelizer to the next FFT friendly size that
+ * leaves at least the edge path unused.
+ */
+bool CarrierPlan::init(size_t chans, size_t m, double spacing,
+		       const std::vector<int> &offsets)
+{
+	std::vector<int> layout = offsets;
+	long grid = lround(spacing);
+	int max = 0;
+
+	if (!chans) {
+		LOG(ALERT) << "No carriers in multi-ARFCN layout";
+		return false;
+	}
+
+	if (grid % CARRIER_GRID || grid < CARRIER_MIN_SPACING) {
+		LOG(ALERT) << "Carrier spacing " << spacing / 1e3 << " kHz is not "
+			   << "a multiple of " << CARRIER_GRID / 1000 << " kHz "
+			   << "of at least " << CARRIER_MIN_SPACING / 1000 << " kHz";
+		return false;
+	}
+
+	if (layout.empty()) {
+		for (size_t i = 0; i < chans; i++)
+			layout.push_back((int) i - (int) (chans - 1) / 2);
+	}
+
+	if (layout.size() != chans) {
+		LOG(ALERT) << "Carrier map has " << layout.size()
+			   << " entries for " << chans << " channels";
+		return false;
+	}
+
+	for (size_t i = 0; i < chans; i++)
+		max = std::max(max, abs(layout[i]));
+
+	if (!m) {
+		for (m = std::max(4, 2 * max + 2); !fftSize(m); m++);
+	}
+
+	if (!fftSize(m) || m > CARRIER_MAX_SIZE) {
+		LOG(ALERT) << "Unsupported channelizer size " << m;
+		return false;
+	}
+
+	/* The device clocks at an integer multiple of the sample rate */
+	if (m * grid > CARRIER_MAX_RATE) {
+		LOG(ALERT) << "Sample rate " << m * grid / 1e6 << " MHz of "
+			   << m << " paths exceeds the device limit of "
+			   << CARRIER_MAX_RATE / 1e6 << " MHz";
+		return false;
+	}
+
+	std::vector<int> paths(m, -1);
+
+	for (size_t i = 0; i < chans; i++) {
+		if (2 * abs(layout[i]) >= (int) m) {
+			LOG(ALERT) << "Carrier offset " << layout[i]
+				   << " outside channelizer size " << m;
+			return false;
+		}
+
+		int path = ((int) m - layout[i]) % (int) m;
+		if (paths[path] >= 0) {
+			LOG(ALERT) << "Duplicate carrier offset " << layout[i];
+			return false;
+		}
+
+		paths[path] = i;
+	}
+
+	size_t g = gcd(GSM_RATE4_NUM, GSM_RATE4_DEN * grid);
+
+	mSize = m;
+	mSpacing = grid;
+	mP = GSM_RATE4_NUM / g;
+	mQ = GSM_RATE4_DEN * grid / g;
+	mOffsets = layout;
+	mChans = paths;
+
+	return true;
+}
+
+double CarrierPlan::offset(size_t chan) const
+{
+	if (chan >= mOffsets.size())
+		return 0.0;
+
+	return mOffsets[chan] * mSpacing;
+}
+
+int CarrierPlan::path(size_t chan) const
+{
+	if (chan >= mOffsets.size())
+		return -1;
+
+	return (mSize - mOffsets[chan]) % mSize;
+}
+
+int CarrierPlan::chan(size_t path) const
+{
+	if (path >= mChans.size())
+		return -1;
+
+	return mChans[path];
+}
+
+std::string CarrierPlan::str() const
+{
+	std::ostringstream ost;
+
+	ost << mSize << " x " << mSpacing / 1e3 << " kHz, offsets";
+	for (size_t i = 0; i < mOffsets.size(); i++)
+		ost << (i ? "," : " ") << mOffsets[i];
+
+	return ost.str();
+}
+
+bool CarrierPlan::parseOffsets(const std::string &str,
+			       std::vector<int> &offsets)
+{
+	const char *p = str.c_str();
+	char *end;
+
+	offsets.clear();
+
+	while (*p) {
+		long val = strtol(p, &end, 10);
+		if (end == p || (*end && *end != ','))
+			return false;
+
+		offsets.push_back(val);
+
+		p = end;
+		if (*p == ',' && !*++p)
+			return false;
+	}
+
+	return !offsets.empty();
+}
@@ -0,0 +1,95 @@
+/*
+ * Multi-ARFCN carrier layout
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef _CARRIER_PLAN_H_
+#define _CARRIER_PLAN_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "radioDevice.h"
+
+/* Carrier spacing granularity and lower limit in Hz */
+#define CARRIER_GRID		200000
+#define CARRIER_MIN_SPACING	400000
+#define CARRIER_MAX_SIZE	64
+
+/* Highest master clock rate of multi-ARFCN devices in Hz */
+#define CARRIER_MAX_RATE	51.2e6
+
+/*
+ * Placement of the logical channels on the paths of an M path polyphase
+ * channelizer. The device samples M carrier spacings around its centre
+ * frequency and each path carries one spacing wide band. Carriers sit at
+ * integer offsets from the centre, excluding the band edge at M / 2.
+ */
+class CarrierPlan {
+public:
+	CarrierPlan();
+
+	/** Lay out carriers on the channelizer
+	    @param chans number of logical channels
+	    @param m number of channelizer paths, 0 for the smallest size
+	           that fits the carriers with a guard band at the edge
+	    @param spacing carrier spacing in Hz, a multiple of 200 kHz
+	    @param offsets offset of each channel from the centre frequency
+	           in carrier spacings, empty for a contiguous block
+	    @return false if the layout is invalid
+	*/
+	bool init(size_t chans, size_t m = 0, double spacing = MCBTS_SPACING,
+		  const std::vector<int> &offsets = std::vector<int>());
+
+	size_t size() const { return mSize; }
+	size_t chans() const { return mOffsets.size(); }
+	double spacing() const { return mSpacing; }
+
+	/* Device sample rate */
+	double rate() const { return mSize * mSpacing; }
+
+	/* Channel frequency relative to the device centre frequency in Hz */
+	double offset(size_t chan) const;
+
+	/* Channelizer path of a channel, and channel on a path or -1 */
+	int path(size_t chan) const;
+	int chan(size_t path) const;
+
+	/* Rational ratio of the 4 sps GSM rate to the path rate */
+	size_t resampP() const { return mP; }
+	size_t resampQ() const { return mQ; }
+
+	std::string str() const;
+
+	/* Parse a comma separated list of carrier offsets */
+	static bool parseOffsets(const std::string &str,
+				 std::vector<int> &offsets);
+
+	/* Sizes made of factors 2, 3 and 5 only, which the FFT handles well */
+	static bool fftSize(size_t m);
+
+private:
+	size_t mSize;
+	double mSpacing;
+	size_t mP, mQ;
+	std::vector<int> mOffsets;
+	std::vector<int> mChans;
+};
+
+#endif /* _CARRIER_PLAN_H_ */
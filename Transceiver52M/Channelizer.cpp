@@ -33,17 +33,36 @@ extern "C" {
 #include "common/convolve.h"
 }
 
-static void deinterleave(const float *in, size_t ilen,
-			 float **out, size_t olen, size_t m)
+/*
+ * Row of samples times the mixer lanes of a path, giving the real and
+ * imaginary parts of the path sample. Groups of four let the compiler use
+ * full SIMD registers.
+ */
+static void dot(const float *__restrict x, const float *__restrict a,
+		const float *__restrict b, float *y, size_t len)
 {
-	size_t i, n;
+	float re0 = 0.0f, re1 = 0.0f, re2 = 0.0f, re3 = 0.0f;
+	float im0 = 0.0f, im1 = 0.0f, im2 = 0.0f, im3 = 0.0f;
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		re0 += x[i + 0] * a[i + 0];
+		re1 += x[i + 1] * a[i + 1];
+		re2 += x[i + 2] * a[i + 2];
+		re3 += x[i + 3] * a[i + 3];
+		im0 += x[i + 0] * b[i + 0];
+		im1 += x[i + 1] * b[i + 1];
+		im2 += x[i + 2] * b[i + 2];
+		im3 += x[i + 3] * b[i + 3];
+	}
 
-	for (i = 0; i < olen; i++) {
-		for (n = 0; n < m; n++) {
-			out[m - 1 - n][2 * i + 0] = in[2 * (i * m + n) + 0];
-			out[m - 1 - n][2 * i + 1] = in[2 * (i * m + n) + 1];
-		}
+	for (; i < len; i++) {
+		re0 += x[i] * a[i];
+		im0 += x[i] * b[i];
 	}
+
+	y[0] = (re0 + re1) + (re2 + re3);
+	y[1] = (im0 + im1) + (im2 + im3);
 }
 
 size_t Channelizer::inputLen() const
@@ -61,7 +80,7 @@ float *Channelizer::outputBuffer(size_t chan) const
 	if (chan >= m)
 		return NULL;
 
-	return hInputs[chan];
+	return &paths[2 * (chan * (blockLen + hLen) + hLen)];
 }
 
 /* 
@@ -72,34 +91,32 @@ float *Channelizer::outputBuffer(size_t chan) const
  */
 bool Channelizer::rotate(const float *in, size_t len)
 {
-	size_t hSize = 2 * hLen * sizeof(float);
-
 	if (!checkLen(blockLen, len))
 		return false;
 
-	deinterleave(in, len, hInputs, blockLen, m);
-
-	/* 
-	 * Convolve through filterbank while applying and saving sample history 
-	 */
-	for (size_t i = 0; i < m; i++) {
-		memcpy(&hInputs[i][2 * -hLen], hist[i], hSize);
-		memcpy(hist[i], &hInputs[i][2 * (blockLen - hLen)], hSize);
+	/* Wideband rows straight into the partition filters */
+	filter(in, rows);
 
-		convolve_real(hInputs[i], blockLen,
-			      subFilters[i], hLen,
-			      hOutputs[i], blockLen,
-			      0, blockLen, 1, 0);
+	if (carriers.empty()) {
+		cxvec_fft(fftHandle);
+		return true;
 	}
 
-	cxvec_fft(fftHandle);
+	for (size_t i = 0; i < blockLen; i++) {
+		for (size_t n = 0; n < carriers.size(); n++) {
+			const float *a = &mixers[n * 4 * m];
+
+			dot(&rows[2 * i * m], a, &a[2 * m],
+			    &outputBuffer(carriers[n])[2 * i], 2 * m);
+		}
+	}
 
 	return true;
 }
 
 /* Setup channelizer paramaters */
 Channelizer::Channelizer(size_t m, size_t blockLen, size_t hLen)
-	: ChannelizerBase(m, blockLen, hLen)
+	: ChannelizerBase(m, blockLen, hLen, false)
 {
 }
 
@@ -30,6 +30,7 @@
 
 extern "C" {
 #include "common/fft.h"
+#include "common/convolve.h"
 }
 
 static float sinc(float x)
@@ -40,21 +41,6 @@ static float sinc(float x)
 	return sin(M_PI * x) / (M_PI * x);
 }
 
-/*
- * There are more efficient reversal algorithms, but we only reverse at
- * initialization so we don't care.
- */
-static void reverse(float *buf, size_t len)
-{
-	float tmp[2 * len];
-	memcpy(tmp, buf, 2 * len * sizeof(float));
-
-	for (size_t i = 0; i < len; i++) {
-		buf[2 * i + 0] = tmp[2 * (len - 1 - i) + 0];
-		buf[2 * i + 1] = tmp[2 * (len - 1 - i) + 1];
-	}
-}
-
 /* 
  * Create polyphase filterbank
  *
@@ -71,25 +57,21 @@ bool ChannelizerBase::initFilters()
 	float midpt = (float) (protoLen - 1.0) / 2.0;
 
 	/* 
-	 * Allocate 'M' partition filters and the temporary prototype
-	 * filter. Coefficients are real only and must be 16-byte memory
-	 * aligned for SSE usage.
+	 * Allocate the tap rows and the temporary prototype filter. Tap
+	 * rows match the layout of signal rows, with every real tap
+	 * repeated for the real and imaginary parts of its lane, and must
+	 * be 16-byte memory aligned for SSE usage.
 	 */
 	proto = new float[protoLen];
 	if (!proto)
 		return false;
 
-	subFilters = (float **) malloc(sizeof(float *) * m);
-	if (!subFilters) {
+	taps = (float *) memalign(16, hLen * 2 * m * sizeof(float));
+	if (!taps) {
 		delete[] proto;
 		return false;
 	}
 
-	for (size_t i = 0; i < m; i++) {
-		subFilters[i] = (float *)
-				memalign(16, hLen * 2 * sizeof(float));
-	}
-
 	/* 
 	 * Generate the prototype filter with a Blackman-harris window.
 	 * Scale coefficients with DC filter gain set to unity divided
@@ -111,67 +93,64 @@ bool ChannelizerBase::initFilters()
 	scale = (float) m / sum;
 
 	/* 
-	 * Populate partition filters and reverse the coefficients per
-	 * convolution requirements.
+	 * Populate the tap rows, oldest sample first per convolution
+	 * requirements. Partition n of the commutator sits in lane n for
+	 * synthesis and in lane m - 1 - n for the channelizer, which takes
+	 * the newest wideband sample of a row into the first partition.
 	 */
-	for (size_t i = 0; i < hLen; i++) {
-		for (size_t n = 0; n < m; n++) {
-			subFilters[n][2 * i + 0] = proto[i * m + n] * scale;
-			subFilters[n][2 * i + 1] = 0.0f;
+	for (size_t k = 0; k < hLen; k++) {
+		for (size_t lane = 0; lane < m; lane++) {
+			size_t n = synth ? lane : m - 1 - lane;
+			float tap = proto[(hLen - 1 - k) * m + n] * scale;
+
+			taps[2 * (k * m + lane) + 0] = tap;
+			taps[2 * (k * m + lane) + 1] = tap;
 		}
 	}
 
-	for (size_t i = 0; i < m; i++)
-		reverse(subFilters[i], hLen);
-
 	delete[] proto;
 
 	return true;
 }
 
+/*
+ * The FFT runs across each row of partitions and reads channelizer rows
+ * backwards, matching the lane order of the partition filters. Path
+ * buffers on the channelizer side keep headroom for the history of the
+ * following resampler.
+ */
 bool ChannelizerBase::initFFT()
 {
 	size_t size;
 
-	if (fftInput || fftOutput || fftHandle)
+	if (rows || paths || fftHandle)
 		return false;
 
 	size = blockLen * m * 2 * sizeof(float);
-	fftInput = (float *) fft_malloc(size);
-	memset(fftInput, 0, size);
+	rows = (float *) fft_malloc(size);
 
-	size = (blockLen + hLen) * m * 2 * sizeof(float);
-	fftOutput = (float *) fft_malloc(size);
-	memset(fftOutput, 0, size);
+	size = (blockLen + (synth ? 0 : hLen)) * m * 2 * sizeof(float);
+	paths = (float *) fft_malloc(size);
 
-	if (!fftInput | !fftOutput) {
+	if (!rows || !paths) {
 		LOG(ALERT) << "Memory allocation error";
 		return false;
 	}
 
-	fftHandle = init_fft(0, m, blockLen, blockLen + hLen,
-			     fftInput, fftOutput, hLen);
-	return true;
-}
-
-bool ChannelizerBase::mapBuffers()
-{
-	if (!fftHandle) {
-		LOG(ALERT) << "FFT buffers not initialized";
-		return false;
+	memset(rows, 0, blockLen * m * 2 * sizeof(float));
+	memset(paths, 0, size);
+
+	if (synth) {
+		fftHandle = init_fft_many(0, m, blockLen,
+					  paths, blockLen, 1,
+					  rows, 1, m);
+	} else {
+		fftHandle = init_fft_many(0, m, blockLen,
+					  &rows[2 * (m - 1)], -1, m,
+					  &paths[2 * hLen], blockLen + hLen, 1);
 	}
 
-	hInputs = (float **) malloc(sizeof(float *) * m);
-	hOutputs = (float **) malloc(sizeof(float *) * m);
-	if (!hInputs | !hOutputs)
-		return false;
-
-	for (size_t i = 0; i < m; i++) {
-		hInputs[i] = &fftOutput[2 * (i * (blockLen + hLen) + hLen)];
-		hOutputs[i] = &fftInput[2 * (i * blockLen)];
-	}
-
-	return true;
+	return fftHandle != NULL;
 }
 
 /* 
@@ -179,6 +158,14 @@ bool ChannelizerBase::mapBuffers()
  */
 bool ChannelizerBase::init()
 {
+	size_t size = 2 * (hLen - 1) * m * 2 * sizeof(float);
+
+	if (blockLen < hLen) {
+		LOG(ALERT) << "Block length " << blockLen
+			   << " is shorter than the filter length " << hLen;
+		return false;
+	}
+
 	/*
 	 * Filterbank coefficients, fft plan, history, and output sample
 	 * rate conversion blocks
@@ -188,18 +175,88 @@ bool ChannelizerBase::init()
 		return false;
 	}
 
-	hist = (float **) malloc(sizeof(float *) * m);
-	for (size_t i = 0; i < m; i++) {
-		hist[i] = new float[2 * hLen];
-		memset(hist[i], 0, 2 * hLen * sizeof(float));
-	}
+	head = (float *) memalign(16, size);
+	if (!head)
+		return false;
+	memset(head, 0, size);
 
 	if (!initFFT()) {
 		LOG(ALERT) << "Failed to initialize FFT";
 		return false;
 	}
 
-	mapBuffers();
+	return true;
+}
+
+/*
+ * The first rows of a block reach back into the previous block, they are
+ * filtered from a short copy that joins the trailing rows of the previous
+ * block with the leading rows of this one. All other rows are filtered in
+ * place.
+ */
+void ChannelizerBase::filter(const float *in, float *out)
+{
+	size_t h = hLen - 1, width = 2 * m;
+
+	if (h) {
+		memcpy(&head[h * width], in, h * width * sizeof(float));
+		convolve_real_lanes(head, 2 * h, taps, hLen, out, h, m);
+		memcpy(head, &in[(blockLen - h) * width],
+		       h * width * sizeof(float));
+	}
+
+	convolve_real_lanes(in, blockLen, taps, hLen,
+			    &out[h * width], blockLen - h, m);
+}
+
+/*
+ * Per-carrier engine
+ *
+ * A single carrier could be converted on its own with a mixer followed by
+ * the decimating or interpolating prototype filter. Carrier frequencies are
+ * multiples of the path rate, so the mixer moves across the polyphase
+ * partition filters and reduces to one fixed phase per partition, which
+ * leaves the partition filters shared by all carriers. What remains per
+ * carrier is a single bin of the M-point transform across a row, a complex
+ * dot product with its mixer phases. Mixer phases are stored as two lane
+ * rows laid out so that rows of complex samples are processed as plain
+ * float vectors.
+ */
+bool ChannelizerBase::setCarriers(const std::vector<size_t> &paths)
+{
+	for (size_t i = 0; i < paths.size(); i++) {
+		if (paths[i] >= m) {
+			LOG(ALERT) << "Invalid carrier path " << paths[i];
+			return false;
+		}
+	}
+
+	carriers = paths;
+	mixers.resize(carriers.size() * 4 * m);
+
+	for (size_t i = 0; i < carriers.size(); i++) {
+		float *a = &mixers[i * 4 * m], *b = &a[2 * m];
+
+		for (size_t lane = 0; lane < m; lane++) {
+			size_t n = synth ? lane : m - 1 - lane;
+			double phase = -2 * M_PI * (carriers[i] * n % m) / m;
+			float re = cos(phase), im = sin(phase);
+
+			if (synth) {
+				/* Product of a path sample and the phase */
+				a[2 * lane + 0] = re;
+				a[2 * lane + 1] = im;
+				b[2 * lane + 0] = -im;
+				b[2 * lane + 1] = re;
+			} else {
+				/* Real and imaginary parts of the dot product */
+				a[2 * lane + 0] = re;
+				a[2 * lane + 1] = -im;
+				b[2 * lane + 0] = im;
+				b[2 * lane + 1] = re;
+			}
+		}
+	}
 
 	return true;
 }
@@ -225,27 +282,24 @@ bool ChannelizerBase::checkLen(size_t innerLen, size_t outerLen)
 /* 
  * Setup channelizer paramaters
  */
-ChannelizerBase::ChannelizerBase(size_t m, size_t blockLen, size_t hLen)
-	: fftInput(NULL), fftOutput(NULL), fftHandle(NULL)
+ChannelizerBase::ChannelizerBase(size_t m, size_t blockLen, size_t hLen,
+				 bool synth)
+	: taps(NULL), head(NULL), rows(NULL), paths(NULL), fftHandle(NULL)
 {
 	this->m = m;
 	this->hLen = hLen;
 	this->blockLen = blockLen;
+	this->synth = synth;
 }
 
 ChannelizerBase::~ChannelizerBase()
 {
-	free_fft(fftHandle);
-
-	for (size_t i = 0; i < m; i++) {
-		free(subFilters[i]);
-		delete hist[i];
-	}
+	if (fftHandle)
+		free_fft(fftHandle);
 
-	fft_free(fftInput);
-	fft_free(fftOutput);
+	fft_free(rows);
+	fft_free(paths);
 
-	free(hInputs);
-	free(hOutputs);
-	free(hist);
+	free(taps);
+	free(head);
 }
@@ -1,9 +1,19 @@
 #ifndef _CHANNELIZER_BASE_H_
 #define _CHANNELIZER_BASE_H_
 
+#include <vector>
+
+/*
+ * Signals are kept in rows of M interleaved complex samples, one per
+ * polyphase partition, which is the order of the wideband samples. The
+ * partition filters run across a row at once with the filter of every
+ * partition in its own lane, so the commutator needs no reordering and
+ * filter history is the trailing rows of the previous block. Per path
+ * buffers only exist on the narrowband side of the FFT.
+ */
 class ChannelizerBase {
 protected:
-	ChannelizerBase(size_t m, size_t blockLen, size_t hLen);
+	ChannelizerBase(size_t m, size_t blockLen, size_t hLen, bool synth);
 	~ChannelizerBase();
 
 	/* Channelizer parameters */
@@ -11,29 +21,44 @@ protected:
 	size_t hLen;
 	size_t blockLen;
 
-	/* Channelizer filterbank sub-filters */
-	float **subFilters;
+	/* Synthesis runs the FFT before the partition filters */
+	bool synth;
+
+	/* Partition filter taps, hLen rows with one lane per partition */
+	float *taps;
+
+	/* Partition filter history followed by the head of the block */
+	float *head;
 
-	/* Input/Output buffers */
-	float **hInputs, **hOutputs, **hist;
-	float *fftInput, *fftOutput;
+	/* Rows on the wideband side and paths on the narrowband side */
+	float *rows, *paths;
 
 	/* Pointer to opaque FFT instance */
 	struct fft_hdl *fftHandle;
 
+	/* Paths of the per-carrier engine and their mixer lanes */
+	std::vector<size_t> carriers;
+	std::vector<float> mixers;
+
 	/* Initializer internals */
 	bool initFilters();
 	bool initFFT();
-	void releaseFilters();
 
-	/* Map overlapped FFT and filter I/O buffers */
-	bool mapBuffers();
+	/* Run the partition filters over a block of rows */
+	void filter(const float *in, float *out);
 
 	/* Buffer length validity checking */
 	bool checkLen(size_t innerLen, size_t outerLen);
 public:
 	/* Initilize channelizer/synthesis filter internals */
 	bool init();
+
+	/** Select the per-carrier engine for a sparse set of paths
+	    @param paths paths to process, empty for the full filterbank
+	    @return false if a path is out of range
+	*/
+	bool setCarriers(const std::vector<size_t> &paths);
+	bool carrierMode() const { return !carriers.empty(); }
 };
 
 #endif /* _CHANNELIZER_BASE_H_ */
@@ -0,0 +1,252 @@
+/*
+ * TRXC control command parsing and formatting
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+#include "ControlCommand.h"
+
+/*
+ * Command table
+ *
+ * Responses start from a preformatted "RSP <name> " template, so only the
+ * status and integer arguments are formatted per message. The unknown
+ * command entry holds the "RSP ERR " template.
+ */
+struct CtrlEntry {
+	const char *name;
+	size_t nameLen;
+	const char *rsp;
+	size_t rspLen;
+	int args;
+};
+
+#define CTRL_ENTRY(name, args) \
+	{ #name, sizeof(#name) - 1, "RSP " #name " ", sizeof("RSP " #name " ") - 1, args }
+
+static const CtrlEntry ctrlTable[CTRL_UNKNOWN + 1] = {
+	CTRL_ENTRY(POWEROFF, 0),
+	CTRL_ENTRY(POWERON, 0),
+	CTRL_ENTRY(HANDOVER, 2),
+	CTRL_ENTRY(NOHANDOVER, 2),
+	CTRL_ENTRY(SETMAXDLY, 1),
+	CTRL_ENTRY(SETMAXDLYNB, 1),
+	CTRL_ENTRY(SETRXGAIN, 1),
+	CTRL_ENTRY(NOISELEV, 0),
+	CTRL_ENTRY(SETPOWER, 1),
+	CTRL_ENTRY(ADJPOWER, 1),
+	CTRL_ENTRY(RXTUNE, 1),
+	CTRL_ENTRY(TXTUNE, 1),
+	CTRL_ENTRY(SETTSC, 1),
+	CTRL_ENTRY(SETSLOT, 2),
+	CTRL_ENTRY(_SETBURSTTODISKMASK, 1),
+	CTRL_ENTRY(GETSTATS, 1),
+	CTRL_ENTRY(SETSUBTSC, 2),
+	CTRL_ENTRY(SETFORMAT, 1),
+	CTRL_ENTRY(ERR, 0),
+};
+
+/*
+ * Perfect hash over the command names
+ *
+ * Length, first and last character are enough to tell all commands apart
+ * within 32 slots. A lookup costs one hash and one memcmp. Slots are
+ * filled from the command table once; TransceiverTest checks that every
+ * command lands in its own slot, so the hash must be revisited if a new
+ * command collides.
+ */
+#define CTRL_HASH_SIZE		32
+
+static inline unsigned ctrlHash(const char *name, size_t len)
+{
+	return (len + 6 * (unsigned char) name[0] +
+		(unsigned char) name[len - 1]) & (CTRL_HASH_SIZE - 1);
+}
+
+struct CtrlSlots {
+	CtrlSlots()
+	{
+		for (int i = 0; i < CTRL_HASH_SIZE; i++)
+			slots[i] = CTRL_UNKNOWN;
+
+		for (int i = 0; i < CTRL_UNKNOWN; i++)
+			slots[ctrlHash(ctrlTable[i].name, ctrlTable[i].nameLen)] = i;
+	}
+
+	int slots[CTRL_HASH_SIZE];
+};
+
+static int lookupCommand(const char *name, size_t len)
+{
+	static const CtrlSlots table;
+
+	if (!len)
+		return CTRL_UNKNOWN;
+
+	int cmd = table.slots[ctrlHash(name, len)];
+	const CtrlEntry &entry = ctrlTable[cmd];
+
+	if (cmd == CTRL_UNKNOWN || entry.nameLen != len ||
+	    memcmp(entry.name, name, len))
+		return CTRL_UNKNOWN;
+
+	return cmd;
+}
+
+/* Locale independent decimal integer, which must end at a delimiter */
+static bool parseInt(const char *&p, const char *end, int &val)
+{
+	bool neg = false;
+	int digits = 0;
+	long v = 0;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = *p++ == '-';
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		if (++digits > 9)
+			return false;
+		v = 10 * v + (*p - '0');
+	}
+
+	if (!digits || (p < end && *p != ' '))
+		return false;
+
+	val = neg ? -v : v;
+	return true;
+}
+
+bool parseCtrlCommand(const char *buf, size_t len, CtrlCommand &cmd)
+{
+	const char *nul = (const char *) memchr(buf, '\0', len);
+	const char *end = nul ? nul : buf + len;
+	const char *p = buf;
+
+	cmd.cmd = CTRL_UNKNOWN;
+	cmd.name = NULL;
+	cmd.nameLen = 0;
+	cmd.argc = 0;
+
+	if (end - p < 4 || memcmp(p, "CMD ", 4))
+		return false;
+
+	for (p += 4; p < end && *p == ' '; p++);
+
+	cmd.name = p;
+	for (; p < end && *p != ' '; p++);
+	cmd.nameLen = p - cmd.name;
+	cmd.cmd = lookupCommand(cmd.name, cmd.nameLen);
+
+	while (cmd.argc < CTRL_MAX_ARGS) {
+		for (; p < end && *p == ' '; p++);
+		if (p == end || !parseInt(p, end, cmd.argv[cmd.argc]))
+			break;
+		cmd.argc++;
+	}
+
+	return true;
+}
+
+/* Append a decimal integer, return false if it does not fit */
+static bool appendInt(char *&p, const char *end, long long val)
+{
+	char digits[24];
+	unsigned long long v = val < 0 ? -(unsigned long long) val : val;
+	int n = 0;
+
+	do {
+		digits[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+
+	if (end - p < n + (val < 0))
+		return false;
+
+	if (val < 0)
+		*p++ = '-';
+	while (n)
+		*p++ = digits[--n];
+
+	return true;
+}
+
+size_t formatCtrlResponse(char *buf, size_t size, int cmd, int status,
+			  const int *argv, int argc)
+{
+	if (cmd < 0 || cmd > CTRL_UNKNOWN)
+		cmd = CTRL_UNKNOWN;
+
+	const CtrlEntry &entry = ctrlTable[cmd];
+	const char *end = buf + size - 1;
+	char *p = buf;
+
+	if (size <= entry.rspLen)
+		return 0;
+
+	memcpy(p, entry.rsp, entry.rspLen);
+	p += entry.rspLen;
+
+	if (!appendInt(p, end, status))
+		return 0;
+
+	for (int i = 0; i < argc; i++) {
+		if (p == end)
+			return 0;
+		*p++ = ' ';
+		if (!appendInt(p, end, argv[i]))
+			return 0;
+	}
+
+	*p++ = '\0';
+	return p - buf;
+}
+
+size_t formatClockIndication(char *buf, size_t size, unsigned long long fn)
+{
+	static const char ind[] = "IND CLOCK ";
+	const char *end = buf + size - 1;
+	char *p = buf;
+
+	if (size <= sizeof(ind) - 1)
+		return 0;
+
+	memcpy(p, ind, sizeof(ind) - 1);
+	p += sizeof(ind) - 1;
+
+	if (!appendInt(p, end, fn))
+		return 0;
+
+	*p++ = '\0';
+	return p - buf;
+}
+
+const char *ctrlCommandName(int cmd)
+{
+	if (cmd < 0 || cmd > CTRL_UNKNOWN)
+		cmd = CTRL_UNKNOWN;
+
+	return ctrlTable[cmd].name;
+}
+
+int ctrlCommandArgs(int cmd)
+{
+	if (cmd < 0 || cmd > CTRL_UNKNOWN)
+		return 0;
+
+	return ctrlTable[cmd].args;
+}
@@ -0,0 +1,84 @@
+/*
+ * TRXC control command parsing and formatting
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef _CONTROL_COMMAND_H_
+#define _CONTROL_COMMAND_H_
+
+#include <stddef.h>
+
+/* Longest control message and response, including the terminating NUL */
+#define CTRL_MAX_LEN		128
+#define CTRL_MAX_ARGS		3
+
+/* Control commands in command table order */
+enum CtrlCmd {
+	CTRL_POWEROFF,
+	CTRL_POWERON,
+	CTRL_HANDOVER,
+	CTRL_NOHANDOVER,
+	CTRL_SETMAXDLY,
+	CTRL_SETMAXDLYNB,
+	CTRL_SETRXGAIN,
+	CTRL_NOISELEV,
+	CTRL_SETPOWER,
+	CTRL_ADJPOWER,
+	CTRL_RXTUNE,
+	CTRL_TXTUNE,
+	CTRL_SETTSC,
+	CTRL_SETSLOT,
+	CTRL_SETBURSTTODISKMASK,
+	CTRL_GETSTATS,
+	CTRL_SETSUBTSC,
+	CTRL_SETFORMAT,
+	CTRL_UNKNOWN,
+};
+
+/* Parsed "CMD <name> [<int> ...]" message */
+struct CtrlCommand {
+	int cmd;			/* CtrlCmd */
+	const char *name;		/* command name within the message */
+	size_t nameLen;
+	int argc;			/* number of leading integer arguments */
+	int argv[CTRL_MAX_ARGS];
+};
+
+/** Parse a control message
+    @param buf message, which need not be NUL terminated
+    @param len message length
+    @param cmd parsed command, CTRL_UNKNOWN for unrecognized names
+    @return false if this is not a command message
+*/
+bool parseCtrlCommand(const char *buf, size_t len, CtrlCommand &cmd);
+
+/** Format a "RSP <name> <status> [<int> ...]" response
+    @return response length including the terminating NUL, or 0 if the
+            buffer is too short
+*/
+size_t formatCtrlResponse(char *buf, size_t size, int cmd, int status,
+			  const int *argv = NULL, int argc = 0);
+
+/** Format an "IND CLOCK <fn>" indication, same return as above */
+size_t formatClockIndication(char *buf, size_t size, unsigned long long fn);
+
+/** Name and number of expected integer arguments of a command */
+const char *ctrlCommandName(int cmd);
+int ctrlCommandArgs(int cmd);
+
+#endif /* _CONTROL_COMMAND_H_ */
@@ -0,0 +1,165 @@
+/*
+ * TRXD burst message parsing and formatting
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <string.h>
+#include "DataMessage.h"
+
+/* Timeslot, frame number and power, common to both directions */
+static void parseHeader(const unsigned char *p, TrxdBurst &burst)
+{
+	burst.tn = p[0];
+	burst.fn = ((uint32_t) p[1] << 24) | (p[2] << 16) | (p[3] << 8) | p[4];
+	burst.power = (signed char) p[5];
+	burst.toa = 0;
+}
+
+static void writeHeader(unsigned char *p, const TrxdBurst &burst, unsigned tn)
+{
+	p[0] = tn;
+	for (int i = 0; i < 4; i++)
+		p[1 + i] = (burst.fn >> ((3 - i) * 8)) & 0xff;
+	p[5] = burst.power;
+	p[6] = (burst.toa >> 8) & 0xff;
+	p[7] = burst.toa & 0xff;
+}
+
+/* Legacy messages are told apart by length alone */
+static int parseLegacy(const unsigned char *p, size_t len, TrxdBurst *bursts)
+{
+	if (len == NORMAL_BURST_NBITS + TRXD_DL_HDR)
+		bursts[0].nbits = NORMAL_BURST_NBITS;
+	else if (len == EDGE_BURST_NBITS + TRXD_DL_HDR)
+		bursts[0].nbits = EDGE_BURST_NBITS;
+	else
+		return -1;
+
+	parseHeader(p, bursts[0]);
+	bursts[0].data = p + TRXD_DL_HDR;
+	bursts[0].packed = false;
+
+	return 1;
+}
+
+int parseTrxdBursts(const char *buf, size_t len, int format,
+		    TrxdBurst *bursts, int max)
+{
+	const unsigned char *p = (const unsigned char *) buf;
+	const unsigned char *end = p + len;
+
+	if (max < 1)
+		return -1;
+
+	if (format != TRXD_PACKED)
+		return parseLegacy(p, len, bursts);
+
+	if (len < TRXD_BATCH_HDR || p[0] != TRXD_PACKED || p[1] > max)
+		return -1;
+
+	int count = p[1];
+	p += TRXD_BATCH_HDR;
+
+	for (int i = 0; i < count; i++) {
+		if (end - p < TRXD_DL_HDR)
+			return -1;
+
+		size_t nbits = p[0] & TRXD_EDGE ? EDGE_BURST_NBITS : NORMAL_BURST_NBITS;
+		size_t bytes = (nbits + 7) / 8;
+
+		if ((size_t) (end - p) < TRXD_DL_HDR + bytes)
+			return -1;
+
+		parseHeader(p, bursts[i]);
+		bursts[i].tn &= ~TRXD_EDGE;
+		bursts[i].nbits = nbits;
+		bursts[i].data = p + TRXD_DL_HDR;
+		bursts[i].packed = true;
+
+		p += TRXD_DL_HDR + bytes;
+	}
+
+	/* Trailing bytes mean the batch header and the bursts disagree */
+	return p == end ? count : -1;
+}
+
+void trxdBurstBits(const TrxdBurst &burst, BitVector &bits)
+{
+	if (burst.packed)
+		bits.unpack(burst.data);
+	else
+		memcpy(bits.begin(), burst.data, burst.nbits);
+}
+
+size_t appendTrxdBurst(char *buf, size_t size, size_t len, int format,
+		       unsigned softBits, const TrxdBurst &burst,
+		       const SoftVector &bits)
+{
+	unsigned char *msg = (unsigned char *) buf;
+	size_t nbits = bits.size();
+
+	if (nbits > EDGE_BURST_NBITS)
+		return 0;
+
+	/* One byte per soft bit, then an unused byte and a terminating NUL */
+	if (format != TRXD_PACKED) {
+		if (len || size < TRXD_UL_HDR + nbits + 2)
+			return 0;
+
+		writeHeader(msg, burst, burst.tn);
+		vectorQuantize(bits, &buf[TRXD_UL_HDR]);
+		msg[TRXD_UL_HDR + nbits] = 0;
+		msg[TRXD_UL_HDR + nbits + 1] = 0;
+
+		return TRXD_UL_HDR + nbits + 2;
+	}
+
+	if (!len) {
+		if (size < TRXD_BATCH_HDR)
+			return 0;
+
+		msg[0] = TRXD_PACKED;
+		msg[1] = 0;
+		len = TRXD_BATCH_HDR;
+	}
+
+	size_t bytes = softBits == 4 ? (nbits + 1) / 2 : nbits;
+
+	if (msg[1] >= TRXD_MAX_BATCH || size < len + TRXD_UL_HDR + bytes)
+		return 0;
+
+	unsigned char *p = msg + len;
+	unsigned flags = nbits == EDGE_BURST_NBITS ? TRXD_EDGE : 0;
+
+	writeHeader(p, burst, burst.tn | flags);
+
+	if (softBits == 4) {
+		unsigned char q[EDGE_BURST_NBITS + 1];
+
+		q[nbits] = 0;
+		vectorQuantize(bits, (char *) q);
+		for (size_t i = 0; i < bytes; i++)
+			p[TRXD_UL_HDR + i] = (q[2 * i] & 0xf0) | (q[2 * i + 1] >> 4);
+	} else {
+		vectorQuantize(bits, (char *) &p[TRXD_UL_HDR]);
+	}
+
+	msg[1]++;
+
+	return len + TRXD_UL_HDR + bytes;
+}
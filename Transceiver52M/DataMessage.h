@@ -0,0 +1,97 @@
+/*
+ * TRXD burst message parsing and formatting
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#ifndef _DATA_MESSAGE_H_
+#define _DATA_MESSAGE_H_
+
+#include <stdint.h>
+#include "sigProcLib.h"
+
+/*
+ * TRXD wire formats, selected per channel with SETFORMAT
+ *
+ * The legacy format carries one burst per datagram with one byte per bit.
+ * The packed format carries a batch of bursts per datagram behind a two
+ * byte header of format and burst count. Downlink hard bits are packed
+ * MSB-first 8 per byte, uplink soft bits are 4 or 8 bits wide, high
+ * nibble first.
+ */
+enum TrxdFormat {
+	TRXD_LEGACY,
+	TRXD_PACKED,
+};
+
+/* Timeslot byte flags of uplink bursts on the second VAMOS subchannel,
+   and of EDGE bursts in the packed format */
+#define TRXD_VAMOS_SUBCHAN	0x80
+#define TRXD_EDGE		0x40
+#define TRXD_TN_MASK		0x07
+
+/* Burst headers: timeslot, frame number, power, and uplink timing */
+#define TRXD_DL_HDR		6
+#define TRXD_UL_HDR		8
+#define TRXD_BATCH_HDR		2
+
+/* Bursts per packed datagram, and the longest message in any format */
+#define TRXD_MAX_BATCH		8
+#define TRXD_MAX_LEN		(TRXD_BATCH_HDR + \
+				 TRXD_MAX_BATCH * (TRXD_UL_HDR + EDGE_BURST_NBITS))
+
+/* Burst header fields and, for parsed downlink bursts, the bits */
+struct TrxdBurst {
+	unsigned tn;			/* timeslot with flags */
+	uint32_t fn;
+	int power;			/* downlink attenuation or uplink dBm */
+	int toa;			/* uplink timing in 1/256 symbols */
+	size_t nbits;
+	const unsigned char *data;
+	bool packed;
+};
+
+/** Parse a downlink message
+    @param buf message
+    @param len message length
+    @param format TrxdFormat of the channel
+    @param bursts parsed bursts, which point into the message
+    @param max number of bursts that fit
+    @return number of bursts, or -1 if the message is badly formatted
+*/
+int parseTrxdBursts(const char *buf, size_t len, int format,
+		    TrxdBurst *bursts, int max);
+
+/** Unpack the hard bits of a parsed downlink burst into nbits bits */
+void trxdBurstBits(const TrxdBurst &burst, BitVector &bits);
+
+/** Append an uplink burst to a message
+    @param buf message
+    @param size buffer size
+    @param len current message length, 0 to start a new message
+    @param format TrxdFormat of the channel
+    @param softBits soft bit width of the packed format, 4 or 8
+    @param burst header fields
+    @param bits -1..+1 soft bits
+    @return new message length, or 0 if the burst does not fit, which is
+            always the case for a second legacy burst
+*/
+size_t appendTrxdBurst(char *buf, size_t size, size_t len, int format,
+		       unsigned softBits, const TrxdBurst &burst,
+		       const SoftVector &bits);
+
+#endif /* _DATA_MESSAGE_H_ */
@@ -33,17 +33,41 @@ extern "C" {
 #include "common/convolve.h"
 }
 
-static void interleave(float **in, size_t ilen,
-		       float *out, size_t m)
+/*
+ * Path sample times the mixer lanes of a path, written or added into a row
+ * of partition inputs. Groups of four let the compiler use full SIMD
+ * registers.
+ */
+static void mix(float cr, float ci, const float *__restrict a,
+		const float *__restrict b, float *__restrict out, size_t len)
 {
-	size_t i, n;
+	size_t i = 0;
 
-	for (i = 0; i < ilen; i++) {
-		for (n = 0; n < m; n++) {
-			out[2 * (i * m + n) + 0] = in[n][2 * i + 0];
-			out[2 * (i * m + n) + 1] = in[n][2 * i + 1];
-		}
+	for (; i + 4 <= len; i += 4) {
+		out[i + 0] = cr * a[i + 0] + ci * b[i + 0];
+		out[i + 1] = cr * a[i + 1] + ci * b[i + 1];
+		out[i + 2] = cr * a[i + 2] + ci * b[i + 2];
+		out[i + 3] = cr * a[i + 3] + ci * b[i + 3];
+	}
+
+	for (; i < len; i++)
+		out[i] = cr * a[i] + ci * b[i];
+}
+
+static void mix_add(float cr, float ci, const float *__restrict a,
+		    const float *__restrict b, float *__restrict out, size_t len)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= len; i += 4) {
+		out[i + 0] += cr * a[i + 0] + ci * b[i + 0];
+		out[i + 1] += cr * a[i + 1] + ci * b[i + 1];
+		out[i + 2] += cr * a[i + 2] + ci * b[i + 2];
+		out[i + 3] += cr * a[i + 3] + ci * b[i + 3];
 	}
+
+	for (; i < len; i++)
+		out[i] += cr * a[i] + ci * b[i];
 }
 
 size_t Synthesis::inputLen() const
@@ -61,7 +85,7 @@ float *Synthesis::inputBuffer(size_t chan) const
 	if (chan >= m)
 		return NULL;
 
-	return hOutputs[chan];
+	return &paths[2 * chan * blockLen];
 }
 
 bool Synthesis::resetBuffer(size_t chan)
@@ -69,7 +93,7 @@ bool Synthesis::resetBuffer(size_t chan)
 	if (chan >= m)
 		return false;
 
-	memset(hOutputs[chan], 0, blockLen * 2 * sizeof(float));
+	memset(inputBuffer(chan), 0, blockLen * 2 * sizeof(float));
 
 	return true;
 }
@@ -82,37 +106,38 @@ bool Synthesis::resetBuffer(size_t chan)
  */
 bool Synthesis::rotate(float *out, size_t len)
 {
-	size_t hSize = 2 * hLen * sizeof(float);
-
 	if (!checkLen(blockLen, len)) {
 		std::cout << "Length fail" << std::endl;
 		exit(1);
 		return false;
 	}
 
-	cxvec_fft(fftHandle);
-
-	/* 
-	 * Convolve through filterbank while applying and saving sample history 
-	 */
-	for (size_t i = 0; i < m; i++) {
-		memcpy(&hInputs[i][2 * -hLen], hist[i], hSize);
-		memcpy(hist[i], &hInputs[i][2 * (blockLen - hLen)], hSize);
-
-		convolve_real(hInputs[i], blockLen,
-			      subFilters[i], hLen,
-			      hOutputs[i], blockLen,
-			      0, blockLen, 1, 0);
+	if (carriers.empty()) {
+		cxvec_fft(fftHandle);
+	} else {
+		for (size_t i = 0; i < blockLen; i++) {
+			float *row = &rows[2 * i * m];
+
+			for (size_t n = 0; n < carriers.size(); n++) {
+				const float *a = &mixers[n * 4 * m];
+				const float *x = &inputBuffer(carriers[n])[2 * i];
+
+				if (!n)
+					mix(x[0], x[1], a, &a[2 * m], row, 2 * m);
+				else
+					mix_add(x[0], x[1], a, &a[2 * m], row, 2 * m);
+			}
+		}
 	}
 
-	/* Interleave into output vector */
-	interleave(hOutputs, blockLen, out, m);
+	/* Partition filters write the interleaved output directly */
+	filter(rows, out);
 
 	return true;
 }
 
 Synthesis::Synthesis(size_t m, size_t blockLen, size_t hLen)
-	: ChannelizerBase(m, blockLen, hLen)
+	: ChannelizerBase(m, blockLen, hLen, true)
 {
 }
 
@@ -22,9 +22,14 @@
 */
 
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
 #include <iomanip>      // std::setprecision
 #include <fstream>
 #include "Transceiver.h"
+#include "ControlCommand.h"
 #include <Logger.h>
 
 #ifdef HAVE_CONFIG_H
@@ -35,6 +40,10 @@ using namespace GSM;
 
 #define USB_LATENCY_INTRVL		10,0
 
+/* Socket reactor limits: ready sockets per wakeup, messages per socket */
+#define REACTOR_EVENTS			16
+#define REACTOR_BATCH			16
+
 #if USE_UHD
 #  define USB_LATENCY_MIN		6,7
 #else
@@ -44,23 +53,74 @@ using namespace GSM;
 /* Number of running values use in noise average */
 #define NOISE_CNT			20
 
+/*
+ * Equalization applies to timeslots with a delay spread above that of the
+ * GMSK pulse, about half a symbol. Timeslots without are probed for a new
+ * channel estimate at the given interval in frames.
+ */
+#define EQ_SPREAD_THRESH		0.75f
+#define EQ_PROBE_FRAMES			26
+#define EQ_COST_ALPHA			0.05f
+
+/*
+ * Normal bursts of a timeslot are first searched around the arrival time
+ * of earlier bursts while one was detected within the interval in frames,
+ * which covers the SACCH of a dedicated channel in DTX.
+ */
+#define TOA_TRACK_FRAMES		104
+
+/*
+ * Tracked timing is confirmed with a search of the full window after this
+ * many consecutive narrow window hits, so that a false hit cannot hold the
+ * window on the wrong arrival time.
+ */
+#define TOA_CONFIRM_BURSTS		26
+
 TransceiverState::TransceiverState()
-  : mRetrans(false), mNoiseLev(0.0), mNoises(NOISE_CNT), mPower(0.0)
+  : mRetrans(false), mPower(0.0), rxLen(0), rxFormat(0), rxFN(0)
 {
+  mStats = new ChanStats(NOISE_CNT);
+  resetPending = new std::atomic<bool>[8];
+  tscPending = new std::atomic<int>[8];
+  dataFormat = new std::atomic<unsigned>;
+  rxMsg = new char[TRXD_MAX_LEN];
+  setFormat(TRXD_LEGACY, 8);
+
   for (int i = 0; i < 8; i++) {
     chanType[i] = Transceiver::NONE;
+    tsc[i] = 0;
+    vamosTsc[i] = -1;
     fillerModulus[i] = 26;
-    chanResponse[i] = NULL;
-    DFEForward[i] = NULL;
-    DFEFeedback[i] = NULL;
+    chanResponse[i] = new signalVector();
+    DFEForward[i] = new signalVector();
+    DFEFeedback[i] = new signalVector();
+    chanNoise[i] = 0.0f;
+    SNRestimate[i] = 0.0f;
+    chanRespOffset[i] = 0.0f;
+    chanRespAmplitude[i] = 0.0f;
+    equalize[i] = false;
+    freqOffset[i] = 0.0f;
+    toaTrack[i] = false;
+    toaTracked[i] = 0;
+    resetPending[i] = false;
+    tscPending[i] = 0;
 
     for (int n = 0; n < 102; n++)
       fillerTable[n][i] = NULL;
   }
+
+  for (int i = 0; i <= EQ_MLSE; i++)
+    eqCost[i] = 0.0f;
 }
 
 TransceiverState::~TransceiverState()
 {
+  delete mStats;
+  delete[] resetPending;
+  delete[] tscPending;
+  delete dataFormat;
+  delete[] rxMsg;
+
   for (int i = 0; i < 8; i++) {
     delete chanResponse[i];
     delete DFEForward[i];
@@ -71,6 +131,50 @@ TransceiverState::~TransceiverState()
   }
 }
 
+void TransceiverState::resetEqualizer(size_t tn)
+{
+  chanResponse[tn]->clear();
+  DFEForward[tn]->clear();
+  DFEFeedback[tn]->clear();
+  chanNoise[tn] = 0.0f;
+  chanEstimateTime[tn] = GSM::Time();
+  equalize[tn] = false;
+}
+
+void TransceiverState::requestReset(size_t tn)
+{
+  resetPending[tn] = true;
+}
+
+void TransceiverState::requestTsc(size_t tn, unsigned tsc, int vamos_tsc)
+{
+  tscPending[tn] = tsc | ((vamos_tsc + 1) << 8);
+  requestReset(tn);
+}
+
+void TransceiverState::setFormat(int format, unsigned soft_bits)
+{
+  *dataFormat = format | (soft_bits << 8);
+}
+
+void TransceiverState::applyReset(size_t tn)
+{
+  if (!resetPending[tn].exchange(false))
+    return;
+
+  int staged = tscPending[tn];
+  tsc[tn] = staged & 0xff;
+  vamosTsc[tn] = (staged >> 8) - 1;
+
+  resetEqualizer(tn);
+  SNRestimate[tn] = 0.0f;
+  chanRespOffset[tn] = 0.0f;
+  chanRespAmplitude[tn] = 0.0f;
+  freqOffset[tn] = 0.0f;
+  toaTrack[tn] = false;
+  toaTracked[tn] = 0;
+}
+
 bool TransceiverState::init(int filler, size_t sps, float scale, size_t rtsc, unsigned rach_delay)
 {
   signalVector *burst;
@@ -120,9 +224,13 @@ Transceiver::Transceiver(int wBasePort,
                          double wRssiOffset)
   : mBasePort(wBasePort), mLocalAddr(TRXAddress), mRemoteAddr(GSMcoreAddress),
     mClockSocket(TRXAddress, wBasePort, GSMcoreAddress, wBasePort + 100),
+    mReactorThread(NULL), mControlThread(NULL), mEpollFD(-1), mCtrlEpollFD(-1),
     mTransmitLatency(wTransmitLatency), mRadioInterface(wRadioInterface),
     rssiOffset(wRssiOffset),
-    mSPSTx(tx_sps), mSPSRx(rx_sps), mChans(chans), mEdge(false), mOn(false), mForceClockInterface(false),
+    mSPSTx(tx_sps), mSPSRx(rx_sps), mChans(chans), mEdge(false), mCombiner(COMBINE_SELECT),
+    mEqualizer(EQ_NONE), mEqBudget(0), mFreqCorrection(false),
+    mOn(false), mRunning(false),
+    mWarmRestart(false), mForceClockInterface(false),
     mTxFreq(0.0), mRxFreq(0.0), mTSC(0), mMaxExpectedDelayAB(0), mMaxExpectedDelayNB(0),
     mWriteBurstToDiskMask(0)
 {
@@ -137,15 +245,26 @@ Transceiver::Transceiver(int wBasePort,
 
 Transceiver::~Transceiver()
 {
+  Thread *threads[] = { mControlThread, mReactorThread };
+
+  for (int i = 0; i < 2; i++) {
+    if (threads[i]) {
+      threads[i]->cancel();
+      threads[i]->join();
+      delete threads[i];
+    }
+  }
+
   stop();
 
   sigProcLibDestroy();
 
-  for (size_t i = 0; i < mChans; i++) {
-    mControlServiceLoopThreads[i]->cancel();
-    mControlServiceLoopThreads[i]->join();
-    delete mControlServiceLoopThreads[i];
+  if (mEpollFD >= 0)
+    close(mEpollFD);
+  if (mCtrlEpollFD >= 0)
+    close(mCtrlEpollFD);
 
+  for (size_t i = 0; i < mTxPriorityQueues.size(); i++) {
     mTxPriorityQueues[i].clear();
     delete mCtrlSockets[i];
     delete mDataSockets[i];
@@ -155,13 +274,15 @@ Transceiver::~Transceiver()
 /*
  * Initialize transceiver
  *
- * Start or restart the control loop. Any further control is handled through the
+ * Start the socket threads. Any further control is handled through the
  * socket API. Randomize the central radio clock set the downlink burst
  * counters. Note that the clock will not update until the radio starts, but we
  * are still expected to report clock indications through control channel
  * activity.
  */
-bool Transceiver::init(int filler, size_t rtsc, unsigned rach_delay, bool edge)
+bool Transceiver::init(int filler, size_t rtsc, unsigned rach_delay, bool edge,
+                       int combiner, bool warm_restart, int equalizer,
+                       unsigned eq_budget, bool freq_correction)
 {
   int d_srcport, d_dstport, c_srcport, c_dstport;
 
@@ -170,17 +291,20 @@ bool Transceiver::init(int filler, size_t rtsc, unsigned rach_delay, bool edge)
     return false;
   }
 
-  if (!sigProcLibSetup()) {
+  if (!sigProcLibSetup(mSPSRx, edge)) {
     LOG(ALERT) << "Failed to initialize signal processing library";
     return false;
   }
 
   mEdge = edge;
+  mCombiner = combiner;
+  mWarmRestart = warm_restart;
+  mEqualizer = equalizer;
+  mEqBudget = eq_budget;
+  mFreqCorrection = freq_correction;
 
   mDataSockets.resize(mChans);
   mCtrlSockets.resize(mChans);
-  mControlServiceLoopThreads.resize(mChans);
-  mTxPriorityQueueServiceLoopThreads.resize(mChans);
   mRxServiceLoopThreads.resize(mChans);
 
   mTxPriorityQueues.resize(mChans);
@@ -202,6 +326,9 @@ bool Transceiver::init(int filler, size_t rtsc, unsigned rach_delay, bool edge)
     mDataSockets[i] = new UDPSocket(mLocalAddr.c_str(), d_srcport, mRemoteAddr.c_str(), d_dstport);
   }
 
+  if (!initReactor())
+    return false;
+
   /* Randomize the central clock */
   GSM::Time startTime(random() % gHyperframe, 0);
   mRadioInterface->getClock()->set(startTime);
@@ -209,19 +336,62 @@ bool Transceiver::init(int filler, size_t rtsc, unsigned rach_delay, bool edge)
   mLastClockUpdateTime = startTime;
   mLatencyUpdateTime = startTime;
 
-  /* Start control threads */
   for (size_t i = 0; i < mChans; i++) {
-    TransceiverChannel *chan = new TransceiverChannel(this, i);
-    mControlServiceLoopThreads[i] = new Thread(32768);
-    mControlServiceLoopThreads[i]->start((void * (*)(void*))
-                                 ControlServiceLoopAdapter, (void*) chan);
-
     if (i && filler == FILLER_DUMMY)
       filler = FILLER_ZERO;
 
     mStates[i].init(filler, mSPSTx, txFullScale, rtsc, rach_delay);
   }
 
+  /* Start the socket reactor, which modulates downlink bursts of all
+   * channels, and the control thread, which may block on the device */
+  mReactorThread = new Thread(32768);
+  mReactorThread->start((void * (*)(void*)) ReactorLoopAdapter, (void*) this);
+  mControlThread = new Thread(32768);
+  mControlThread->start((void * (*)(void*)) ControlLoopAdapter, (void*) this);
+
+  return true;
+}
+
+/*
+ * Register the data sockets of all channels with one epoll instance, and
+ * the control sockets with another
+ *
+ * Commands such as POWERON and RXTUNE block on the device, so they are
+ * served on their own thread and never hold up downlink modulation.
+ * Sockets are non-blocking so that each thread can drain one up to a batch
+ * limit per wakeup. The event tag carries the channel number and whether
+ * the socket is a control socket.
+ */
+bool Transceiver::initReactor()
+{
+  struct epoll_event event;
+
+  mEpollFD = epoll_create1(EPOLL_CLOEXEC);
+  mCtrlEpollFD = epoll_create1(EPOLL_CLOEXEC);
+  if ((mEpollFD < 0) || (mCtrlEpollFD < 0)) {
+    LOG(ALERT) << "Failed to create epoll instance: " << strerror(errno);
+    return false;
+  }
+
+  for (size_t i = 0; i < mChans; i++) {
+    UDPSocket *socks[] = { mDataSockets[i], mCtrlSockets[i] };
+    int fds[] = { mEpollFD, mCtrlEpollFD };
+
+    for (int ctrl = 0; ctrl < 2; ctrl++) {
+      socks[ctrl]->nonblocking();
+
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.u32 = (i << 1) | ctrl;
+
+      if (epoll_ctl(fds[ctrl], EPOLL_CTL_ADD, socks[ctrl]->fd(), &event) < 0) {
+        LOG(ALERT) << "Failed to register socket: " << strerror(errno);
+        return false;
+      }
+    }
+  }
+
   return true;
 }
 
@@ -230,7 +400,9 @@ bool Transceiver::init(int filler, size_t rtsc, unsigned rach_delay, bool edge)
  *
  * Submit command(s) to the radio device to commence streaming samples and
  * launch threads to handle sample I/O. Re-synchronize the transmit burst
- * counters to the central radio clock here as well.
+ * counters to the central radio clock here as well. After a warm restart
+ * POWEROFF the device and threads are still running, in which case only
+ * burst processing is resumed.
  */
 bool Transceiver::start()
 {
@@ -241,6 +413,13 @@ bool Transceiver::start()
     return true;
   }
 
+  if (mRunning) {
+    LOG(NOTICE) << "Resuming the transceiver";
+    mForceClockInterface = true;
+    mOn = true;
+    return true;
+  }
+
   LOG(NOTICE) << "Starting the transceiver";
 
   GSM::Time time = mRadioInterface->getClock()->get();
@@ -261,20 +440,17 @@ bool Transceiver::start()
   mRxLowerLoopThread->start((void * (*)(void*))
                             RxLowerLoopAdapter,(void*) this);
 
-  /* Launch uplink and downlink burst processing threads */
+  /* Launch uplink burst processing threads, downlink bursts are
+   * modulated as they arrive on the socket reactor */
   for (size_t i = 0; i < mChans; i++) {
     TransceiverChannel *chan = new TransceiverChannel(this, i);
     mRxServiceLoopThreads[i] = new Thread(32768);
     mRxServiceLoopThreads[i]->start((void * (*)(void*))
                             RxUpperLoopAdapter, (void*) chan);
-
-    chan = new TransceiverChannel(this, i);
-    mTxPriorityQueueServiceLoopThreads[i] = new Thread(32768);
-    mTxPriorityQueueServiceLoopThreads[i]->start((void * (*)(void*))
-                            TxUpperLoopAdapter, (void*) chan);
   }
 
   mForceClockInterface = true;
+  mRunning = true;
   mOn = true;
   return true;
 }
@@ -292,7 +468,7 @@ void Transceiver::stop()
 {
   ScopedLock lock(mLock);
 
-  if (!mOn)
+  if (!mRunning)
     return;
 
   LOG(NOTICE) << "Stopping the transceiver";
@@ -303,27 +479,55 @@ void Transceiver::stop()
   delete mTxLowerLoopThread;
   delete mRxLowerLoopThread;
 
-  for (size_t i = 0; i < mChans; i++) {
+  for (size_t i = 0; i < mChans; i++)
     mRxServiceLoopThreads[i]->cancel();
-    mTxPriorityQueueServiceLoopThreads[i]->cancel();
-  }
 
   LOG(INFO) << "Stopping the device";
   mRadioInterface->stop();
 
   for (size_t i = 0; i < mChans; i++) {
     mRxServiceLoopThreads[i]->join();
-    mTxPriorityQueueServiceLoopThreads[i]->join();
     delete mRxServiceLoopThreads[i];
-    delete mTxPriorityQueueServiceLoopThreads[i];
+    mStates[i].rxLen = 0;
 
     mTxPriorityQueues[i].clear();
+    mStates[i].setFormat(TRXD_LEGACY, 8);
   }
 
   mOn = false;
+  mRunning = false;
   LOG(NOTICE) << "Transceiver stopped";
 }
 
+/*
+ * Power off the transceiver
+ *
+ * With warm restart the device keeps streaming and all threads keep running,
+ * so that clocks, buffers and alignment survive until the next POWERON.
+ * Received bursts are dropped and zeros are transmitted in the meantime.
+ * Otherwise this is a full stop.
+ */
+void Transceiver::powerOff()
+{
+  if (!mWarmRestart) {
+    stop();
+    return;
+  }
+
+  ScopedLock lock(mLock);
+
+  if (!mOn)
+    return;
+
+  LOG(NOTICE) << "Idling the transceiver, device keeps running";
+  mOn = false;
+
+  for (size_t i = 0; i < mChans; i++) {
+    mTxPriorityQueues[i].clear();
+    mStates[i].setFormat(TRXD_LEGACY, 8);
+  }
+}
+
 void Transceiver::addRadioVector(size_t chan, BitVector &bits,
                                  int RSSI, GSM::Time &wTime)
 {
@@ -389,7 +593,7 @@ void Transceiver::pushRadioVector(GSM::Time &nowTime)
     modFN = nowTime.FN() % state->fillerModulus[TN];
 
     bursts[i] = state->fillerTable[modFN][TN];
-    zeros[i] = state->chanType[TN] == NONE;
+    zeros[i] = !mOn || (state->chanType[TN] == NONE);
 
     if ((burst = mTxPriorityQueues[i].getCurrentBurst(nowTime))) {
       bursts[i] = burst->getVector();
@@ -413,6 +617,47 @@ void Transceiver::pushRadioVector(GSM::Time &nowTime)
   }
 }
 
+/*
+ * Idle carrier fast path. When no channel has a burst queued for the frame
+ * starting at the given time, all eight timeslots are taken from the filler
+ * table and handed to the radio interface in one step. Idleness is decided
+ * at the timeslot 0 deadline. Clock indications run two frames ahead of
+ * the deadline clock, so a burst for any timeslot of this frame that has
+ * not arrived yet was already sent late.
+ */
+bool Transceiver::pushRadioFrame(GSM::Time &nowTime)
+{
+  int modFN;
+  TransceiverState *state;
+  std::vector<std::vector<signalVector *> > bursts(8);
+  std::vector<std::vector<bool> > zeros(8);
+
+  if (nowTime.TN())
+    return false;
+
+  for (size_t i = 0; i < mChans; i++) {
+    if (!mTxPriorityQueues[i].idleFrame(nowTime))
+      return false;
+  }
+
+  for (size_t tn = 0; tn < 8; tn++) {
+    bursts[tn].resize(mChans);
+    zeros[tn].resize(mChans);
+
+    for (size_t i = 0; i < mChans; i++) {
+      state = &mStates[i];
+      modFN = nowTime.FN() % state->fillerModulus[tn];
+
+      bursts[tn][i] = state->fillerTable[modFN][tn];
+      zeros[tn][i] = !mOn || (state->chanType[tn] == NONE);
+    }
+  }
+
+  mRadioInterface->driveTransmitFrame(bursts, zeros);
+
+  return true;
+}
+
 void Transceiver::setModulus(size_t timeslot, size_t chan)
 {
   TransceiverState *state = &mStates[chan];
@@ -545,11 +790,12 @@ void writeToFile(radioVector *radio_burst, size_t chan)
 
 /*
  * Pull bursts from the FIFO and handle according to the slot
- * and burst correlation type. Equalzation is currently disabled.
+ * and burst correlation type. Normal bursts go through the configured
+ * equalizer and frequency correction before plain demodulation.
  */
 SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime, double &RSSI, bool &isRssiValid,
                                          double &timingOffset, double &noise,
-                                         size_t chan)
+                                         SoftVector *&vamosBurst, size_t chan)
 {
   int rc;
   complex amp;
@@ -559,6 +805,7 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime, double &RSSI, bool &i
   SoftVector *bits = NULL;
   TransceiverState *state = &mStates[chan];
   isRssiValid = false;
+  vamosBurst = NULL;
 
   /* Blocking FIFO read */
   radioVector *radio_burst = mReceiveFIFO[chan]->read();
@@ -567,6 +814,7 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime, double &RSSI, bool &i
 
   /* Set time and determine correlation type */
   GSM::Time time = radio_burst->getTime();
+  wTime = time;
   CorrType type = expectedCorrType(time, chan);
 
   /* Enable 8-PSK burst detection if EDGE is enabled */
@@ -579,9 +827,9 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime, double &RSSI, bool &i
   if (mWriteBurstToDiskMask & ((1<<time.TN()) << (8*chan)))
     writeToFile(radio_burst, chan);
 
-  /* No processing if the timeslot is off.
+  /* No processing if powered off or if the timeslot is off.
    * Not even power level or noise calculation. */
-  if (type == OFF) {
+  if (!mOn || (type == OFF)) {
     delete radio_burst;
     return NULL;
   }
@@ -606,7 +854,6 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime, double &RSSI, bool &i
   burst = radio_burst->getVector(max_i);
   avg = sqrt(avg / radio_burst->chans());
 
-  wTime = time;
   RSSI = 20.0 * log10(rxFullScale / avg);
 
   /* RSSI estimation are valid */
@@ -614,28 +861,82 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime, double &RSSI, bool &i
 
   if (type == IDLE) {
     /* Update noise levels */
-    state->mNoises.insert(avg);
-    state->mNoiseLev = state->mNoises.avg();
-    noise = 20.0 * log10(rxFullScale / state->mNoiseLev);
+    state->mStats->noise.update(avg);
+    noise = 20.0 * log10(rxFullScale / state->mStats->noise.mean());
 
     delete radio_burst;
     return NULL;
   } else {
     /* Do not update noise levels */
-    noise = 20.0 * log10(rxFullScale / state->mNoiseLev);
+    noise = 20.0 * log10(rxFullScale / state->mStats->noise.mean());
+  }
+
+  SlotStats &stats = state->mStats->slots[time.TN()];
+  stats.rssi(RSSI);
+
+  /* Forget timing, frequency and equalizer state of a reconfigured slot */
+  state->applyReset(time.TN());
+  unsigned tsc = state->tsc[time.TN()];
+
+  /* Two users share the timeslot on VAMOS subchannels */
+  if ((state->vamosTsc[time.TN()] >= 0) && (type != RACH)) {
+    unsigned tscs[2] = { tsc, (unsigned) state->vamosTsc[time.TN()] };
+
+    bits = separateRadioVector(*burst, tscs, timingOffset, vamosBurst);
+    if (bits || vamosBurst)
+      stats.detected(timingOffset);
+    else
+      stats.missed();
+
+    delete radio_burst;
+    return bits;
   }
 
-  /* Detect normal or RACH bursts */
-  rc = detectAnyBurst(*burst, mTSC, BURST_THRESH, mSPSRx, type, amp, toa,
-                      (type==RACH)?mMaxExpectedDelayAB:mMaxExpectedDelayNB);
+  /* Combine all diversity paths instead of the strongest one */
+  if ((mCombiner == COMBINE_MRC) && (radio_burst->chans() > 1)) {
+    bits = combineRadioVector(radio_burst, type, tsc, timingOffset);
+    if (bits)
+      stats.detected(timingOffset);
+    else
+      stats.missed();
+
+    delete radio_burst;
+    return bits;
+  }
+
+  /* Detect normal or RACH bursts, first around the tracked timing */
+  unsigned max_toa = (type==RACH)?mMaxExpectedDelayAB:mMaxExpectedDelayNB;
+  float lo, hi;
+
+  rc = SIGERR_NONE;
+  if ((type != RACH) && state->toaTrack[time.TN()] &&
+      (time - state->toaTime[time.TN()] < TOA_TRACK_FRAMES) &&
+      (state->toaTracked[time.TN()] < TOA_CONFIRM_BURSTS) &&
+      stats.toaWindow(lo, hi) && (hi - lo < max_toa)) {
+    rc = detectBurstWindow(*burst, tsc, BURST_THRESH, mSPSRx, type,
+                           amp, toa, max_toa, lo, hi);
+    stats.tracked(rc > 0);
+  }
+
+  if (rc > 0) {
+    state->toaTracked[time.TN()]++;
+  } else {
+    state->toaTracked[time.TN()] = 0;
+    rc = detectAnyBurst(*burst, tsc, BURST_THRESH, mSPSRx, type, amp, toa,
+                        max_toa);
+  }
 
   if (rc > 0) {
     type = (CorrType) rc;
   } else if (rc <= 0) {
     if (rc == -SIGERR_CLIP) {
       LOG(WARNING) << "Clipping detected on received RACH or Normal Burst";
+      stats.clipped();
     } else if (rc != SIGERR_NONE) {
       LOG(WARNING) << "Unhandled RACH or Normal Burst detection error";
+      stats.missed();
+    } else {
+      stats.missed();
     }
 
     delete radio_burst;
@@ -643,13 +944,200 @@ SoftVector *Transceiver::pullRadioVector(GSM::Time &wTime, double &RSSI, bool &i
   }
 
   timingOffset = toa;
+  stats.detected(toa);
+
+  float level = state->mStats->noise.mean();
+  state->SNRestimate[time.TN()] = level > 0.0f ?
+    20.0f * log10f(amp.abs() / level) : 0.0f;
+  state->chanRespOffset[time.TN()] = toa;
+  state->chanRespAmplitude[time.TN()] = amp;
+
+  if (type != RACH) {
+    state->toaTime[time.TN()] = time;
+    state->toaTrack[time.TN()] = true;
+  }
 
-  bits = demodAnyBurst(*burst, mSPSRx, amp, toa, type);
+  if ((mEqualizer != EQ_NONE) && (type == TSC))
+    bits = equalizeRadioVector(*burst, time, tsc, toa, chan);
+
+  /* Correct the carrier frequency offset tracked on the timeslot */
+  if (!bits && mFreqCorrection && (type == TSC)) {
+    bits = new SoftVector();
+    if (!demodOffsetBurst(*burst, mSPSRx, tsc, amp, toa,
+                          state->freqOffset[time.TN()], *bits)) {
+      delete bits;
+      bits = NULL;
+    }
+  }
+
+  if (!bits)
+    bits = demodAnyBurst(*burst, mSPSRx, amp, toa, type);
 
   delete radio_burst;
   return bits;
 }
 
+/*
+ * Detect the burst on each diversity path and demodulate with maximal ratio
+ * combining over the paths where it was found, using the detection channel
+ * estimates as combining weights. The burst type and timing offset are
+ * reported from the strongest path.
+ */
+SoftVector *Transceiver::combineRadioVector(radioVector *radio_burst,
+                                            CorrType type, unsigned tsc,
+                                            double &timingOffset)
+{
+  int rc, best_type = SIGERR_NONE;
+  float toa, best = -1.0;
+  complex amp;
+  std::vector<const signalVector *> bursts;
+  std::vector<complex> amps;
+  std::vector<float> toas;
+  unsigned max_toa = (type==RACH)?mMaxExpectedDelayAB:mMaxExpectedDelayNB;
+
+  for (size_t i = 0; i < radio_burst->chans(); i++) {
+    const signalVector *burst = radio_burst->getVector(i);
+
+    rc = detectAnyBurst(*burst, tsc, BURST_THRESH, mSPSRx, type, amp, toa,
+                        max_toa);
+    if (rc <= 0) {
+      if (rc == -SIGERR_CLIP) {
+        LOG(WARNING) << "Clipping detected on diversity path " << i;
+      } else if (rc != SIGERR_NONE) {
+        LOG(WARNING) << "Unhandled RACH or Normal Burst detection error";
+      }
+      continue;
+    }
+
+    if (amp.norm2() > best) {
+      best = amp.norm2();
+      best_type = rc;
+      timingOffset = toa;
+    }
+
+    bursts.push_back(burst);
+    amps.push_back(amp);
+    toas.push_back(toa);
+  }
+
+  if (bursts.empty())
+    return NULL;
+
+  return demodDiversityBurst(bursts, mSPSRx, amps, toas,
+                             (CorrType) best_type);
+}
+
+/*
+ * Equalize timeslots whose channel estimate shows multipath beyond the GMSK
+ * pulse. Estimates and DFE filters are cached per timeslot and updated by
+ * every equalized burst, while other timeslots are only probed now and
+ * then. The configured equalizer steps down to a cheaper one, or to none,
+ * while its average processing time exceeds the budget.
+ */
+SoftVector *Transceiver::equalizeRadioVector(const signalVector &burst,
+                                             GSM::Time time, unsigned tsc,
+                                             float toa, size_t chan)
+{
+  TransceiverState *state = &mStates[chan];
+  size_t tn = time.TN();
+  int type = mEqualizer;
+
+  /* Costs over budget decay, so that a costlier equalizer is retried */
+  while (mEqBudget && (type > EQ_NONE) && (state->eqCost[type] > mEqBudget)) {
+    state->eqCost[type] *= 1.0f - EQ_COST_ALPHA;
+    type--;
+  }
+  if (type == EQ_NONE)
+    return NULL;
+
+  if (!state->equalize[tn]) {
+    if (state->chanResponse[tn]->size() &&
+        (time - state->chanEstimateTime[tn] < EQ_PROBE_FRAMES))
+      return NULL;
+
+    state->chanEstimateTime[tn] = time;
+    if (!estimateChannel(burst, mSPSRx, tsc, toa, *state->chanResponse[tn],
+                         state->chanNoise[tn]) ||
+        (channelSpread(*state->chanResponse[tn]) < EQ_SPREAD_THRESH))
+      return NULL;
+
+    /* Filters of an earlier channel no longer apply */
+    state->DFEForward[tn]->clear();
+    state->equalize[tn] = true;
+  }
+
+  struct timespec start, end;
+  SoftVector *bits = new SoftVector();
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bool ok = equalizeBurst(burst, mSPSRx, tsc, toa, (EqualizerType) type,
+                          *state->chanResponse[tn], state->chanNoise[tn],
+                          *state->DFEForward[tn], *state->DFEFeedback[tn],
+                          *bits);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  float cost = (end.tv_sec - start.tv_sec) * 1e6 +
+               (end.tv_nsec - start.tv_nsec) * 1e-3;
+  state->eqCost[type] += (cost - state->eqCost[type]) * EQ_COST_ALPHA;
+  state->chanEstimateTime[tn] = time;
+
+  if (!ok) {
+    delete bits;
+    state->resetEqualizer(tn);
+    return NULL;
+  }
+
+  /* Stop once the channel has settled to a single path */
+  if (channelSpread(*state->chanResponse[tn]) < EQ_SPREAD_THRESH)
+    state->equalize[tn] = false;
+
+  return bits;
+}
+
+/*
+ * Detect both users of a VAMOS timeslot on the strongest diversity path and
+ * demodulate them jointly at their common timing offset. Either user may be
+ * missing, in which case only the bits of the other one are returned.
+ */
+SoftVector *Transceiver::separateRadioVector(const signalVector &burst,
+                                             const unsigned tsc[2],
+                                             double &timingOffset,
+                                             SoftVector *&vamosBurst)
+{
+  BurstDetection results[2];
+  SoftVector *bits[2];
+
+  detectVamosBurst(burst, tsc, BURST_THRESH, mSPSRx, mMaxExpectedDelayNB,
+                   results);
+
+  if ((results[0].rc <= 0) && (results[1].rc <= 0)) {
+    if ((results[0].rc == -SIGERR_CLIP) || (results[1].rc == -SIGERR_CLIP))
+      LOG(WARNING) << "Clipping detected on received VAMOS burst";
+    return NULL;
+  }
+
+  timingOffset = results[results[0].rc > 0 ? 0 : 1].toa;
+
+  bits[0] = new SoftVector();
+  bits[1] = new SoftVector();
+
+  if (!demodVamosBurst(burst, mSPSRx, tsc, timingOffset, *bits[0], *bits[1])) {
+    delete bits[0];
+    delete bits[1];
+    return NULL;
+  }
+
+  for (int u = 0; u < 2; u++) {
+    if (results[u].rc <= 0) {
+      delete bits[u];
+      bits[u] = NULL;
+    }
+  }
+
+  vamosBurst = bits[1];
+  return bits[0];
+}
+
 void Transceiver::reset()
 {
   for (size_t i = 0; i < mTxPriorityQueues.size(); i++)
@@ -657,222 +1145,277 @@ void Transceiver::reset()
 }
 
 
-void Transceiver::driveControl(size_t chan)
+bool Transceiver::driveControl(size_t chan)
 {
-  int MAX_PACKET_LENGTH = 100;
+  char buffer[CTRL_MAX_LEN];
+  char response[CTRL_MAX_LEN];
+  CtrlCommand cmd;
 
   // check control socket
-  char buffer[MAX_PACKET_LENGTH];
-  int msgLen = -1;
-  buffer[0] = '\0';
-
-  msgLen = mCtrlSockets[chan]->read(buffer, sizeof(buffer));
+  int msgLen = mCtrlSockets[chan]->read(buffer, sizeof(buffer));
 
   if (msgLen < 1) {
-    return;
+    return false;
   }
 
-  char cmdcheck[4];
-  char command[MAX_PACKET_LENGTH];
-  char response[MAX_PACKET_LENGTH];
-
-  sscanf(buffer,"%3s %s",cmdcheck,command);
-
-  if (strcmp(cmdcheck,"CMD")!=0) {
+  if (!parseCtrlCommand(buffer, msgLen, cmd)) {
     LOG(WARNING) << "bogus message on control interface";
-    return;
+    return true;
   }
-  LOG(INFO) << "command is " << buffer;
-
-  if (strcmp(command,"POWEROFF")==0) {
-    stop();
-    sprintf(response,"RSP POWEROFF 0");
+  LOG(INFO) << "command is " << std::string(buffer, strnlen(buffer, msgLen));
+
+  /* Responses echo the command arguments unless replaced below */
+  int status = 0;
+  int *argv = cmd.argv;
+  int argc = cmd.argc;
+  int stats[10];
+
+  if (argc < ctrlCommandArgs(cmd.cmd)) {
+    LOG(WARNING) << "missing arguments to " << ctrlCommandName(cmd.cmd)
+                 << " on control interface";
+    mCtrlSockets[chan]->write(response,
+        formatCtrlResponse(response, sizeof(response), cmd.cmd, 1, argv, argc));
+    return true;
   }
-  else if (strcmp(command,"POWERON")==0) {
+
+  switch (cmd.cmd) {
+  case CTRL_POWEROFF:
+    powerOff();
+    break;
+  case CTRL_POWERON:
     if (!start()) {
-      sprintf(response,"RSP POWERON 1");
+      status = 1;
     } else {
-      sprintf(response,"RSP POWERON 0");
       for (int i = 0; i < 8; i++) {
         for (int j = 0; j < 8; j++)
           mHandover[i][j] = false;
       }
     }
-  }
-  else if (strcmp(command,"HANDOVER")==0){
-    int ts=0,ss=0;
-    sscanf(buffer,"%3s %s %d %d",cmdcheck,command,&ts,&ss);
-    mHandover[ts][ss] = true;
-    sprintf(response,"RSP HANDOVER 0 %d %d",ts,ss);
-  }
-  else if (strcmp(command,"NOHANDOVER")==0){
-    int ts=0,ss=0;
-    sscanf(buffer,"%3s %s %d %d",cmdcheck,command,&ts,&ss);
-    mHandover[ts][ss] = false;
-    sprintf(response,"RSP NOHANDOVER 0 %d %d",ts,ss);
-  }
-  else if (strcmp(command,"SETMAXDLY")==0) {
-    //set expected maximum time-of-arrival
-    int maxDelay;
-    sscanf(buffer,"%3s %s %d",cmdcheck,command,&maxDelay);
-    mMaxExpectedDelayAB = maxDelay; // 1 GSM symbol is approx. 1 km
-    sprintf(response,"RSP SETMAXDLY 0 %d",maxDelay);
-  }
-  else if (strcmp(command,"SETMAXDLYNB")==0) {
+    break;
+  case CTRL_HANDOVER:
+  case CTRL_NOHANDOVER:
+    if ((unsigned) argv[0] > 7 || (unsigned) argv[1] > 7) {
+      LOG(WARNING) << "bogus message on control interface";
+      status = 1;
+      break;
+    }
+    mHandover[argv[0]][argv[1]] = cmd.cmd == CTRL_HANDOVER;
+    break;
+  case CTRL_SETMAXDLY:
     //set expected maximum time-of-arrival
-    int maxDelay;
-    sscanf(buffer,"%3s %s %d",cmdcheck,command,&maxDelay);
-    mMaxExpectedDelayNB = maxDelay; // 1 GSM symbol is approx. 1 km
-    sprintf(response,"RSP SETMAXDLYNB 0 %d",maxDelay);
-  }
-  else if (strcmp(command,"SETRXGAIN")==0) {
+    mMaxExpectedDelayAB = argv[0]; // 1 GSM symbol is approx. 1 km
+    break;
+  case CTRL_SETMAXDLYNB:
     //set expected maximum time-of-arrival
-    int newGain;
-    sscanf(buffer,"%3s %s %d",cmdcheck,command,&newGain);
-    newGain = mRadioInterface->setRxGain(newGain, chan);
-    sprintf(response,"RSP SETRXGAIN 0 %d",newGain);
-  }
-  else if (strcmp(command,"NOISELEV")==0) {
+    mMaxExpectedDelayNB = argv[0]; // 1 GSM symbol is approx. 1 km
+    break;
+  case CTRL_SETRXGAIN:
+    argv[0] = mRadioInterface->setRxGain(argv[0], chan);
+    break;
+  case CTRL_NOISELEV:
+    argc = 1;
     if (mOn) {
-      float lev = mStates[chan].mNoiseLev;
-      sprintf(response,"RSP NOISELEV 0 %d",
-              (int) round(20.0 * log10(rxFullScale / lev)));
-    }
-    else {
-      sprintf(response,"RSP NOISELEV 1  0");
+      float lev = mStates[chan].mStats->noise.mean();
+      argv[0] = (int) round(20.0 * log10(rxFullScale / lev));
+    } else {
+      status = 1;
+      argv[0] = 0;
     }
-  }
-  else if (!strcmp(command, "SETPOWER")) {
-    int power;
-    sscanf(buffer, "%3s %s %d", cmdcheck, command, &power);
-    power = mRadioInterface->setPowerAttenuation(power, chan);
-    mStates[chan].mPower = power;
-    sprintf(response, "RSP SETPOWER 0 %d", power);
-  }
-  else if (!strcmp(command,"ADJPOWER")) {
-    int power, step;
-    sscanf(buffer, "%3s %s %d", cmdcheck, command, &step);
-    power = mStates[chan].mPower + step;
-    power = mRadioInterface->setPowerAttenuation(power, chan);
-    mStates[chan].mPower = power;
-    sprintf(response, "RSP ADJPOWER 0 %d", power);
-  }
-  else if (strcmp(command,"RXTUNE")==0) {
+    break;
+  case CTRL_SETPOWER:
+    argv[0] = mRadioInterface->setPowerAttenuation(argv[0], chan);
+    mStates[chan].mPower = argv[0];
+    break;
+  case CTRL_ADJPOWER:
+    argv[0] = mRadioInterface->setPowerAttenuation(mStates[chan].mPower + argv[0], chan);
+    mStates[chan].mPower = argv[0];
+    break;
+  case CTRL_RXTUNE:
     // tune receiver
-    int freqKhz;
-    sscanf(buffer,"%3s %s %d",cmdcheck,command,&freqKhz);
-    mRxFreq = freqKhz * 1e3;
+    mRxFreq = argv[0] * 1e3;
     if (!mRadioInterface->tuneRx(mRxFreq, chan)) {
        LOG(ALERT) << "RX failed to tune";
-       sprintf(response,"RSP RXTUNE 1 %d",freqKhz);
+       status = 1;
     }
-    else
-       sprintf(response,"RSP RXTUNE 0 %d",freqKhz);
-  }
-  else if (strcmp(command,"TXTUNE")==0) {
+    break;
+  case CTRL_TXTUNE:
     // tune txmtr
-    int freqKhz;
-    sscanf(buffer,"%3s %s %d",cmdcheck,command,&freqKhz);
-    mTxFreq = freqKhz * 1e3;
+    mTxFreq = argv[0] * 1e3;
     if (!mRadioInterface->tuneTx(mTxFreq, chan)) {
        LOG(ALERT) << "TX failed to tune";
-       sprintf(response,"RSP TXTUNE 1 %d",freqKhz);
+       status = 1;
     }
-    else
-       sprintf(response,"RSP TXTUNE 0 %d",freqKhz);
-  }
-  else if (!strcmp(command,"SETTSC")) {
+    break;
+  case CTRL_SETTSC:
     // set TSC
-    unsigned TSC;
-    sscanf(buffer, "%3s %s %d", cmdcheck, command, &TSC);
-    if (TSC > 7) {
-      sprintf(response, "RSP SETTSC 1 %d", TSC);
+    if ((unsigned) argv[0] > 7) {
+      status = 1;
     } else {
-      LOG(NOTICE) << "Changing TSC from " << mTSC << " to " << TSC;
-      mTSC = TSC;
-      sprintf(response,"RSP SETTSC 0 %d", TSC);
+      LOG(NOTICE) << "Changing TSC from " << mTSC << " to " << argv[0];
+      mTSC = argv[0];
+
+      for (size_t i = 0; i < mChans; i++) {
+        for (int tn = 0; tn < 8; tn++)
+          mStates[i].requestTsc(tn, mTSC, -1);
+      }
     }
-  }
-  else if (strcmp(command,"SETSLOT")==0) {
+    break;
+  case CTRL_SETSLOT:
     // set slot type
-    int  corrCode;
-    int  timeslot;
-    sscanf(buffer,"%3s %s %d %d",cmdcheck,command,&timeslot,&corrCode);
-    if ((timeslot < 0) || (timeslot > 7)) {
+    if ((unsigned) argv[0] > 7 || (unsigned) argv[1] > LOOPBACK) {
       LOG(WARNING) << "bogus message on control interface";
-      sprintf(response,"RSP SETSLOT 1 %d %d",timeslot,corrCode);
-      return;
+      status = 1;
+      break;
     }
-    mStates[chan].chanType[timeslot] = (ChannelCombination) corrCode;
-    setModulus(timeslot, chan);
-    sprintf(response,"RSP SETSLOT 0 %d %d",timeslot,corrCode);
-
-  }
-  else if (strcmp(command,"_SETBURSTTODISKMASK")==0) {
+    mStates[chan].chanType[argv[0]] = (ChannelCombination) argv[1];
+    mStates[chan].requestReset(argv[0]);
+    setModulus(argv[0], chan);
+    break;
+  case CTRL_SETBURSTTODISKMASK:
     // debug command! may change or disapear without notice
     // set a mask which bursts to dump to disk
-    int mask;
-    sscanf(buffer,"%3s %s %d",cmdcheck,command,&mask);
-    mWriteBurstToDiskMask = mask;
-    sprintf(response,"RSP _SETBURSTTODISKMASK 0 %d",mask);
-  }
-  else {
-    LOG(WARNING) << "bogus command " << command << " on control interface.";
-    sprintf(response,"RSP ERR 1");
+    mWriteBurstToDiskMask = argv[0];
+    break;
+  case CTRL_SETSUBTSC:
+    // set the TSC of a timeslot, and of its second VAMOS subchannel if any
+    if ((unsigned) argv[0] > 7 || (unsigned) argv[1] > 7 ||
+        (argc > 2 && ((unsigned) argv[2] > 7 || argv[2] == argv[1]))) {
+      LOG(WARNING) << "bogus message on control interface";
+      status = 1;
+      break;
+    }
+    // subchannels are only separated on GMSK bursts at 1 or 4 sps
+    if ((argc > 2) && ((mSPSRx == 2) || mEdge)) {
+      LOG(WARNING) << "VAMOS not supported with EDGE or 2 sps receive";
+      status = 1;
+      break;
+    }
+    mStates[chan].requestTsc(argv[0], argv[1], (argc > 2) ? argv[2] : -1);
+    break;
+  case CTRL_SETFORMAT:
+    // set the TRXD format, and the uplink soft bit width of packed bursts
+    if ((unsigned) argv[0] > TRXD_PACKED ||
+        (argc > 1 && argv[1] != 4 && argv[1] != 8)) {
+      LOG(WARNING) << "bogus message on control interface";
+      status = 1;
+      break;
+    }
+    mStates[chan].setFormat(argv[0], (argc > 1) ? argv[1] : 8);
+    break;
+  case CTRL_GETSTATS:
+    // timeslot, bursts, detection rate in 1/1000, clipped bursts,
+    // RSSI and noise in dB below full scale, TOA in 1/256 symbols,
+    // tracked timing window hits and misses, frequency offset in Hz
+    if ((unsigned) argv[0] > 7) {
+      status = 1;
+    } else {
+      const SlotStats &slot = mStates[chan].mStats->slots[argv[0]];
+      float noise = mStates[chan].mStats->noise.mean();
+
+      stats[0] = argv[0];
+      stats[1] = slot.bursts();
+      stats[2] = (int) round(slot.detectRate() * 1000.0);
+      stats[3] = slot.clips();
+      stats[4] = (int) round(slot.rssiAvg.ewma());
+      stats[5] = noise > 0.0 ? (int) round(20.0 * log10(rxFullScale / noise)) : 0;
+      stats[6] = (int) round(slot.toaAvg.ewma() * 256.0);
+      stats[7] = slot.trackHits();
+      stats[8] = slot.trackMisses();
+      stats[9] = (int) round(mStates[chan].freqOffset[argv[0]]);
+      argv = stats;
+      argc = 10;
+    }
+    break;
+  default:
+    LOG(WARNING) << "bogus command " << std::string(cmd.name, cmd.nameLen)
+                 << " on control interface.";
+    status = 1;
+    argc = 0;
   }
 
-  mCtrlSockets[chan]->write(response, strlen(response) + 1);
+  mCtrlSockets[chan]->write(response,
+      formatCtrlResponse(response, sizeof(response), cmd.cmd, status, argv, argc));
+  return true;
 }
 
 bool Transceiver::driveTxPriorityQueue(size_t chan)
 {
-  int burstLen;
-  char buffer[EDGE_BURST_NBITS + 50];
+  char buffer[TRXD_MAX_LEN];
+  TrxdBurst bursts[TRXD_MAX_BATCH];
 
   // check data socket
-  size_t msgLen = mDataSockets[chan]->read(buffer, sizeof(buffer));
+  int msgLen = mDataSockets[chan]->read(buffer, sizeof(buffer));
 
-  if (msgLen == gSlotLen + 1 + 4 + 1) {
-    burstLen = gSlotLen;
-  } else if (msgLen == EDGE_BURST_NBITS + 1 + 4 + 1) {
-    if (mSPSTx != 4)
-      return false;
+  if (msgLen < 0)
+    return false;
 
-    burstLen = EDGE_BURST_NBITS;
-  } else {
+  int count = parseTrxdBursts(buffer, msgLen, *mStates[chan].dataFormat & 0xff,
+                              bursts, TRXD_MAX_BATCH);
+  if (count < 0) {
     LOG(ERR) << "badly formatted packet on GSM->TRX interface";
-    return false;
+    return true;
   }
 
-  int timeSlot = (int) buffer[0];
-  uint64_t frameNum = 0;
-  for (int i = 0; i < 4; i++)
-    frameNum = (frameNum << 8) | (0x0ff & buffer[i+1]);
+  /* Not transmitting, drop the bursts instead of queueing them */
+  if (!mOn)
+    return true;
+
+  for (int i = 0; i < count; i++) {
+    if (bursts[i].nbits == EDGE_BURST_NBITS && mSPSTx != 4)
+      continue;
 
-  LOG(DEBUG) << "rcvd. burst at: " << GSM::Time(frameNum,timeSlot);
+    GSM::Time currTime = GSM::Time(bursts[i].fn, bursts[i].tn);
 
-  int RSSI = (int) buffer[5];
-  BitVector newBurst(burstLen);
-  BitVector::iterator itr = newBurst.begin();
-  char *bufferItr = buffer+6;
-  while (itr < newBurst.end())
-    *itr++ = *bufferItr++;
+    LOG(DEBUG) << "rcvd. burst at: " << currTime;
 
-  GSM::Time currTime = GSM::Time(frameNum,timeSlot);
+    BitVector newBurst(bursts[i].nbits);
+    trxdBurstBits(bursts[i], newBurst);
 
-  addRadioVector(chan, newBurst, RSSI, currTime);
+    addRadioVector(chan, newBurst, bursts[i].power, currTime);
+  }
 
   return true;
+}
+
+/*
+ * Wait for traffic on the control or the data sockets and serve it. Each
+ * ready socket is drained up to a batch limit so that one busy channel
+ * cannot starve the others; leftovers are picked up on the next wakeup.
+ */
+void Transceiver::driveReactor(bool ctrl)
+{
+  struct epoll_event events[REACTOR_EVENTS];
+
+  int num = epoll_wait(ctrl ? mCtrlEpollFD : mEpollFD, events,
+                       REACTOR_EVENTS, -1);
+  if (num < 0) {
+    if (errno != EINTR)
+      LOG(ERR) << "Socket reactor wait failed: " << strerror(errno);
+    return;
+  }
+
+  /* Commands take the transceiver lock, so only cancel while waiting */
+  int state;
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
 
+  for (int i = 0; i < num; i++) {
+    size_t chan = events[i].data.u32 >> 1;
 
+    for (int n = 0; n < REACTOR_BATCH; n++) {
+      if (ctrl ? !driveControl(chan) : !driveTxPriorityQueue(chan))
+        break;
+    }
+  }
+
+  pthread_setcancelstate(state, NULL);
 }
 
 void Transceiver::driveReceiveRadio()
 {
   if (!mRadioInterface->driveReceiveRadio()) {
     usleep(100000);
-  } else if (mForceClockInterface || mTransmitDeadlineClock > mLastClockUpdateTime + GSM::Time(216,0)) {
-    mForceClockInterface = false;
+  } else if (mOn && (mForceClockInterface.exchange(false) ||
+                     mTransmitDeadlineClock > mLastClockUpdateTime + GSM::Time(216,0))) {
     writeClockInterface();
   }
 }
@@ -891,52 +1434,99 @@ void Transceiver::logRxBurst(size_t chan, SoftVector *burst, GSM::Time time, dou
     << " bits: "   << *burst;
 }
 
-void Transceiver::driveReceiveFIFO(size_t chan)
+size_t Transceiver::writeRxBurst(size_t chan, char *msg, size_t len,
+                                 int format, unsigned softBits,
+                                 SoftVector *burst, GSM::Time time,
+                                 double RSSI, double TOA, double noise,
+                                 int flags)
 {
-  SoftVector *rxBurst = NULL;
-  double RSSI; // in dBFS
   double dBm;  // in dBm
-  double TOA;  // in symbols
-  int TOAint;  // in 1/256 symbols
-  double noise; // noise level in dBFS
-  GSM::Time burstTime;
-  bool isRssiValid; // are RSSI, noise and burstTime valid
   unsigned nbits = gSlotLen;
-
-  rxBurst = pullRadioVector(burstTime, RSSI, isRssiValid, TOA, noise, chan);
-  if (!rxBurst)
-    return;
-
-  // Convert -1..+1 soft bits to 0..1 soft bits
-  vectorSlicer(rxBurst);
+  TrxdBurst hdr;
 
   /*
    * EDGE demodulator returns 444 (148 * 3) bits
    */
-  if (rxBurst->size() == gSlotLen * 3)
+  if (burst->size() == gSlotLen * 3)
     nbits = gSlotLen * 3;
 
+  if (burst->size() != nbits) {
+    LOG(ERR) << "Unexpected soft burst length " << burst->size();
+    delete burst;
+    return len;
+  }
+
   dBm = RSSI + rssiOffset;
-  logRxBurst(chan, rxBurst, burstTime, dBm, RSSI, noise, TOA);
+  logRxBurst(chan, burst, time, dBm, RSSI, noise, TOA);
 
-  TOAint = (int) (TOA * 256.0 + 0.5); // round to closest integer
+  hdr.tn = time.TN() | flags;
+  hdr.fn = time.FN();
+  hdr.power = (int) dBm;
+  hdr.toa = (int) (TOA * 256.0 + 0.5); // in 1/256 symbols, rounded
 
-  char burstString[nbits + 10];
-  burstString[0] = burstTime.TN();
-  for (int i = 0; i < 4; i++)
-    burstString[1+i] = (burstTime.FN() >> ((3-i)*8)) & 0x0ff;
-  burstString[5] = (int)dBm;
-  burstString[6] = (TOAint >> 8) & 0x0ff;
-  burstString[7] = TOAint & 0x0ff;
-  SoftVector::iterator burstItr = rxBurst->begin();
+  size_t next = appendTrxdBurst(msg, TRXD_MAX_LEN, len, format, softBits,
+                                hdr, *burst);
 
-  for (unsigned i = 0; i < nbits; i++)
-    burstString[8 + i] = (char) round((*burstItr++) * 255.0);
+  /* Legacy messages and full batches go out before the next burst */
+  if (!next && len) {
+    mDataSockets[chan]->write(msg, len);
+    next = appendTrxdBurst(msg, TRXD_MAX_LEN, 0, format, softBits,
+                           hdr, *burst);
+  }
 
-  burstString[nbits + 9] = '\0';
-  delete rxBurst;
+  delete burst;
 
-  mDataSockets[chan]->write(burstString, nbits + 10);
+  return next;
+}
+
+void Transceiver::driveReceiveFIFO(size_t chan)
+{
+  SoftVector *rxBurst = NULL;
+  SoftVector *vamosBurst = NULL;
+  double RSSI; // in dBFS
+  double TOA;  // in symbols
+  double noise; // noise level in dBFS
+  GSM::Time burstTime;
+  bool isRssiValid; // are RSSI and noise valid
+  TransceiverState *state = &mStates[chan];
+
+  rxBurst = pullRadioVector(burstTime, RSSI, isRssiValid, TOA, noise,
+                            vamosBurst, chan);
+
+  /*
+   * Bursts of a TDMA frame, including both subchannels of VAMOS timeslots,
+   * share a packed message, which keeps the format it was started with.
+   * It goes out after timeslot 7, or early once the next frame or another
+   * format shows up. Legacy messages take a single burst and go out
+   * right away.
+   */
+  unsigned fmt = *state->dataFormat;
+  if (state->rxLen && ((burstTime.FN() != state->rxFN) ||
+                       (fmt != state->rxFormat))) {
+    mDataSockets[chan]->write(state->rxMsg, state->rxLen);
+    state->rxLen = 0;
+  }
+
+  if (!state->rxLen) {
+    state->rxFormat = fmt;
+    state->rxFN = burstTime.FN();
+  }
+
+  int format = state->rxFormat & 0xff;
+  unsigned softBits = state->rxFormat >> 8;
+
+  if (rxBurst)
+    state->rxLen = writeRxBurst(chan, state->rxMsg, state->rxLen, format,
+                                softBits, rxBurst, burstTime, RSSI, TOA, noise);
+  if (vamosBurst)
+    state->rxLen = writeRxBurst(chan, state->rxMsg, state->rxLen, format,
+                                softBits, vamosBurst, burstTime, RSSI, TOA,
+                                noise, TRXD_VAMOS_SUBCHAN);
+
+  if (state->rxLen && ((format == TRXD_LEGACY) || (burstTime.TN() == 7))) {
+    mDataSockets[chan]->write(state->rxMsg, state->rxLen);
+    state->rxLen = 0;
+  }
 }
 
 void Transceiver::driveTxFIFO()
@@ -955,7 +1545,7 @@ void Transceiver::driveTxFIFO()
 
   RadioClock *radioClock = (mRadioInterface->getClock());
 
-  if (mOn) {
+  if (mRunning) {
     //radioClock->wait(); // wait until clock updates
     LOG(DEBUG) << "radio clock " << radioClock->get();
     while (radioClock->get() + mTransmitLatency > mTransmitDeadlineClock) {
@@ -982,7 +1572,11 @@ void Transceiver::driveTxFIFO()
           }
         }
       }
-      // time to push burst to transmit FIFO
+      // time to push burst to transmit FIFO, whole frame if idle
+      if (pushRadioFrame(mTransmitDeadlineClock)) {
+        mTransmitDeadlineClock.incTN(8);
+        continue;
+      }
       pushRadioVector(mTransmitDeadlineClock);
       mTransmitDeadlineClock.incTN();
     }
@@ -997,11 +1591,12 @@ void Transceiver::writeClockInterface()
 {
   char command[50];
   // FIXME -- This should be adaptive.
-  sprintf(command,"IND CLOCK %llu",(unsigned long long) (mTransmitDeadlineClock.FN()+2));
+  size_t len = formatClockIndication(command, sizeof(command),
+                                     mTransmitDeadlineClock.FN() + 2);
 
   LOG(INFO) << "ClockInterface: sending " << command;
 
-  mClockSocket.write(command, strlen(command) + 1);
+  mClockSocket.write(command, len);
 
   mLastClockUpdateTime = mTransmitDeadlineClock;
 
@@ -1045,31 +1640,21 @@ void *TxLowerLoopAdapter(Transceiver *transceiver)
   return NULL;
 }
 
-void *ControlServiceLoopAdapter(TransceiverChannel *chan)
+void *ReactorLoopAdapter(Transceiver *transceiver)
 {
-  Transceiver *trx = chan->trx;
-  size_t num = chan->num;
-
-  delete chan;
+  transceiver->setPriority(0.40);
 
   while (1) {
-    trx->driveControl(num);
+    transceiver->driveReactor(false);
     pthread_testcancel();
   }
   return NULL;
 }
 
-void *TxUpperLoopAdapter(TransceiverChannel *chan)
+void *ControlLoopAdapter(Transceiver *transceiver)
 {
-  Transceiver *trx = chan->trx;
-  size_t num = chan->num;
-
-  delete chan;
-
-  trx->setPriority(0.40);
-
   while (1) {
-    trx->driveTxPriorityQueue(num);
+    transceiver->driveReactor(true);
     pthread_testcancel();
   }
   return NULL;
@@ -26,7 +26,10 @@
 #include "Interthread.h"
 #include "GSMCommon.h"
 #include "Sockets.h"
+#include "BurstStats.h"
+#include "DataMessage.h"
 
+#include <atomic>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -58,8 +61,10 @@ struct TransceiverState {
 
   int chanType[8];
 
-  /* Last timestamp of each timeslot's channel estimate */
-  GSM::Time chanEstimateTime[8];
+  /* Training sequence of each timeslot, and of the second VAMOS
+     subchannel sharing the timeslot or -1 */
+  unsigned tsc[8];
+  int vamosTsc[8];
 
   /* The filler table */
   signalVector *fillerTable[102][8];
@@ -73,17 +78,65 @@ struct TransceiverState {
   signalVector *DFEForward[8];
   signalVector *DFEFeedback[8];
 
+  /* Noise power and time of the channel estimate of all timeslots */
+  float chanNoise[8];
+  GSM::Time chanEstimateTime[8];
+
   /* Most recent SNR, timing, and channel amplitude estimates */
   float SNRestimate[8];
   float chanRespOffset[8];
   complex chanRespAmplitude[8];
 
-  /* Received noise energy levels */
-  float mNoiseLev;
-  noiseVector mNoises;
+  /* Timeslots whose delay spread calls for equalization */
+  bool equalize[8];
+
+  /* Average equalizer processing time per burst in microseconds */
+  float eqCost[EQ_MLSE + 1];
+
+  /* Tracked uplink carrier frequency offset of all timeslots in Hz */
+  float freqOffset[8];
+
+  /* Time of the last normal burst detected on each timeslot, and whether
+     its timing is tracked in a narrow search window */
+  GSM::Time toaTime[8];
+  bool toaTrack[8];
+
+  /* Bursts found in the narrow window since the last full window search */
+  unsigned toaTracked[8];
+
+  /* Drop the channel estimate and equalizer filters of a timeslot */
+  void resetEqualizer(size_t tn);
+
+  /* Timeslots reconfigured over the control interface. Only the receive
+     thread touches the per-timeslot receive state, so the control thread
+     requests a reset, which is applied before the next burst. */
+  std::atomic<bool> *resetPending;
+  void requestReset(size_t tn);
+  void applyReset(size_t tn);
+
+  /* Training sequences staged by the control thread, packed as
+     tsc | (vamosTsc + 1) << 8, and taken over on the next reset */
+  std::atomic<int> *tscPending;
+  void requestTsc(size_t tn, unsigned tsc, int vamos_tsc);
+
+  /* Received noise level and per-timeslot burst statistics */
+  ChanStats *mStats;
 
   /* Shadowed downlink attenuation */
   int mPower;
+
+  /* TRXD wire format (TrxdFormat) and uplink soft bit width, packed as
+     format | softBits << 8 since the control thread changes them under
+     the data and receive threads */
+  std::atomic<unsigned> *dataFormat;
+  void setFormat(int format, unsigned soft_bits);
+
+  /* Uplink TRXD message collecting the bursts of a TDMA frame, in the
+     packed format it was started with. Only the receive thread touches it. */
+  char *rxMsg;
+  size_t rxLen;
+  unsigned rxFormat;
+  int rxFN;
 };
 
 /** The Transceiver class, responsible for physical layer of basestation */
@@ -109,7 +162,10 @@ public:
   ~Transceiver();
 
   /** Start the control loop */
-  bool init(int filler, size_t rtsc, unsigned rach_delay, bool edge);
+  bool init(int filler, size_t rtsc, unsigned rach_delay, bool edge,
+            int combiner = COMBINE_SELECT, bool warm_restart = false,
+            int equalizer = EQ_NONE, unsigned eq_budget = 0,
+            bool freq_correction = false);
 
   /** attach the radioInterface receive FIFO */
   bool receiveFIFO(VectorFIFO *wFIFO, size_t chan)
@@ -152,6 +208,11 @@ public:
     FILLER_ACCESS_RAND,
   };
 
+  enum CombinerType {
+    COMBINE_SELECT,
+    COMBINE_MRC,
+  };
+
 private:
   int mBasePort;
   std::string mLocalAddr;
@@ -167,8 +228,10 @@ private:
   std::vector<Thread *> mRxServiceLoopThreads;  ///< thread to pull bursts into receive FIFO
   Thread *mRxLowerLoopThread;                   ///< thread to pull bursts into receive FIFO
   Thread *mTxLowerLoopThread;                   ///< thread to push bursts into transmit FIFO
-  std::vector<Thread *> mControlServiceLoopThreads;         ///< thread to process control messages from GSM core
-  std::vector<Thread *> mTxPriorityQueueServiceLoopThreads; ///< thread to process transmit bursts from GSM core
+  Thread *mReactorThread;                       ///< thread to serve data sockets of all channels
+  Thread *mControlThread;                       ///< thread to serve control sockets of all channels
+  int mEpollFD;                                 ///< epoll instance watching the data sockets
+  int mCtrlEpollFD;                             ///< epoll instance watching the control sockets
 
   GSM::Time mTransmitLatency;             ///< latency between basestation clock and transmit deadline clock
   GSM::Time mLatencyUpdateTime;           ///< last time latency was updated
@@ -191,10 +254,29 @@ private:
   /** Push modulated burst into transmit FIFO corresponding to a particular timestamp */
   void pushRadioVector(GSM::Time &nowTime);
 
-  /** Pull and demodulate a burst from the receive FIFO */
+  /** Push a full frame of filler bursts if no channel has a burst queued for it */
+  bool pushRadioFrame(GSM::Time &nowTime);
+
+  /** Pull and demodulate a burst from the receive FIFO, with the burst of
+      the second subchannel on VAMOS timeslots */
   SoftVector *pullRadioVector(GSM::Time &wTime, double &RSSI, bool &isRssiValid,
                               double &timingOffset, double &noise,
-                              size_t chan = 0);
+                              SoftVector *&vamosBurst, size_t chan = 0);
+
+  /** Detect on all diversity paths and demodulate with maximal ratio combining */
+  SoftVector *combineRadioVector(radioVector *radio_burst, CorrType type,
+                                 unsigned tsc, double &timingOffset);
+
+  /** Equalize and demodulate a normal burst on timeslots with multipath,
+      returns NULL if the timeslot does not need equalization */
+  SoftVector *equalizeRadioVector(const signalVector &burst, GSM::Time time,
+                                  unsigned tsc, float toa, size_t chan);
+
+  /** Jointly detect and demodulate both subchannels of a VAMOS timeslot */
+  SoftVector *separateRadioVector(const signalVector &burst,
+                                  const unsigned tsc[2],
+                                  double &timingOffset,
+                                  SoftVector *&vamosBurst);
 
   /** Set modulus for specific timeslot */
   void setModulus(size_t timeslot, size_t chan);
@@ -210,8 +292,14 @@ private:
   size_t mChans;
 
   bool mEdge;
-  bool mOn;	                           ///< flag to indicate that transceiver is powered on
-  bool mForceClockInterface;           ///< flag to indicate whether IND CLOCK shall be sent unconditionally after transceiver is started
+  int mCombiner;                       ///< diversity path combining (CombinerType)
+  int mEqualizer;                      ///< equalizer on timeslots with multipath (EqualizerType)
+  unsigned mEqBudget;                  ///< equalizer processing time limit per burst in microseconds, 0 for none
+  bool mFreqCorrection;                ///< correct uplink carrier frequency offsets
+  std::atomic<bool> mOn;               ///< flag to indicate that transceiver is powered on
+  bool mRunning;                       ///< flag to indicate that the device and I/O threads are running
+  bool mWarmRestart;                   ///< keep the device and I/O threads running across POWEROFF
+  std::atomic<bool> mForceClockInterface; ///< flag to indicate whether IND CLOCK shall be sent unconditionally after transceiver is started
   bool mHandover[8][8];                ///< expect handover to the timeslot/subslot
   double mTxFreq;                      ///< the transmit frequency
   double mRxFreq;                      ///< the receive frequency
@@ -226,6 +314,12 @@ private:
   bool start();
   void stop();
 
+  /** Power off, which only idles burst processing with warm restart */
+  void powerOff();
+
+  /** Register control and data sockets with the socket reactor */
+  bool initReactor();
+
   /** Protect destructor accessable stop call */
   Mutex mLock;
 
@@ -239,25 +333,30 @@ protected:
   /** drive transmission of GSM bursts */
   void driveTxFIFO();
 
-  /** drive handling of control messages from GSM core */
-  void driveControl(size_t chan);
+  /**
+    drive handling of control messages from GSM core
+    @return false if no message was pending on the socket
+  */
+  bool driveControl(size_t chan);
 
   /**
     drive modulation and sorting of GSM bursts from GSM core
-    @return true if a burst was transferred successfully
+    @return false if no burst was pending on the socket
   */
   bool driveTxPriorityQueue(size_t chan);
 
-  friend void *RxUpperLoopAdapter(TransceiverChannel *);
+  /** drive the control or the data sockets of all channels */
+  void driveReactor(bool ctrl);
 
-  friend void *TxUpperLoopAdapter(TransceiverChannel *);
+  friend void *RxUpperLoopAdapter(TransceiverChannel *);
 
   friend void *RxLowerLoopAdapter(Transceiver *);
 
   friend void *TxLowerLoopAdapter(Transceiver *);
 
-  friend void *ControlServiceLoopAdapter(TransceiverChannel *);
+  friend void *ReactorLoopAdapter(Transceiver *);
 
+  friend void *ControlLoopAdapter(Transceiver *);
 
   void reset();
 
@@ -266,6 +365,13 @@ protected:
 
   void logRxBurst(size_t chan, SoftVector *burst, GSM::Time time, double dbm,
                   double rssi, double noise, double toa);
+
+  /** Add an uplink burst to a TRXD message of TRXD_MAX_LEN bytes,
+      consuming the burst. A message that cannot take the burst is sent to
+      the GSM core first. Returns the new message length. */
+  size_t writeRxBurst(size_t chan, char *msg, size_t len, int format,
+                      unsigned softBits, SoftVector *burst, GSM::Time time,
+                      double RSSI, double TOA, double noise, int flags = 0);
 };
 
 void *RxUpperLoopAdapter(TransceiverChannel *);
@@ -274,8 +380,8 @@ void *RxUpperLoopAdapter(TransceiverChannel *);
 void *RxLowerLoopAdapter(Transceiver *);
 void *TxLowerLoopAdapter(Transceiver *);
 
-/** control message handler thread loop */
-void *ControlServiceLoopAdapter(TransceiverChannel *);
-
 /** transmit queueing thread loop */
-void *TxUpperLoopAdapter(TransceiverChannel *);
+void *ReactorLoopAdapter(Transceiver *);
+
+/** control message thread loop */
+void *ControlLoopAdapter(Transceiver *);
@@ -0,0 +1,1790 @@
+/*
+ * Transceiver control tests against a software stand-in radio device
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <random>
+#include <sstream>
+#include <algorithm>
+
+#include "Transceiver.h"
+#include "ControlCommand.h"
+#include "DataMessage.h"
+#include "BurstStats.h"
+#include "radioDevice.h"
+#include "Sockets.h"
+#include "Logger.h"
+#include "Configuration.h"
+
+extern "C" {
+#include "convolve.h"
+#include "convert.h"
+}
+
+ConfigurationTable gConfig;
+
+#define TEST_ADDR		"127.0.0.1"
+#define TEST_PORT		6700
+#define TEST_TX_SPS		4
+#define TEST_RX_SPS		1
+#define TEST_BURSTS		64
+#define TEST_CHANS		4
+
+static double time_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Stand-in radio device
+ *
+ * Streams zeros on receive, paced in real time at the device sample rate
+ * from the moment the device is started, and records the first non-zero
+ * transmit sample and which channels have transmitted. Device start and stop are counted but cost nothing,
+ * unlike real hardware, which takes seconds to start and align.
+ *
+ * Pacing can be turned off for benchmarks, and loopback returns the first
+ * channel's transmit samples on receive instead of zeros. Receive levels,
+ * when set, fill each channel with its own constant level instead.
+ */
+class TestDevice : public RadioDevice {
+public:
+	TestDevice(size_t tx_sps, size_t rx_sps, double rate = 0.0)
+		: txRate(rate ? rate : GSMRATE * tx_sps),
+		  rxRate(rate ? rate : GSMRATE * rx_sps),
+		  running(false), paced(true), loopback(false),
+		  starts(0), stops(0), writes(0), rxSamples(0), txSamples(0)
+	{
+		reset();
+	}
+
+	int open(const std::string &args, int ref, bool swap_channels)
+	{
+		return NORMAL;
+	}
+
+	bool start()
+	{
+		startTime = time_now();
+		running = true;
+		starts++;
+		return true;
+	}
+
+	bool stop()
+	{
+		running = false;
+		stops++;
+		return true;
+	}
+
+	enum TxWindowType getWindowType() { return TX_WINDOW_FIXED; }
+	void setPriority(float prio) { }
+
+	int readSamples(std::vector<short *> &bufs, int len, bool *overrun,
+			TIMESTAMP timestamp, bool *underrun, unsigned *RSSI)
+	{
+		double due = startTime + (timestamp + len) / rxRate;
+		double wait = due - time_now();
+
+		if (paced && wait > 0.0)
+			usleep((useconds_t) (wait * 1e6));
+
+		for (size_t i = 0; i < bufs.size(); i++) {
+			short level = i < levels.size() ? levels[i] : 0;
+			std::fill(bufs[i], bufs[i] + 2 * len, level);
+		}
+
+		if (loopback && loop.size() >= 2 * (size_t) len) {
+			std::copy(loop.begin(), loop.begin() + 2 * len, bufs[0]);
+			loop.erase(loop.begin(), loop.begin() + 2 * len);
+		}
+
+		rxSamples += len;
+
+		*overrun = false;
+		if (underrun)
+			*underrun = false;
+
+		return len;
+	}
+
+	int writeSamples(std::vector<short *> &bufs, int len, bool *underrun,
+			 TIMESTAMP timestamp, bool isControl)
+	{
+		for (size_t chan = 0; chan < bufs.size(); chan++) {
+			if (airChans & (1 << chan))
+				continue;
+
+			for (int i = 0; i < 2 * len; i++) {
+				if (!bufs[chan][i])
+					continue;
+
+				if (firstAir < 0.0)
+					firstAir = startTime + (timestamp + i / 2) / txRate;
+				airChans |= 1 << chan;
+				break;
+			}
+		}
+
+		if (loopback)
+			loop.insert(loop.end(), bufs[0], bufs[0] + 2 * len);
+
+		txSamples += len;
+		writes++;
+		return len;
+	}
+
+	bool updateAlignment(TIMESTAMP timestamp) { return true; }
+	bool setTxFreq(double freq, size_t chan) { return true; }
+	bool setRxFreq(double freq, size_t chan) { return true; }
+	TIMESTAMP initialWriteTimestamp() { return 0; }
+	TIMESTAMP initialReadTimestamp() { return 0; }
+	double fullScaleInputValue() { return 32000 * 0.3; }
+	double fullScaleOutputValue() { return 32000; }
+	double setRxGain(double dB, size_t chan) { return dB; }
+	double getRxGain(size_t chan) { return 0.0; }
+	double maxRxGain() { return 0.0; }
+	double minRxGain() { return 0.0; }
+	double setTxGain(double dB, size_t chan) { return dB; }
+	double maxTxGain() { return 0.0; }
+	double minTxGain() { return 0.0; }
+	double getTxFreq(size_t chan) { return 0.0; }
+	double getRxFreq(size_t chan) { return 0.0; }
+	double getSampleRate() { return txRate; }
+	double numberRead() { return 0.0; }
+	double numberWritten() { return 0.0; }
+
+	/* Forget the last transmitted non-zero samples */
+	void reset() { firstAir = -1.0; airChans = 0; }
+
+	double txRate, rxRate;
+	double startTime;
+	volatile double firstAir;
+	volatile unsigned airChans;
+	bool running, paced, loopback;
+	int starts, stops, writes;
+	size_t rxSamples, txSamples;
+	std::vector<short> loop;
+	std::vector<short> levels;
+};
+
+/* Uplink burst as seen by the BTS, soft bits at the negotiated width */
+struct PeerBurst {
+	unsigned tn;
+	uint32_t fn;
+	int power;
+	int toa;
+	std::vector<unsigned char> soft;
+};
+
+/*
+ * Minimal BTS side of the control, clock and data interfaces
+ *
+ * Speaks the legacy and packed TRXD formats, written out byte by byte from
+ * the wire layout rather than through the transceiver's own formatting.
+ */
+class TestBts {
+public:
+	TestBts(unsigned port, size_t chan = 0)
+		: ctrl(TEST_ADDR, port + 2 * chan + 101, TEST_ADDR, port + 2 * chan + 1),
+		  clock(TEST_ADDR, port + 2 * chan + 100, TEST_ADDR, port + 2 * chan),
+		  data(TEST_ADDR, port + 2 * chan + 102, TEST_ADDR, port + 2 * chan + 2),
+		  format(TRXD_LEGACY), softBits(8)
+	{
+	}
+
+	bool command(const char *cmd)
+	{
+		char buf[128];
+
+		snprintf(buf, sizeof(buf), "CMD %s", cmd);
+		ctrl.write(buf, strlen(buf) + 1);
+
+		if (ctrl.read(buf, sizeof(buf), 5000) <= 0) {
+			printf("No response to %s\n", cmd);
+			return false;
+		}
+
+		/* Response code directly follows the echoed command name */
+		size_t len = strcspn(cmd, " ");
+		if (strncmp(buf + 4, cmd, len) || strlen(buf) < 4 + len + 2)
+			return false;
+
+		return atoi(buf + 4 + len) == 0;
+	}
+
+	/* Negotiate the data format, which only applies once accepted */
+	bool setFormat(int fmt, unsigned bits)
+	{
+		char cmd[64];
+
+		snprintf(cmd, sizeof(cmd), "SETFORMAT %d %u", fmt, bits);
+		if (!command(cmd))
+			return false;
+
+		format = fmt;
+		softBits = bits;
+		return true;
+	}
+
+	/* Wait for a clock indication, which arrives once bursts flow */
+	int readClock(unsigned timeout)
+	{
+		char buf[64];
+		unsigned long long fn;
+
+		if (clock.read(buf, sizeof(buf), timeout) <= 0)
+			return -1;
+		if (sscanf(buf, "IND CLOCK %llu", &fn) != 1)
+			return -1;
+
+		return (int) fn;
+	}
+
+	/*
+	 * Add a downlink burst to a message, which must have room for it.
+	 * Returns the new length, legacy messages always start over.
+	 */
+	size_t encodeBurst(unsigned char *buf, size_t len, unsigned tn,
+			   uint32_t fn, int power, const BitVector &bits)
+	{
+		bool edge = bits.size() == EDGE_BURST_NBITS;
+
+		if (format == TRXD_LEGACY) {
+			len = 0;
+		} else if (!len) {
+			buf[len++] = TRXD_PACKED;
+			buf[len++] = 0;
+		}
+
+		unsigned char *p = buf + len;
+
+		p[0] = tn | (format == TRXD_PACKED && edge ? TRXD_EDGE : 0);
+		p[1] = (fn >> 24) & 0xff;
+		p[2] = (fn >> 16) & 0xff;
+		p[3] = (fn >> 8) & 0xff;
+		p[4] = fn & 0xff;
+		p[5] = power;
+		p += TRXD_DL_HDR;
+
+		if (format == TRXD_LEGACY) {
+			for (size_t i = 0; i < bits.size(); i++)
+				p[i] = bits[i];
+			return TRXD_DL_HDR + bits.size();
+		}
+
+		size_t bytes = (bits.size() + 7) / 8;
+
+		memset(p, 0, bytes);
+		for (size_t i = 0; i < bits.size(); i++)
+			p[i / 8] |= (bits[i] & 1) << (7 - i % 8);
+
+		buf[1]++;
+		return len + TRXD_DL_HDR + bytes;
+	}
+
+	/* Split an uplink message into bursts, false if it is malformed */
+	bool decodeBursts(const unsigned char *buf, size_t len,
+			  std::vector<PeerBurst> &bursts)
+	{
+		const unsigned char *end = buf + len;
+		int count = 1;
+
+		bursts.clear();
+
+		if (format == TRXD_PACKED) {
+			if (len < TRXD_BATCH_HDR || buf[0] != TRXD_PACKED)
+				return false;
+			count = buf[1];
+			buf += TRXD_BATCH_HDR;
+		} else if (len < TRXD_UL_HDR + 2) {
+			return false;
+		}
+
+		for (int n = 0; n < count; n++) {
+			PeerBurst burst;
+			size_t nbits;
+
+			if (end - buf < TRXD_UL_HDR)
+				return false;
+
+			/* Legacy bursts end in two padding bytes */
+			if (format == TRXD_LEGACY)
+				nbits = len - TRXD_UL_HDR - 2;
+			else if (buf[0] & TRXD_EDGE)
+				nbits = EDGE_BURST_NBITS;
+			else
+				nbits = gSlotLen;
+
+			size_t bytes = format == TRXD_PACKED && softBits == 4 ?
+				       nbits / 2 : nbits;
+			if ((size_t) (end - buf) < TRXD_UL_HDR + bytes)
+				return false;
+
+			burst.tn = buf[0] & ~(format == TRXD_PACKED ? TRXD_EDGE : 0);
+			burst.fn = (buf[1] << 24) | (buf[2] << 16) |
+				   (buf[3] << 8) | buf[4];
+			burst.power = (signed char) buf[5];
+			burst.toa = (short) ((buf[6] << 8) | buf[7]);
+			buf += TRXD_UL_HDR;
+
+			for (size_t i = 0; i < nbits; i++) {
+				if (bytes == nbits)
+					burst.soft.push_back(buf[i]);
+				else
+					burst.soft.push_back(i % 2 ? buf[i / 2] & 0x0f :
+							     buf[i / 2] >> 4);
+			}
+			buf += bytes;
+			if (format == TRXD_LEGACY)
+				buf += 2;
+
+			bursts.push_back(burst);
+		}
+
+		return buf == end;
+	}
+
+	/* Send timeslot 0 normal bursts for a run of frames, in batches of
+	   up to a frame's worth of bursts in the packed format */
+	void sendBursts(int fn, int count)
+	{
+		unsigned char buf[TRXD_MAX_LEN];
+		BitVector bits(gSlotLen);
+		size_t len = 0;
+
+		for (size_t i = 0; i < gSlotLen; i++)
+			bits[i] = i % 2;
+
+		for (int n = 0; n < count; n++) {
+			uint32_t frame = (fn + n) % GSM::gHyperframe;
+
+			len = encodeBurst(buf, len, 0, frame, 0, bits);
+
+			if (format == TRXD_LEGACY || buf[1] == TRXD_MAX_BATCH ||
+			    n == count - 1) {
+				data.write((char *) buf, len);
+				len = 0;
+			}
+		}
+	}
+
+	/* Drop stale clock indications */
+	void flushClock()
+	{
+		while (readClock(0) >= 0);
+	}
+
+	UDPSocket ctrl, clock, data;
+	int format;
+	unsigned softBits;
+};
+
+/*
+ * Time from sending POWERON until the first burst is on the air
+ *
+ * Bursts are scheduled on the first clock indication, the way the BTS
+ * does, so this covers device start, clock recovery and the transmit
+ * pipeline. Returns negative on failure.
+ */
+static double powerOnLatency(TestBts &bts, TestDevice &dev)
+{
+	dev.reset();
+	bts.flushClock();
+
+	double start = time_now();
+	if (!bts.command("POWERON"))
+		return -1.0;
+
+	int fn = bts.readClock(5000);
+	if (fn < 0) {
+		printf("No clock indication after POWERON\n");
+		return -1.0;
+	}
+
+	bts.sendBursts(fn, TEST_BURSTS);
+
+	for (int i = 0; i < 500 && dev.firstAir < 0.0; i++)
+		usleep(1000);
+
+	if (dev.firstAir < 0.0) {
+		printf("No burst transmitted after POWERON\n");
+		return -1.0;
+	}
+
+	return dev.firstAir - start;
+}
+
+/* Nothing but zeros should reach the device after POWEROFF */
+static bool powerOff(TestBts &bts, TestDevice &dev)
+{
+	if (!bts.command("POWEROFF"))
+		return false;
+
+	usleep(50000);
+	dev.reset();
+	usleep(200000);
+
+	if (dev.firstAir >= 0.0) {
+		printf("Non-zero samples transmitted after POWEROFF\n");
+		return false;
+	}
+
+	return true;
+}
+
+static bool testRestart(bool warm, unsigned port)
+{
+	TestDevice dev(TEST_TX_SPS, TEST_RX_SPS);
+	RadioInterface radio(&dev, TEST_TX_SPS, TEST_RX_SPS, 1);
+	double first, second;
+	bool rc = false;
+
+	if (!radio.init(RadioDevice::NORMAL))
+		return false;
+
+	Transceiver *trx = new Transceiver(port, TEST_ADDR, TEST_ADDR,
+					   TEST_TX_SPS, TEST_RX_SPS, 1,
+					   GSM::Time(3, 0), &radio, 0.0);
+	if (!trx->init(Transceiver::FILLER_ZERO, 0, 0, false,
+		       Transceiver::COMBINE_SELECT, warm) ||
+	    !trx->receiveFIFO(radio.receiveFIFO(0), 0)) {
+		delete trx;
+		return false;
+	}
+
+	TestBts bts(port);
+
+	if (!bts.command("SETSLOT 0 1"))
+		goto out;
+
+	first = powerOnLatency(bts, dev);
+	if (first < 0.0 || !bts.command("GETSTATS 0") || !powerOff(bts, dev))
+		goto out;
+
+	if (warm && (dev.stops || !dev.running)) {
+		printf("Device stopped on warm POWEROFF\n");
+		goto out;
+	}
+
+	second = powerOnLatency(bts, dev);
+	if (second < 0.0)
+		goto out;
+
+	if (warm && dev.starts != 1) {
+		printf("Device restarted on warm POWERON\n");
+		goto out;
+	}
+
+	printf("%s restart: first POWERON %.1f ms, second POWERON %.1f ms "
+	       "(device starts %d, stops %d)\n", warm ? "Warm" : "Cold",
+	       first * 1e3, second * 1e3, dev.starts, dev.stops);
+	rc = true;
+
+out:
+	bts.command("POWEROFF");
+	delete trx;
+	return rc;
+}
+
+static int countThreads()
+{
+	DIR *dir = opendir("/proc/self/task");
+	struct dirent *entry;
+	int num = 0;
+
+	if (!dir)
+		return -1;
+
+	while ((entry = readdir(dir))) {
+		if (entry->d_name[0] != '.')
+			num++;
+	}
+
+	closedir(dir);
+	return num;
+}
+
+/*
+ * Data sockets of all channels are served by one reactor thread and
+ * control sockets by one control thread, so every channel must answer on
+ * its own control socket and get its own bursts on the air.
+ */
+static bool testChannels(unsigned port)
+{
+	TestDevice dev(TEST_TX_SPS, TEST_RX_SPS);
+	RadioInterface radio(&dev, TEST_TX_SPS, TEST_RX_SPS, TEST_CHANS);
+	std::vector<TestBts *> bts(TEST_CHANS);
+	int fn, threads;
+	bool rc = false;
+
+	if (!radio.init(RadioDevice::NORMAL))
+		return false;
+
+	Transceiver *trx = new Transceiver(port, TEST_ADDR, TEST_ADDR,
+					   TEST_TX_SPS, TEST_RX_SPS, TEST_CHANS,
+					   GSM::Time(3, 0), &radio, 0.0);
+	if (!trx->init(Transceiver::FILLER_ZERO, 0, 0, false)) {
+		delete trx;
+		return false;
+	}
+
+	for (size_t i = 0; i < TEST_CHANS; i++) {
+		if (!trx->receiveFIFO(radio.receiveFIFO(i), i)) {
+			delete trx;
+			return false;
+		}
+		bts[i] = new TestBts(port, i);
+	}
+
+	for (size_t i = 0; i < TEST_CHANS; i++) {
+		if (!bts[i]->command("SETSLOT 0 1"))
+			goto out;
+	}
+
+	if (!bts[0]->command("POWERON"))
+		goto out;
+
+	fn = bts[0]->readClock(5000);
+	if (fn < 0) {
+		printf("No clock indication after POWERON\n");
+		goto out;
+	}
+
+	for (size_t i = 0; i < TEST_CHANS; i++)
+		bts[i]->sendBursts(fn, TEST_BURSTS);
+
+	for (int i = 0; i < 500 && dev.airChans != (1 << TEST_CHANS) - 1; i++)
+		usleep(1000);
+
+	threads = countThreads();
+
+	if (dev.airChans != (1 << TEST_CHANS) - 1) {
+		printf("Bursts missing on channels, mask 0x%x\n", dev.airChans);
+		goto out;
+	}
+
+	printf("%d channels on air with %d threads\n", TEST_CHANS, threads);
+	rc = true;
+
+out:
+	bts[0]->command("POWEROFF");
+	delete trx;
+	for (size_t i = 0; i < TEST_CHANS; i++)
+		delete bts[i];
+	return rc;
+}
+
+/*
+ * VAMOS subchannels
+ *
+ * A second training sequence must be accepted on a GMSK transceiver and
+ * rejected with EDGE enabled, where the timeslot keeps working with one.
+ */
+static bool testSubTsc(bool edge, unsigned port)
+{
+	TestDevice dev(TEST_TX_SPS, TEST_RX_SPS);
+	RadioInterface radio(&dev, TEST_TX_SPS, TEST_RX_SPS, 1);
+	bool rc = false;
+
+	if (!radio.init(RadioDevice::NORMAL))
+		return false;
+
+	Transceiver *trx = new Transceiver(port, TEST_ADDR, TEST_ADDR,
+					   TEST_TX_SPS, TEST_RX_SPS, 1,
+					   GSM::Time(3, 0), &radio, 0.0);
+	if (!trx->init(Transceiver::FILLER_ZERO, 0, 0, edge) ||
+	    !trx->receiveFIFO(radio.receiveFIFO(0), 0)) {
+		delete trx;
+		return false;
+	}
+
+	TestBts bts(port);
+
+	if (!bts.command("SETSLOT 1 1") || !bts.command("SETSUBTSC 1 3"))
+		goto out;
+
+	if (bts.command("SETSUBTSC 1 3 5") == edge) {
+		printf("VAMOS subchannel %s with EDGE %s\n",
+		       edge ? "accepted" : "rejected", edge ? "on" : "off");
+		goto out;
+	}
+
+	rc = true;
+
+out:
+	delete trx;
+	return rc;
+}
+
+/*
+ * TRXD formats
+ *
+ * Uplink messages from the transceiver must decode at the stand-in peer
+ * with all header fields intact and soft bits at the negotiated width,
+ * and downlink messages from the peer must parse back to the same bursts.
+ * Legacy messages take one burst and packed batches up to a frame's worth.
+ * Malformed batches are rejected. End to end, a transceiver that accepted
+ * SETFORMAT must put packed downlink batches on the air, and fall back to
+ * legacy messages after POWEROFF; uplink bursts need a detected
+ * burst, which the zero streaming device never delivers.
+ */
+static bool testDataFormat(unsigned port)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> usoft(-1.5f, 1.5f);
+	const int formats[][2] = {
+		{ TRXD_LEGACY, 8 }, { TRXD_PACKED, 8 }, { TRXD_PACKED, 4 },
+	};
+	size_t ulBytes[3], dlBytes[3];
+	TestBts peer(port);
+
+	for (size_t f = 0; f < 3; f++) {
+		int batch = formats[f][0] == TRXD_PACKED ? TRXD_MAX_BATCH : 1;
+		std::vector<TrxdBurst> hdrs(batch);
+		std::vector<SoftVector> softs;
+		std::vector<BitVector> hard;
+		std::vector<PeerBurst> decoded;
+		TrxdBurst parsed[TRXD_MAX_BATCH];
+		char msg[TRXD_MAX_LEN];
+		unsigned char dl[TRXD_MAX_LEN];
+		size_t len = 0, dlLen = 0;
+
+		peer.format = formats[f][0];
+		peer.softBits = formats[f][1];
+
+		for (int n = 0; n < batch; n++) {
+			size_t nbits = n % 3 == 2 ? EDGE_BURST_NBITS : gSlotLen;
+			TrxdBurst &hdr = hdrs[n];
+
+			softs.push_back(SoftVector(nbits));
+			hard.push_back(BitVector(nbits));
+			for (size_t i = 0; i < nbits; i++) {
+				softs[n][i] = usoft(rng);
+				hard[n][i] = rng() % 2;
+			}
+
+			hdr.tn = (n % 8) | (n % 2 ? TRXD_VAMOS_SUBCHAN : 0);
+			hdr.fn = rng() % GSM::gHyperframe;
+			hdr.power = -(int) (rng() % 120);
+			hdr.toa = (int) (rng() % 4096) - 2048;
+
+			len = appendTrxdBurst(msg, sizeof(msg), len, formats[f][0],
+					      formats[f][1], hdr, softs[n]);
+			dlLen = peer.encodeBurst(dl, dlLen, hdr.tn & TRXD_TN_MASK,
+						 hdr.fn, -hdr.power, hard[n]);
+			if (!len) {
+				printf("Uplink burst %d does not fit\n", n);
+				return false;
+			}
+			if (!n) {
+				ulBytes[f] = len;
+				dlBytes[f] = dlLen;
+			}
+		}
+
+		/* Legacy messages and full batches take no further burst */
+		if (appendTrxdBurst(msg, sizeof(msg), len, formats[f][0],
+				    formats[f][1], hdrs[0], softs[0])) {
+			printf("Uplink message took too many bursts\n");
+			return false;
+		}
+
+		if (!peer.decodeBursts((unsigned char *) msg, len, decoded) ||
+		    decoded.size() != (size_t) batch) {
+			printf("Uplink message not decoded\n");
+			return false;
+		}
+
+		for (int n = 0; n < batch; n++) {
+			const PeerBurst &burst = decoded[n];
+			std::vector<char> q(softs[n].size());
+
+			vectorQuantize(softs[n], &q[0]);
+			for (size_t i = 0; i < q.size(); i++) {
+				unsigned char ref = q[i];
+
+				if (burst.soft[i] != (formats[f][1] == 4 ? ref >> 4 : ref)) {
+					printf("Uplink soft bit %zu of burst %d\n", i, n);
+					return false;
+				}
+			}
+
+			if (burst.tn != hdrs[n].tn || burst.fn != hdrs[n].fn ||
+			    burst.power != hdrs[n].power || burst.toa != hdrs[n].toa) {
+				printf("Uplink header of burst %d\n", n);
+				return false;
+			}
+		}
+
+		if (parseTrxdBursts((char *) dl, dlLen, formats[f][0], parsed,
+				    TRXD_MAX_BATCH) != batch) {
+			printf("Downlink message not parsed\n");
+			return false;
+		}
+
+		for (int n = 0; n < batch; n++) {
+			BitVector bits(parsed[n].nbits);
+
+			trxdBurstBits(parsed[n], bits);
+			if (parsed[n].tn != (hdrs[n].tn & TRXD_TN_MASK) ||
+			    parsed[n].fn != hdrs[n].fn ||
+			    parsed[n].power != -hdrs[n].power ||
+			    bits.size() != hard[n].size() ||
+			    memcmp(bits.begin(), hard[n].begin(), bits.size())) {
+				printf("Downlink burst %d\n", n);
+				return false;
+			}
+		}
+
+		/* Truncated, overlong and miscounted batches */
+		if (parseTrxdBursts((char *) dl, dlLen - 1, formats[f][0],
+				    parsed, TRXD_MAX_BATCH) >= 0 ||
+		    parseTrxdBursts((char *) dl, dlLen + 1, formats[f][0],
+				    parsed, TRXD_MAX_BATCH) >= 0 ||
+		    (batch > 1 && parseTrxdBursts((char *) dl, dlLen,
+				    formats[f][0], parsed, batch - 1) >= 0)) {
+			printf("Malformed downlink message accepted\n");
+			return false;
+		}
+	}
+
+	TestDevice dev(TEST_TX_SPS, TEST_RX_SPS);
+	RadioInterface radio(&dev, TEST_TX_SPS, TEST_RX_SPS, 1);
+	bool rc = false;
+
+	if (!radio.init(RadioDevice::NORMAL))
+		return false;
+
+	Transceiver *trx = new Transceiver(port, TEST_ADDR, TEST_ADDR,
+					   TEST_TX_SPS, TEST_RX_SPS, 1,
+					   GSM::Time(3, 0), &radio, 0.0);
+	if (!trx->init(Transceiver::FILLER_ZERO, 0, 0, false) ||
+	    !trx->receiveFIFO(radio.receiveFIFO(0), 0)) {
+		delete trx;
+		return false;
+	}
+
+	peer.format = TRXD_LEGACY;
+	peer.softBits = 8;
+
+	if (peer.setFormat(TRXD_PACKED + 1, 8) || peer.setFormat(TRXD_PACKED, 5)) {
+		printf("Unknown TRXD format accepted\n");
+		goto out;
+	}
+
+	if (!peer.setFormat(TRXD_PACKED, 4) || !peer.command("SETSLOT 0 1"))
+		goto out;
+
+	if (powerOnLatency(peer, dev) < 0.0 || !powerOff(peer, dev))
+		goto out;
+
+	/* POWEROFF falls back to the legacy format */
+	peer.format = TRXD_LEGACY;
+	peer.softBits = 8;
+
+	if (powerOnLatency(peer, dev) < 0.0 || !powerOff(peer, dev)) {
+		printf("TRXD format kept across POWEROFF\n");
+		goto out;
+	}
+
+	printf("TRXD first burst: uplink %zu / %zu / %zu bytes, downlink %zu / "
+	       "%zu bytes (legacy / packed / packed 4-bit)\n", ulBytes[0],
+	       ulBytes[1], ulBytes[2], dlBytes[0], dlBytes[1]);
+	rc = true;
+
+out:
+	peer.command("POWEROFF");
+	delete trx;
+	return rc;
+}
+
+/*
+ * Multi-ARFCN carrier layouts
+ *
+ * Default layouts must match the original fixed configurations of up to
+ * three carriers on four paths. A single carrier must leave the device at
+ * its offset from the centre frequency. Over a loopback device, every
+ * carrier of an arbitrary map must come back on its own channel at the
+ * same gain, with a silent carrier staying silent.
+ */
+#define MC_LOOP_SLOTS		400
+#define MC_LOOP_AMPL		1000.0f
+
+static bool testCarrierLoopback(size_t m, double spacing,
+				const std::vector<int> &offsets)
+{
+	CarrierPlan plan;
+	size_t chans = offsets.size();
+	std::vector<signalVector *> bursts(chans);
+	std::vector<bool> zeros(chans, false);
+	std::vector<double> power(chans, 0.0);
+	bool rc = true;
+
+	if (!plan.init(chans, m, spacing, offsets))
+		return false;
+
+	TestDevice dev(4, 4, plan.rate());
+	RadioInterfaceMulti radio(&dev, 4, 4, plan);
+
+	dev.paced = false;
+	dev.loopback = true;
+
+	if (!radio.init(RadioDevice::MULTI_ARFCN) || !radio.start())
+		return false;
+
+	/* Channel 1 stays silent, the others send distinct constant levels */
+	for (size_t i = 0; i < chans; i++) {
+		bursts[i] = new signalVector(625);
+		bursts[i]->fill(MC_LOOP_AMPL * (i + 1));
+		zeros[i] = i == 1;
+	}
+
+	for (int n = 0; n < MC_LOOP_SLOTS; n++) {
+		radio.driveTransmitRadio(bursts, zeros);
+		radio.driveReceiveRadio();
+
+		for (size_t i = 0; i < chans; i++) {
+			VectorFIFO *fifo = radio.receiveFIFO(i);
+
+			while (fifo->size()) {
+				radioVector *burst = fifo->read();
+				signalVector *vec = burst->getVector();
+
+				/* Skip filter and buffering transients */
+				for (size_t k = 0; n > MC_LOOP_SLOTS / 2 &&
+				     k < vec->size(); k++)
+					power[i] += (*vec)[k].norm2();
+				delete burst;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < chans; i++) {
+		float ampl = MC_LOOP_AMPL * (i + 1);
+		double ref = power[0] / (MC_LOOP_AMPL * MC_LOOP_AMPL);
+		double dB = 10.0 * log10(power[i] / (ampl * ampl) / ref);
+
+		if (i == 1) {
+			dB = 10.0 * log10(power[1] / power[0]);
+			if (dB > -40.0) {
+				printf("Silent carrier %+d at %.1f dB\n", offsets[i], dB);
+				rc = false;
+			}
+		} else if (!power[0] || fabs(dB) > 0.5) {
+			printf("Carrier %+d gain off by %.1f dB\n", offsets[i], dB);
+			rc = false;
+		}
+		delete bursts[i];
+	}
+
+	radio.stop();
+	return rc;
+}
+
+/*
+ * Each channel receives on consecutive device channels, one per diversity
+ * path, and transmits on the first of them only.
+ */
+static bool testDiversityPaths(size_t chans, size_t paths)
+{
+	std::vector<signalVector *> bursts(chans);
+	std::vector<bool> zeros(chans, false);
+	unsigned tx_mask = 0;
+	size_t count = 0;
+	bool rc = true;
+
+	TestDevice dev(1, 1);
+	RadioInterface radio(&dev, 1, 1, chans, paths);
+
+	dev.paced = false;
+	for (size_t i = 0; i < chans * paths; i++) {
+		dev.levels.push_back(100 * (i + 1));
+		if (!(i % paths))
+			tx_mask |= 1 << i;
+	}
+
+	if (!radio.init(RadioDevice::NORMAL) || !radio.start())
+		return false;
+
+	for (size_t i = 0; i < chans; i++) {
+		bursts[i] = new signalVector(156);
+		bursts[i]->fill(1000.0f);
+	}
+
+	for (int n = 0; n < 16; n++) {
+		radio.driveTransmitRadio(bursts, zeros);
+		radio.driveReceiveRadio();
+
+		for (size_t i = 0; i < chans; i++) {
+			VectorFIFO *fifo = radio.receiveFIFO(i);
+
+			while (fifo->size()) {
+				radioVector *burst = fifo->read();
+
+				if (burst->chans() != paths) {
+					printf("Burst with %zu of %zu paths\n",
+					       burst->chans(), paths);
+					rc = false;
+				}
+
+				for (size_t p = 0; p < burst->chans(); p++) {
+					float level = 100 * (i * paths + p + 1);
+					complex val = (*burst->getVector(p))[0];
+
+					if (val.real() != level || val.imag() != level) {
+						printf("Channel %zu path %zu received %.0f\n",
+						       i, p, val.real());
+						rc = false;
+					}
+				}
+
+				count++;
+				delete burst;
+			}
+		}
+	}
+
+	if (!count || (dev.airChans != tx_mask)) {
+		printf("%zu bursts received, transmitted on 0x%x\n", count,
+		       dev.airChans);
+		rc = false;
+	}
+
+	for (size_t i = 0; i < chans; i++)
+		delete bursts[i];
+
+	radio.stop();
+	return rc;
+}
+
+/* Transmit frequency of a single carrier in carrier spacings */
+static double carrierFrequency(size_t m, int offset)
+{
+	CarrierPlan plan;
+	std::vector<signalVector *> bursts(1);
+	std::vector<bool> zeros(1, false);
+	std::vector<int> offsets(1, offset);
+	complex rot = 0.0f;
+
+	if (!plan.init(1, m, MCBTS_SPACING, offsets))
+		return NAN;
+
+	TestDevice dev(4, 4, plan.rate());
+	RadioInterfaceMulti radio(&dev, 4, 4, plan);
+
+	dev.paced = false;
+	dev.loopback = true;
+
+	if (!radio.init(RadioDevice::MULTI_ARFCN) || !radio.start())
+		return NAN;
+
+	bursts[0] = new signalVector(625);
+	bursts[0]->fill(MC_LOOP_AMPL);
+
+	for (int n = 0; n < MC_LOOP_SLOTS / 4; n++)
+		radio.driveTransmitRadio(bursts, zeros);
+
+	/* Average phase advance per sample over the settled second half */
+	for (size_t i = dev.loop.size() / 2; i + 3 < dev.loop.size(); i += 2) {
+		complex a(dev.loop[i + 0], dev.loop[i + 1]);
+		complex b(dev.loop[i + 2], dev.loop[i + 3]);
+		rot += b * a.conj();
+	}
+
+	radio.stop();
+	delete bursts[0];
+
+	return atan2(rot.imag(), rot.real()) / (2.0 * M_PI) * m;
+}
+
+/*
+ * The per-carrier engine must reproduce the filterbank on its paths, over
+ * several blocks so that filter history is covered. Unused transmit paths
+ * carry noise that the per-carrier engine must ignore.
+ */
+#define MC_ENGINE_LEN		192
+#define MC_ENGINE_BLOCKS	4
+
+static bool testCarrierEngine(size_t m, const std::vector<size_t> &paths)
+{
+	Channelizer rxRef(m, MC_ENGINE_LEN), rx(m, MC_ENGINE_LEN);
+	Synthesis txRef(m, MC_ENGINE_LEN), tx(m, MC_ENGINE_LEN);
+	std::vector<float> in(2 * m * MC_ENGINE_LEN);
+	std::vector<float> out(2 * m * MC_ENGINE_LEN), outRef(out.size());
+	std::normal_distribution<float> dist(0.0f, 1.0f);
+	std::mt19937 rng(m);
+	double err = 0.0, pwr = 0.0;
+
+	if (!rxRef.init() || !rx.init() || !txRef.init() || !tx.init() ||
+	    !rx.setCarriers(paths) || !tx.setCarriers(paths))
+		return false;
+
+	for (int n = 0; n < MC_ENGINE_BLOCKS; n++) {
+		for (size_t i = 0; i < in.size(); i++)
+			in[i] = dist(rng);
+
+		rxRef.rotate(&in[0], m * MC_ENGINE_LEN);
+		rx.rotate(&in[0], m * MC_ENGINE_LEN);
+
+		/* Only the active paths of the reference carry signal */
+		for (size_t k = 0; k < m; k++) {
+			float *buf = tx.inputBuffer(k);
+			for (size_t i = 0; i < 2 * MC_ENGINE_LEN; i++)
+				buf[i] = dist(rng);
+			txRef.resetBuffer(k);
+		}
+
+		for (size_t k = 0; k < paths.size(); k++) {
+			memcpy(txRef.inputBuffer(paths[k]), tx.inputBuffer(paths[k]),
+			       2 * MC_ENGINE_LEN * sizeof(float));
+
+			float *a = rxRef.outputBuffer(paths[k]);
+			float *b = rx.outputBuffer(paths[k]);
+			for (size_t i = 0; i < 2 * MC_ENGINE_LEN; i++) {
+				err += (a[i] - b[i]) * (a[i] - b[i]);
+				pwr += a[i] * a[i];
+			}
+		}
+
+		txRef.rotate(&outRef[0], m * MC_ENGINE_LEN);
+		tx.rotate(&out[0], m * MC_ENGINE_LEN);
+
+		for (size_t i = 0; i < out.size(); i++) {
+			err += (out[i] - outRef[i]) * (out[i] - outRef[i]);
+			pwr += outRef[i] * outRef[i];
+		}
+	}
+
+	if (!(10.0 * log10(err / pwr) < -100.0)) {
+		printf("Per-carrier engine on %zu of %zu paths differs from "
+		       "the filterbank at %.1f dB\n", paths.size(), m,
+		       10.0 * log10(err / pwr));
+		return false;
+	}
+
+	return true;
+}
+
+static bool testCarrierPlan()
+{
+	const int legacyPaths[3][3] = { { 0 }, { 0, 3 }, { 1, 0, 3 } };
+	const double legacyShift[3] = { 0.0, 0.0, 1.0 };
+	CarrierPlan plan;
+	bool rc = true;
+
+	for (size_t chans = 1; chans <= 3; chans++) {
+		plan.init(chans);
+		if (plan.size() != 4 || plan.rate() != MCBTS_SPACING * 4 ||
+		    plan.resampP() != 65 || plan.resampQ() != 48 ||
+		    -plan.offset(0) != legacyShift[chans - 1] * MCBTS_SPACING) {
+			printf("Default layout %s differs for %zu channels\n",
+			       plan.str().c_str(), chans);
+			rc = false;
+		}
+
+		for (size_t i = 0; i < chans; i++) {
+			if (plan.path(i) != legacyPaths[chans - 1][i] ||
+			    plan.chan(plan.path(i)) != (int) i) {
+				printf("Channel %zu of %zu on path %d\n", i, chans,
+				       plan.path(i));
+				rc = false;
+			}
+		}
+	}
+
+	if (plan.init(2, 4, 300e3) || plan.init(1, 4, 200e3) ||
+	    plan.init(2, 4, 800e3, { 2, 0 }) || plan.init(2, 8, 800e3, { 1, 1 }) ||
+	    plan.init(2, 7, 800e3) || plan.init(2, 0, 800e3, { 0 }) ||
+	    plan.init(2, 64, 1600e3)) {
+		printf("Invalid carrier layout accepted\n");
+		rc = false;
+	}
+
+	const int freqs[][2] = { { 4, 1 }, { 4, -1 }, { 8, -3 }, { 5, 2 } };
+	for (size_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); i++) {
+		double freq = carrierFrequency(freqs[i][0], freqs[i][1]);
+		if (!(fabs(freq - freqs[i][1]) < 0.01)) {
+			printf("Carrier %+d of %d paths sent at %+.2f\n",
+			       freqs[i][1], freqs[i][0], freq);
+			rc = false;
+		}
+	}
+
+	if (!testCarrierLoopback(4, 800e3, { -1, 0, 1 }) ||
+	    !testCarrierLoopback(8, 800e3, { 2, -3, 0, 3, -1 }) ||
+	    !testCarrierLoopback(6, 600e3, { 0, 2, -2, 1 }) ||
+	    !testCarrierLoopback(5, 1000e3, { -2, 1, 2 })) {
+		printf("Multi-ARFCN loopback failed\n");
+		rc = false;
+	}
+
+	if (!testCarrierEngine(4, { 0 }) || !testCarrierEngine(4, { 1, 3 }) ||
+	    !testCarrierEngine(8, { 5 }) || !testCarrierEngine(6, { 0, 2, 4 }) ||
+	    !testCarrierEngine(16, { 15, 1 }) || !testCarrierEngine(5, { 2 }) ||
+	    !testCarrierEngine(64, { 1, 32, 63 })) {
+		printf("Per-carrier engine failed\n");
+		rc = false;
+	}
+
+	return rc;
+}
+
+/*
+ * Multi-ARFCN interface cost per carrier as the channelizer grows, with
+ * every usable path carrying a carrier. Cost is processing time per
+ * second of signal, transmit and receive together, against an unpaced
+ * device.
+ */
+#define MC_BENCH_SECONDS	1.0
+
+static void benchCarriers()
+{
+	const size_t sizes[] = { 4, 6, 8, 12, 16 };
+
+	for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+		size_t m = sizes[n], chans = m - 1 + m % 2;
+		CarrierPlan plan;
+
+		if (!plan.init(chans, m))
+			continue;
+
+		TestDevice dev(4, 4, plan.rate());
+		RadioInterfaceMulti radio(&dev, 4, 4, plan);
+		std::vector<signalVector *> bursts(chans);
+		std::vector<bool> zeros(chans, false);
+		size_t total = MC_BENCH_SECONDS * plan.rate();
+
+		dev.paced = false;
+		if (!radio.init(RadioDevice::MULTI_ARFCN) || !radio.start())
+			continue;
+
+		for (size_t i = 0; i < chans; i++) {
+			bursts[i] = new signalVector(625);
+			bursts[i]->fill(MC_LOOP_AMPL);
+		}
+
+		double start = time_now();
+		while (dev.rxSamples < total || dev.txSamples < total) {
+			if (dev.txSamples < total)
+				radio.driveTransmitRadio(bursts, zeros);
+			if (dev.rxSamples < total)
+				radio.driveReceiveRadio();
+
+			for (size_t i = 0; i < chans; i++) {
+				VectorFIFO *fifo = radio.receiveFIFO(i);
+				while (fifo->size())
+					delete fifo->read();
+			}
+		}
+		double elapsed = time_now() - start;
+
+		printf("Multi-ARFCN %2zu paths, %2zu carriers, %5.1f MHz: "
+		       "%5.2f %% of a core per carrier, %5.1f %% total\n",
+		       m, chans, plan.rate() / 1e6,
+		       100.0 * elapsed / MC_BENCH_SECONDS / chans,
+		       100.0 * elapsed / MC_BENCH_SECONDS);
+
+		radio.stop();
+		for (size_t i = 0; i < chans; i++)
+			delete bursts[i];
+	}
+}
+
+/*
+ * Block conversion time of the filterbank and the per-carrier engine for
+ * sparse layouts, receive and transmit together. Runs alternate between
+ * the engines and the fastest run of each counts.
+ */
+#define MC_ENGINE_REPS		200
+#define MC_ENGINE_RUNS		10
+
+struct EngineBench {
+	Channelizer rx;
+	Synthesis tx;
+	std::vector<float> in, out;
+
+	EngineBench(size_t m)
+		: rx(m, MC_ENGINE_LEN), tx(m, MC_ENGINE_LEN),
+		  in(2 * m * MC_ENGINE_LEN, 1.0f), out(in.size())
+	{
+		rx.init();
+		tx.init();
+	}
+
+	double run()
+	{
+		double start = time_now();
+
+		for (int n = 0; n < MC_ENGINE_REPS; n++) {
+			rx.rotate(&in[0], in.size() / 2);
+			tx.rotate(&out[0], out.size() / 2);
+		}
+
+		return (time_now() - start) / MC_ENGINE_REPS;
+	}
+};
+
+static void benchCarrierEngine()
+{
+	const size_t sizes[] = { 4, 8, 16, 32, 64 };
+
+	for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+		size_t m = sizes[n];
+		std::vector<size_t> paths;
+
+		for (size_t k = 1; k <= log2(m); k++) {
+			EngineBench fb(m), pc(m);
+			double tf = INFINITY, tp = INFINITY;
+
+			paths.push_back(k);
+			pc.rx.setCarriers(paths);
+			pc.tx.setCarriers(paths);
+
+			for (int i = 0; i < MC_ENGINE_RUNS; i++) {
+				tf = std::min(tf, fb.run());
+				tp = std::min(tp, pc.run());
+			}
+
+			printf("Multi-ARFCN %2zu paths, %zu carriers: filterbank "
+			       "%6.1f us, per-carrier %6.1f us per block\n",
+			       m, k, tf * 1e6, tp * 1e6);
+		}
+	}
+}
+
+/*
+ * Idle carrier transmit cost per TDMA frame, through the transmit queue
+ * checks and the radio interface, as eight timeslot passes or as one
+ * whole frame pass. Cost is processing time against an unpaced device.
+ */
+#define IDLE_BENCH_FRAMES	20000
+
+static void benchIdleFrames()
+{
+	const size_t chanList[] = { 1, 4 };
+
+	for (size_t n = 0; n < sizeof(chanList) / sizeof(chanList[0]); n++) {
+		size_t chans = chanList[n];
+		TestDevice dev(TEST_TX_SPS, TEST_RX_SPS);
+		RadioInterface radio(&dev, TEST_TX_SPS, TEST_RX_SPS, chans);
+		std::vector<VectorQueue> queues(chans);
+		std::vector<std::vector<signalVector *> > bursts(8);
+		std::vector<std::vector<bool> > zeros(8);
+		signalVector filler(625);
+		double elapsed[2];
+		int writes[2];
+
+		dev.paced = false;
+		if (!radio.init(RadioDevice::NORMAL) || !radio.start())
+			continue;
+
+		filler.fill(MC_LOOP_AMPL);
+		for (size_t tn = 0; tn < 8; tn++) {
+			bursts[tn].assign(chans, &filler);
+			zeros[tn].assign(chans, false);
+		}
+
+		for (int k = 0; k < 2; k++) {
+			int start_writes = dev.writes;
+			double start = time_now();
+
+			for (int fn = 0; fn < IDLE_BENCH_FRAMES; fn++) {
+				for (size_t tn = 0; tn < (k ? 1 : 8); tn++) {
+					GSM::Time time(fn, tn);
+
+					for (size_t i = 0; i < chans; i++) {
+						if (k) {
+							queues[i].idleFrame(time);
+							continue;
+						}
+						delete queues[i].getStaleBurst(time);
+						delete queues[i].getCurrentBurst(time);
+					}
+
+					if (k)
+						radio.driveTransmitFrame(bursts, zeros);
+					else
+						radio.driveTransmitRadio(bursts[tn], zeros[tn]);
+				}
+			}
+
+			elapsed[k] = (time_now() - start) / IDLE_BENCH_FRAMES;
+			writes[k] = dev.writes - start_writes;
+		}
+
+		printf("Idle frames, %zu channels: %6.2f us per frame in "
+		       "timeslots, %6.2f us whole, %.1f / %.1f device writes\n",
+		       chans, elapsed[0] * 1e6, elapsed[1] * 1e6,
+		       (double) writes[0] / IDLE_BENCH_FRAMES,
+		       (double) writes[1] / IDLE_BENCH_FRAMES);
+
+		radio.stop();
+	}
+}
+
+/*
+ * Reference control parsing with sscanf/sprintf, as driveControl() did
+ * before the command table. Only the handover storm commands are handled,
+ * behind the same chain of string compares.
+ */
+static const char *refCommands[] = {
+	"POWEROFF", "POWERON", "HANDOVER", "NOHANDOVER", "SETMAXDLY",
+	"SETMAXDLYNB", "SETRXGAIN", "NOISELEV", "SETPOWER", "ADJPOWER",
+	"RXTUNE", "TXTUNE", "SETTSC", "SETSLOT", "_SETBURSTTODISKMASK",
+	"GETSTATS", "SETSUBTSC", "SETFORMAT",
+};
+
+static void refControl(const char *buffer, char *response)
+{
+	char cmdcheck[4];
+	char command[CTRL_MAX_LEN];
+	int a = 0, b = 0;
+	size_t i;
+
+	sscanf(buffer, "%3s %s", cmdcheck, command);
+	if (strcmp(cmdcheck, "CMD")) {
+		response[0] = '\0';
+		return;
+	}
+
+	for (i = 0; i < CTRL_UNKNOWN; i++) {
+		if (!strcmp(command, refCommands[i]))
+			break;
+	}
+
+	switch (i) {
+	case CTRL_HANDOVER:
+	case CTRL_NOHANDOVER:
+	case CTRL_SETSLOT:
+		sscanf(buffer, "%3s %s %d %d", cmdcheck, command, &a, &b);
+		sprintf(response, "RSP %s 0 %d %d", command, a, b);
+		break;
+	case CTRL_ADJPOWER:
+		sscanf(buffer, "%3s %s %d", cmdcheck, command, &a);
+		sprintf(response, "RSP %s 0 %d", command, a);
+		break;
+	default:
+		sprintf(response, "RSP ERR 1");
+	}
+}
+
+static void tableControl(const char *buffer, size_t len, char *response)
+{
+	CtrlCommand cmd;
+
+	if (!parseCtrlCommand(buffer, len, cmd)) {
+		response[0] = '\0';
+		return;
+	}
+
+	switch (cmd.cmd) {
+	case CTRL_HANDOVER:
+	case CTRL_NOHANDOVER:
+	case CTRL_SETSLOT:
+	case CTRL_ADJPOWER:
+		formatCtrlResponse(response, CTRL_MAX_LEN, cmd.cmd, 0,
+				   cmd.argv, cmd.argc);
+		break;
+	default:
+		formatCtrlResponse(response, CTRL_MAX_LEN, CTRL_UNKNOWN, 1);
+	}
+}
+
+/* Random well-formed message with its expected parse */
+static std::string randomCommand(std::mt19937 &rng, CtrlCommand &expect)
+{
+	static const int special[] = { 0, -1, 7, 8, 999999999, -999999999 };
+	std::ostringstream ss;
+
+	expect.cmd = rng() % CTRL_UNKNOWN;
+	expect.argc = ctrlCommandArgs(expect.cmd);
+
+	ss << "CMD " << ctrlCommandName(expect.cmd);
+	for (int i = 0; i < expect.argc; i++) {
+		if (rng() % 4)
+			expect.argv[i] = (int) (rng() % 2000001) - 1000000;
+		else
+			expect.argv[i] = special[rng() % 6];
+
+		ss << std::string(1 + rng() % 2, ' ') << expect.argv[i];
+	}
+
+	return ss.str();
+}
+
+/*
+ * Command table, parser and formatter
+ *
+ * Every command must hash to its own slot. Well-formed messages must parse
+ * exactly and produce the same responses as sscanf/sprintf. Mutated and
+ * random messages must never be read beyond their length or produce
+ * out-of-range results.
+ */
+static bool testCtrlParser()
+{
+	std::mt19937 rng(1234);
+	char buf[CTRL_MAX_LEN], response[CTRL_MAX_LEN], ref[CTRL_MAX_LEN];
+	CtrlCommand cmd, expect;
+	int fuzz = 0;
+
+	for (int i = 0; i < CTRL_UNKNOWN; i++) {
+		std::string msg = std::string("CMD ") + ctrlCommandName(i);
+
+		if (!parseCtrlCommand(msg.c_str(), msg.size(), cmd) || cmd.cmd != i) {
+			printf("Command %s not found in table\n", ctrlCommandName(i));
+			return false;
+		}
+	}
+
+	/* Optional arguments up to the maximum */
+	const char *sub = "CMD SETSUBTSC 3 5 2";
+	if (!parseCtrlCommand(sub, strlen(sub) + 1, cmd) ||
+	    cmd.cmd != CTRL_SETSUBTSC || cmd.argc != 3 || cmd.argv[2] != 2) {
+		printf("Misparsed \"%s\"\n", sub);
+		return false;
+	}
+
+	for (int n = 0; n < 100000; n++) {
+		std::string msg = randomCommand(rng, expect);
+
+		if (!parseCtrlCommand(msg.c_str(), msg.size() + 1, cmd) ||
+		    cmd.cmd != expect.cmd || cmd.argc != expect.argc ||
+		    memcmp(cmd.argv, expect.argv, cmd.argc * sizeof(int))) {
+			printf("Misparsed \"%s\"\n", msg.c_str());
+			return false;
+		}
+
+		refControl(msg.c_str(), ref);
+		tableControl(msg.c_str(), msg.size() + 1, response);
+		if (strcmp(ref, response)) {
+			printf("Response \"%s\" != \"%s\"\n", response, ref);
+			return false;
+		}
+	}
+
+	for (int n = 0; n < 200000; n++) {
+		std::string msg = randomCommand(rng, expect);
+		size_t len;
+
+		/* Mutate a well-formed message, or replace it with noise */
+		if (n % 4) {
+			len = std::min(msg.size(), sizeof(buf));
+			memcpy(buf, msg.data(), len);
+			for (int i = rng() % 4; i >= 0; i--)
+				buf[rng() % len] = rng();
+			len = rng() % (len + 1);
+		} else {
+			len = rng() % sizeof(buf);
+			for (size_t i = 0; i < len; i++)
+				buf[i] = rng() % 2 ? ' ' + rng() % 64 : rng();
+		}
+
+		/* Exact length heap copy so that overreads are caught */
+		char *exact = new char[len ? len : 1];
+		memcpy(exact, buf, len);
+
+		if (parseCtrlCommand(exact, len, cmd)) {
+			if (cmd.cmd < 0 || cmd.cmd > CTRL_UNKNOWN ||
+			    cmd.argc < 0 || cmd.argc > CTRL_MAX_ARGS ||
+			    cmd.name < exact || cmd.name + cmd.nameLen > exact + len) {
+				printf("Fuzzed message parsed out of range\n");
+				delete[] exact;
+				return false;
+			}
+
+			if (!formatCtrlResponse(response, sizeof(response),
+						cmd.cmd, 1, cmd.argv, cmd.argc)) {
+				printf("Response does not fit\n");
+				delete[] exact;
+				return false;
+			}
+			fuzz++;
+		}
+
+		delete[] exact;
+	}
+
+	if (formatCtrlResponse(response, 8, CTRL_SETSLOT, 0) ||
+	    !formatClockIndication(response, sizeof(response), 2715647) ||
+	    strcmp(response, "IND CLOCK 2715647")) {
+		printf("Formatter bounds\n");
+		return false;
+	}
+
+	printf("Control parser: %d commands, %d of 200000 fuzzed messages "
+	       "accepted\n", CTRL_UNKNOWN, fuzz);
+	return true;
+}
+
+/* Commands per second during a handover storm, table against sscanf */
+static void benchCtrlParser()
+{
+	std::mt19937 rng(1234);
+	std::vector<std::string> msgs;
+	char response[CTRL_MAX_LEN];
+	const int reps = 20;
+	double start, t_ref, t_table;
+
+	for (int n = 0; n < 10000; n++) {
+		char buf[64];
+
+		switch (n % 4) {
+		case 0:
+			snprintf(buf, sizeof(buf), "CMD HANDOVER %d %d",
+				 (int) (rng() % 8), (int) (rng() % 4));
+			break;
+		case 1:
+			snprintf(buf, sizeof(buf), "CMD NOHANDOVER %d %d",
+				 (int) (rng() % 8), (int) (rng() % 4));
+			break;
+		case 2:
+			snprintf(buf, sizeof(buf), "CMD SETSLOT %d %d",
+				 (int) (rng() % 8), (int) (rng() % 14));
+			break;
+		default:
+			snprintf(buf, sizeof(buf), "CMD ADJPOWER %d",
+				 (int) (rng() % 11) - 5);
+		}
+		msgs.push_back(buf);
+	}
+
+	start = time_now();
+	for (int r = 0; r < reps; r++) {
+		for (size_t i = 0; i < msgs.size(); i++)
+			refControl(msgs[i].c_str(), response);
+	}
+	t_ref = time_now() - start;
+
+	start = time_now();
+	for (int r = 0; r < reps; r++) {
+		for (size_t i = 0; i < msgs.size(); i++)
+			tableControl(msgs[i].c_str(), msgs[i].size() + 1, response);
+	}
+	t_table = time_now() - start;
+
+	printf("Control commands: sscanf/sprintf %.2f M/s, table %.2f M/s\n",
+	       reps * msgs.size() / t_ref * 1e-6,
+	       reps * msgs.size() / t_table * 1e-6);
+}
+
+/* Reader thread for the statistics test */
+static volatile bool statsDone;
+static volatile bool statsTorn;
+
+static void *statsReader(AvgStat *stat)
+{
+	while (!statsDone) {
+		float ewma = stat->ewma(), mean = stat->mean();
+
+		if (ewma < 1.0f || ewma > 2.0f || mean < 1.0f || mean > 2.0f)
+			statsTorn = true;
+	}
+
+	return NULL;
+}
+
+/*
+ * Incremental statistics
+ *
+ * Windowed means must match a full recomputation, histograms must clamp
+ * out-of-range values, and a concurrent reader must only ever see values
+ * within the range of the inputs.
+ */
+static bool testStats()
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+	const size_t window = 20;
+	AvgStat stat(window, 0.25f);
+	std::vector<float> vals;
+	float ewma = 0.0f, lo, hi;
+
+	for (int n = 0; n < 10000; n++) {
+		float val = dist(rng);
+		double sum = 0.0;
+
+		vals.push_back(val);
+		stat.update(val);
+		ewma = n ? ewma + 0.25f * (val - ewma) : val;
+
+		size_t num = std::min(vals.size(), window);
+		for (size_t i = vals.size() - num; i < vals.size(); i++)
+			sum += vals[i];
+
+		if (fabs(stat.mean() - sum / num) > 1e-4 ||
+		    fabs(stat.ewma() - ewma) > 1e-4) {
+			printf("Average mismatch after %d updates\n", n + 1);
+			return false;
+		}
+	}
+
+	HistStat hist(-8.0f, 1.0f, 16);
+	hist.update(-100.0f);
+	hist.update(NAN);
+	hist.update(-7.5f);
+	hist.update(3.2f);
+	hist.update(100.0f);
+	if (hist.count(0) != 3 || hist.count(11) != 1 || hist.count(15) != 1) {
+		printf("Histogram binning\n");
+		return false;
+	}
+
+	SlotStats slot;
+	for (int n = 0; n < 7; n++)
+		slot.detected(2.0f + 0.1f * (n % 3));
+	if (slot.toaWindow(lo, hi))
+		return false;
+	slot.detected(2.1f);
+	slot.missed();
+	slot.clipped();
+	slot.tracked(true);
+	slot.tracked(true);
+	slot.tracked(false);
+	if (!slot.toaWindow(lo, hi) || lo > 2.0f || hi < 2.2f ||
+	    slot.detections() != 8 || slot.misses() != 2 || slot.clips() != 1 ||
+	    slot.trackHits() != 2 || slot.trackMisses() != 1) {
+		printf("Timeslot statistics\n");
+		return false;
+	}
+
+	AvgStat shared(window, 0.25f);
+	Thread reader;
+
+	statsDone = false;
+	statsTorn = false;
+	shared.update(1.0f);
+	reader.start((void *(*)(void *)) statsReader, &shared);
+
+	for (int n = 0; n < 1000000; n++)
+		shared.update(n % 2 ? 2.0f : 1.0f);
+
+	statsDone = true;
+	reader.join();
+
+	if (statsTorn) {
+		printf("Reader saw a value outside the input range\n");
+		return false;
+	}
+
+	printf("Statistics: windowed and exponential averages match\n");
+	return true;
+}
+
+/* Per-burst update cost, incremental against recomputing the window */
+static void benchStats()
+{
+	const int num = 2000000;
+	const size_t windows[] = { 20, 128 };
+	SlotStats slot;
+	volatile float sink = 0.0f;
+	double start, t_ref, t_avg, t_slot;
+
+	for (size_t w = 0; w < 2; w++) {
+		std::vector<float> noises(windows[w]);
+		AvgStat noise(noises.size(), 1.0f / noises.size());
+		size_t itr = 0;
+
+		start = time_now();
+		for (int n = 0; n < num; n++) {
+			float val = 0.0f;
+
+			noises[itr++ % noises.size()] = n & 0xff;
+			for (size_t i = 0; i < noises.size(); i++)
+				val += noises[i];
+			sink = val / noises.size();
+		}
+		t_ref = time_now() - start;
+
+		start = time_now();
+		for (int n = 0; n < num; n++) {
+			noise.update(n & 0xff);
+			sink = noise.mean();
+		}
+		t_avg = time_now() - start;
+
+		printf("Noise average per burst, window %zu: recompute %.1f ns, "
+		       "incremental %.1f ns\n", windows[w],
+		       t_ref / num * 1e9, t_avg / num * 1e9);
+	}
+
+	start = time_now();
+	for (int n = 0; n < num; n++) {
+		slot.rssi(40.0f + (n & 0xf));
+		if (n & 3)
+			slot.detected(0.25f * (n & 7));
+		else
+			slot.missed();
+	}
+	t_slot = time_now() - start;
+
+	printf("Full timeslot statistics per burst: %.1f ns\n",
+	       t_slot / num * 1e9);
+	(void) sink;
+}
+
+int main(int argc, char **argv)
+{
+	bool rc;
+
+	gLogInit("TransceiverTest", "WARNING", LOG_LOCAL7);
+
+	convolve_init();
+	convert_init();
+
+	if (argc > 1 && !strcmp(argv[1], "bench")) {
+		benchCtrlParser();
+		benchStats();
+		benchCarriers();
+		benchCarrierEngine();
+		benchIdleFrames();
+		return EXIT_SUCCESS;
+	}
+
+	rc = testCtrlParser();
+	rc &= testStats();
+	rc &= testCarrierPlan();
+	rc &= testDiversityPaths(1, 2);
+	rc &= testDiversityPaths(2, 2);
+	rc &= testDiversityPaths(1, 3);
+	rc &= testRestart(false, TEST_PORT);
+	rc &= testRestart(true, TEST_PORT + 200);
+	rc &= testChannels(TEST_PORT + 400);
+	rc &= testDataFormat(TEST_PORT + 600);
+	rc &= testSubTsc(false, TEST_PORT + 800);
+	rc &= testSubTsc(true, TEST_PORT + 1000);
+
+	if (!rc) {
+		printf("Transceiver test failed\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("Transceiver test passed\n");
+	return EXIT_SUCCESS;
+}
@@ -22,6 +22,7 @@
  */
 
 #include <map>
+#include <math.h>
 #include "radioDevice.h"
 #include "Threads.h"
 #include "Logger.h"
@@ -94,6 +95,12 @@ enum uhd_dev_type {
  *
  * Notes:
  *   USRP1 with timestamps is not supported by UHD.
+ *   4/2 Tx/Rx SPS has no measured values yet. An offset interpolated from
+ *   the 4/1 and 4/4 values would bias every timing report by an unknown
+ *   amount, so 2 Rx SPS is refused on devices without an entry here.
+ *   Multi-ARFCN timing was measured with 4 channelizer paths at 800 kHz
+ *   spacing and the 65/48 resampler. Other carrier plans change the filter
+ *   delays and are refused until measured.
  */
 
 /* Device Type, Tx-SPS, Rx-SPS */
@@ -208,7 +215,7 @@ private:
 class uhd_device : public RadioDevice {
 public:
 	uhd_device(size_t tx_sps, size_t rx_sps, InterfaceType type,
-		   size_t chans, double offset);
+		   size_t chans, double offset, double mcbts_rate);
 	~uhd_device();
 
 	int open(const std::string &args, int ref, bool swap_channels);
@@ -272,7 +279,7 @@ private:
 	enum uhd_dev_type dev_type;
 
 	size_t tx_sps, rx_sps, chans;
-	double tx_rate, rx_rate;
+	double tx_rate, rx_rate, mcbts_rate;
 
 	double tx_gain_min, tx_gain_max;
 	double rx_gain_min, rx_gain_max;
@@ -353,7 +360,8 @@ static void thread_enable_cancel(bool cancel)
 }
 
 uhd_device::uhd_device(size_t tx_sps, size_t rx_sps,
-		       InterfaceType iface, size_t chans, double offset)
+		       InterfaceType iface, size_t chans, double offset,
+		       double mcbts_rate)
 	: tx_gain_min(0.0), tx_gain_max(0.0),
 	  rx_gain_min(0.0), rx_gain_max(0.0),
 	  tx_spp(0), rx_spp(0),
@@ -365,6 +373,7 @@ uhd_device::uhd_device(size_t tx_sps, size_t rx_sps,
 	this->chans = chans;
 	this->offset = offset;
 	this->iface = iface;
+	this->mcbts_rate = mcbts_rate;
 }
 
 uhd_device::~uhd_device()
@@ -426,11 +435,21 @@ void uhd_device::init_gains()
 void uhd_device::set_rates()
 {
 	dev_desc desc = dev_param_map.at(dev_key(dev_type, tx_sps, rx_sps));
-	if (desc.mcr != 0.0)
-		usrp_dev->set_master_clock_rate(desc.mcr);
+	double mcr = desc.mcr;
 
-	tx_rate = (dev_type != B2XX_MCBTS) ? desc.rate * tx_sps : desc.rate;
-	rx_rate = (dev_type != B2XX_MCBTS) ? desc.rate * rx_sps : desc.rate;
+	/*
+	 * Multi-ARFCN rates follow the channelizer size and carrier spacing.
+	 * Clock at the largest integer multiple of the rate that does not
+	 * exceed the nominal master clock.
+	 */
+	if (dev_type == B2XX_MCBTS)
+		mcr = mcbts_rate * floor(desc.mcr / mcbts_rate);
+
+	if (mcr != 0.0)
+		usrp_dev->set_master_clock_rate(mcr);
+
+	tx_rate = (dev_type != B2XX_MCBTS) ? desc.rate * tx_sps : mcbts_rate;
+	rx_rate = (dev_type != B2XX_MCBTS) ? desc.rate * rx_sps : mcbts_rate;
 
 	usrp_dev->set_tx_rate(tx_rate);
 	usrp_dev->set_rx_rate(rx_rate);
@@ -576,6 +595,9 @@ void uhd_device::set_channels(bool swap)
 		chans = 1;
 	}
 
+	if (!dev_param_map.count(dev_key(dev_type, tx_sps, rx_sps)))
+		throw std::invalid_argument("Device timing not measured at requested Tx/Rx SPS");
+
 	if (chans > dev_param_map.at(dev_key(dev_type, tx_sps, rx_sps)).channels)
 		throw std::invalid_argument("Device does not support number of requested channels");
 
@@ -1166,15 +1188,15 @@ double uhd_device::getRxFreq(size_t chan)
 
 /*
  * Only allow sampling the Rx path lower than Tx and not vice-versa.
- * Using Tx with 4 SPS and Rx at 1 SPS is the only allowed mixed
- * combination.
+ * Using Tx with 4 SPS and Rx at 1 or 2 SPS are the only allowed mixed
+ * combinations.
  */
 TIMESTAMP uhd_device::initialWriteTimestamp()
 {
 	if ((iface == MULTI_ARFCN) || (rx_sps == tx_sps))
 		return ts_initial;
 	else
-		return ts_initial * tx_sps;
+		return ts_initial * tx_sps / rx_sps;
 }
 
 TIMESTAMP uhd_device::initialReadTimestamp()
@@ -1450,7 +1472,8 @@ std::string smpl_buf::str_code(ssize_t code)
 }
 
 RadioDevice *RadioDevice::make(size_t tx_sps, size_t rx_sps,
-			       InterfaceType iface, size_t chans, double offset)
+			       InterfaceType iface, size_t chans, double offset,
+			       double mcbts_rate)
 {
-	return new uhd_device(tx_sps, rx_sps, iface, chans, offset);
+	return new uhd_device(tx_sps, rx_sps, iface, chans, offset, mcbts_rate);
 }
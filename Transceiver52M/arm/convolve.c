@@ -38,9 +38,23 @@ int _base_convolve_complex(float *x, int x_len,
 			   int start, int len,
 			   int step, int offset);
 
+int _base_convolve_decim_real(const float *x, int x_len,
+			      const float *h, int h_len,
+			      float *y, int y_len,
+			      int start, int len, int decim);
+
 int bounds_check(int x_len, int h_len, int y_len,
 		 int start, int len, int step);
 
+int decim_bounds_check(int x_len, int h_len, int y_len,
+		       int start, int len, int decim);
+
+int _base_convolve_real_lanes(const float *x, int x_len,
+			      const float *h, int h_len,
+			      float *y, int len, int lanes);
+
+int lanes_bounds_check(int x_len, int h_len, int len, int lanes);
+
 #ifdef HAVE_NEON
 /* Calls into NEON assembler */
 void neon_conv_real4(float *x, float *h, float *y, int len);
@@ -144,3 +158,34 @@ int convolve_complex(float *x, int x_len,
 
 	return len;
 }
+
+/* API: Aligned decimating complex-real */
+int convolve_decim_real(const float *x, int x_len,
+			const float *h, int h_len,
+			float *y, int y_len,
+			int start, int len, int decim)
+{
+	if (decim_bounds_check(x_len, h_len, y_len, start, len, decim) < 0)
+		return -1;
+
+	memset(y, 0, len * 2 * sizeof(float));
+
+	return _base_convolve_decim_real(x, x_len,
+					 h, h_len,
+					 y, y_len,
+					 start, len, decim);
+}
+
+/* API: Complex-real across lanes with per lane taps */
+int convolve_real_lanes(const float *x, int x_len,
+			const float *h, int h_len,
+			float *y, int len, int lanes)
+{
+	if (lanes_bounds_check(x_len, h_len, len, lanes) < 0)
+		return -1;
+
+	memset(y, 0, len * lanes * 2 * sizeof(float));
+
+	return _base_convolve_real_lanes(x, x_len, h, h_len,
+					 y, len, lanes);
+}
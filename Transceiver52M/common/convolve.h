@@ -15,6 +15,15 @@ int convolve_complex(const float *x, int x_len,
 		     int start, int len,
 		     int step, int offset);
 
+int convolve_decim_real(const float *x, int x_len,
+			const float *h, int h_len,
+			float *y, int y_len,
+			int start, int len, int decim);
+
+int convolve_real_lanes(const float *x, int x_len,
+			const float *h, int h_len,
+			float *y, int len, int lanes);
+
 int base_convolve_real(const float *x, int x_len,
 		       const float *h, int h_len,
 		       float *y, int y_len,
@@ -89,6 +89,48 @@ int _base_convolve_complex(const float *x, int x_len,
 	return len;
 }
 
+/* Base decimating complex-real convolution */
+int _base_convolve_decim_real(const float *x, int x_len,
+			      const float *h, int h_len,
+			      float *y, int y_len,
+			      int start, int len, int decim)
+{
+	for (int i = 0; i < len; i++) {
+		mac_real_vec_n(&x[2 * (decim * i - (h_len - 1) + start)],
+			       h,
+			       &y[2 * i], h_len,
+			       1, 0);
+	}
+
+	return len;
+}
+
+/*
+ * Base complex-real convolution of independent signals in lanes, each lane
+ * with its own taps. Rows hold one interleaved complex sample of every lane
+ * and tap rows hold the real tap of every lane twice, once for each of its
+ * real and imaginary parts. Output row i is formed from input rows i
+ * through i + h_len - 1.
+ */
+int _base_convolve_real_lanes(const float *x, int x_len,
+			      const float *h, int h_len,
+			      float *y, int len, int lanes)
+{
+	int width = 2 * lanes;
+
+	for (int i = 0; i < len; i++) {
+		for (int k = 0; k < h_len; k++) {
+			const float *_x = &x[(i + k) * width];
+			const float *_h = &h[k * width];
+
+			for (int n = 0; n < width; n++)
+				y[i * width + n] += _x[n] * _h[n];
+		}
+	}
+
+	return len;
+}
+
 /* Buffer validity checks */
 int bounds_check(int x_len, int h_len, int y_len,
 		 int start, int len, int step)
@@ -109,6 +151,41 @@ int bounds_check(int x_len, int h_len, int y_len,
 	return 0;
 }
 
+/* Decimating buffer validity checks */
+int decim_bounds_check(int x_len, int h_len, int y_len,
+		       int start, int len, int decim)
+{
+	if ((decim < 1) || bounds_check(x_len, h_len, y_len,
+					start, len, 1) < 0)
+		return -1;
+
+	if (start + (len - 1) * decim >= x_len) {
+		fprintf(stderr, "Convolve: Decimation boundary exception\n");
+		fprintf(stderr, "start: %i, len: %i, decim: %i, x: %i\n",
+				start, len, decim, x_len);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Lane buffer validity checks */
+int lanes_bounds_check(int x_len, int h_len, int len, int lanes)
+{
+	if ((x_len < 1) || (h_len < 1) || (len < 1) || (lanes < 1)) {
+		fprintf(stderr, "Convolve: Invalid input\n");
+		return -1;
+	}
+
+	if (len + h_len - 1 > x_len) {
+		fprintf(stderr, "Convolve: Lane boundary exception\n");
+		fprintf(stderr, "len: %i, x: %i, h: %i\n", len, x_len, h_len);
+		return -1;
+	}
+
+	return 0;
+}
+
 /* API: Non-aligned (no SSE) complex-real */
 int base_convolve_real(const float *x, int x_len,
 		       const float *h, int h_len,
@@ -32,6 +32,47 @@ struct fft_hdl {
 	fftwf_plan fft_plan;
 };
 
+/* Wisdom state, see fft_load_wisdom() */
+static int fft_wisdom_loaded = 0;
+static int fft_wisdom_dirty = 0;
+
+/* Measured plan, taken from the wisdom when it covers the plan */
+static fftwf_plan plan_many(int reverse, int m, int howmany,
+			    float *in, int istride, int idist,
+			    float *out, int ostride, int odist)
+{
+	int rank = 1;
+	int n[] = { m };
+	int *inembed = n;
+	int *onembed = n;
+	fftwf_plan plan = NULL;
+
+	int direction = FFTW_FORWARD;
+	if (reverse)
+		direction = FFTW_BACKWARD;
+
+	if (fft_wisdom_loaded) {
+		plan = fftwf_plan_many_dft(rank, n, howmany,
+					(fftwf_complex *) in, inembed,
+					istride, idist,
+					(fftwf_complex *) out, onembed,
+					ostride, odist,
+					direction, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+	}
+
+	if (!plan) {
+		plan = fftwf_plan_many_dft(rank, n, howmany,
+					(fftwf_complex *) in, inembed,
+					istride, idist,
+					(fftwf_complex *) out, onembed,
+					ostride, odist,
+					direction, FFTW_MEASURE);
+		fft_wisdom_dirty = 1;
+	}
+
+	return plan;
+}
+
 /*! \brief Initialize FFT backend 
  *  \param[in] reverse FFT direction
  *  \param[in] m FFT length 
@@ -49,36 +90,62 @@ struct fft_hdl {
  *
  * It is currently unknown how the offset of the output buffer affects FFTW
  * memory alignment.
+ *
+ * Plans are measured. With wisdom loaded, plans covered by the wisdom are
+ * taken from it without measurement.
  */
 struct fft_hdl *init_fft(int reverse, int m, int istride, int ostride,
 			 float *in, float *out, int ooffset)
 {
-	int rank = 1;
-	int n[] = { m };
-	int howmany = istride;
-	int idist = 1;
-	int odist = 1;
-	int *inembed = n;
-	int *onembed = n;
-	fftwf_complex *obuffer, *ibuffer;
-
 	struct fft_hdl *hdl = (struct fft_hdl *) malloc(sizeof(struct fft_hdl));
 	if (!hdl)
 		return NULL;
 
-	int direction = FFTW_FORWARD;
-	if (reverse)
-		direction = FFTW_BACKWARD;
+	hdl->fft_in = in;
+	hdl->fft_out = out;
+	hdl->fft_plan = plan_many(reverse, m, istride, in, istride, 1,
+				  out + 2 * ooffset, ostride, 1);
+
+	if (!hdl->fft_plan) {
+		free(hdl);
+		return NULL;
+	}
+
+	return hdl;
+}
 
-	ibuffer = (fftwf_complex *) in;
-	obuffer = (fftwf_complex *) out + ooffset;
+/*! \brief Initialize FFT backend with arbitrary strides
+ *  \param[in] reverse FFT direction
+ *  \param[in] m FFT length
+ *  \param[in] howmany number of transforms
+ *  \param[in] in first input sample of the first transform
+ *  \param[in] istride distance between samples of a transform, may be
+ *             negative to read each transform backwards
+ *  \param[in] idist distance between the first samples of transforms
+ *  \param[in] out first output sample of the first transform
+ *  \param[in] ostride distance between samples of a transform
+ *  \param[in] odist distance between the first samples of transforms
+ *
+ * Strides and distances count complex samples.
+ */
+struct fft_hdl *init_fft_many(int reverse, int m, int howmany,
+			      float *in, int istride, int idist,
+			      float *out, int ostride, int odist)
+{
+	struct fft_hdl *hdl = (struct fft_hdl *) malloc(sizeof(struct fft_hdl));
+	if (!hdl)
+		return NULL;
 
 	hdl->fft_in = in;
 	hdl->fft_out = out;
-	hdl->fft_plan = fftwf_plan_many_dft(rank, n, howmany,
-					    ibuffer, inembed, istride, idist,
-					    obuffer, onembed, ostride, odist,
-					    direction, FFTW_MEASURE);
+	hdl->fft_plan = plan_many(reverse, m, howmany, in, istride, idist,
+				  out, ostride, odist);
+
+	if (!hdl->fft_plan) {
+		free(hdl);
+		return NULL;
+	}
+
 	return hdl;
 }
 
@@ -110,3 +177,54 @@ int cxvec_fft(struct fft_hdl *hdl)
 	fftwf_execute(hdl->fft_plan);
 	return 0;
 }
+
+/*! \brief Run the initialized plan on other buffers
+ *  \param[in] hdl handle to an intitialized fft struct
+ *  \param[in] in input buffer (FFTW aligned)
+ *  \param[out] out output buffer (FFTW aligned)
+ *
+ * Buffers must have the same layout and alignment as those given to
+ * init_fft(). Unlike cxvec_fft(), concurrent calls on the same handle with
+ * different buffers are safe.
+ */
+int cxvec_fft_buf(struct fft_hdl *hdl, float *in, float *out)
+{
+	fftwf_execute_dft(hdl->fft_plan,
+			  (fftwf_complex *) in, (fftwf_complex *) out);
+	return 0;
+}
+
+/*! \brief Import FFTW wisdom
+ *  \param[in] path wisdom file written by fft_save_wisdom()
+ *  \return 0 on success, -1 if the file is missing or not valid wisdom
+ *
+ * Call before init_fft() so that planning is served from the wisdom.
+ */
+int fft_load_wisdom(const char *path)
+{
+	if (!fftwf_import_wisdom_from_filename(path))
+		return -1;
+
+	fft_wisdom_loaded = 1;
+	return 0;
+}
+
+/*! \brief Export FFTW wisdom of all plans made so far
+ *  \param[in] path wisdom file
+ *  \return 0 on success, -1 on write failure
+ */
+int fft_save_wisdom(const char *path)
+{
+	if (!fftwf_export_wisdom_to_filename(path))
+		return -1;
+
+	fft_wisdom_dirty = 0;
+	return 0;
+}
+
+/*! \brief Check for plans measured since wisdom was last loaded or saved
+ */
+int fft_wisdom_changed(void)
+{
+	return fft_wisdom_dirty;
+}
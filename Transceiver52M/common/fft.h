@@ -5,9 +5,16 @@ struct fft_hdl;
 
 struct fft_hdl *init_fft(int reverse, int m, int istride, int ostride,
 			 float *in, float *out, int ooffset);
+struct fft_hdl *init_fft_many(int reverse, int m, int howmany,
+			      float *in, int istride, int idist,
+			      float *out, int ostride, int odist);
 void *fft_malloc(size_t size);
 void fft_free(void *ptr);
 void free_fft(struct fft_hdl *hdl);
 int cxvec_fft(struct fft_hdl *hdl);
+int cxvec_fft_buf(struct fft_hdl *hdl, float *in, float *out);
+int fft_load_wisdom(const char *path);
+int fft_save_wisdom(const char *path);
+int fft_wisdom_changed(void);
 
 #endif /* _FFT_H_ */
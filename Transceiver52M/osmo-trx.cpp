@@ -22,6 +22,7 @@
 
 #include "Transceiver.h"
 #include "radioDevice.h"
+#include "sigProcLib.h"
 
 #include <time.h>
 #include <signal.h>
@@ -36,6 +37,7 @@
 extern "C" {
 #include "convolve.h"
 #include "convert.h"
+#include "fft.h"
 }
 
 /* Samples-per-symbol for downlink path
@@ -51,7 +53,8 @@ extern "C" {
  * Samples-per-symbol for uplink (receiver) path
  *     Do not modify this value. EDGE configures 4 sps automatically on
  *     B200/B210 devices only. Use of 4 sps on the receive path for other
- *     configurations is not supported.
+ *     configurations is not supported. 2 sps is available with 4 sps
+ *     transmit on devices that support split 4/4 rates.
  */
 #define DEFAULT_RX_SPS		1
 
@@ -60,6 +63,10 @@ extern "C" {
 #define DEFAULT_TRX_IP		"127.0.0.1"
 #define DEFAULT_CHANS		1
 
+/* FFTW wisdom and precomputed DSP tables within the cache directory */
+#define WISDOM_FILE		"fftw-wisdom"
+#define TABLE_FILE		"dsp-tables"
+
 struct trx_config {
 	std::string log_level;
 	std::string local_addr;
@@ -69,17 +76,28 @@ struct trx_config {
 	unsigned tx_sps;
 	unsigned rx_sps;
 	unsigned chans;
+	unsigned paths;
 	unsigned rtsc;
 	unsigned rach_delay;
 	bool extref;
 	bool gpsref;
 	Transceiver::FillerType filler;
 	bool mcbts;
+	unsigned mcbts_size;
+	double mcbts_spacing;
+	std::vector<int> mcbts_map;
+	CarrierPlan plan;
 	double offset;
 	double rssi_offset;
 	bool swap_channels;
 	bool edge;
 	int sched_rr;
+	bool mrc;
+	int equalizer;
+	unsigned eq_budget;
+	bool freq_correction;
+	bool warm_restart;
+	std::string cache_dir;
 };
 
 ConfigurationTable gConfig;
@@ -95,15 +113,46 @@ volatile bool gshutdown = false;
  */
 bool trx_setup_config(struct trx_config *config)
 {
-	std::string refstr, fillstr, divstr, mcstr, edgestr;
+	std::string refstr, fillstr, divstr, mcstr, edgestr, eqstr, freqstr;
+
+	if (config->mcbts && !config->plan.init(config->chans, config->mcbts_size,
+						 config->mcbts_spacing,
+						 config->mcbts_map)) {
+		std::cout << "Unsupported multi-ARFCN configuration" << std::endl;
+		return false;
+	}
 
-	if (config->mcbts && config->chans > 5) {
-		std::cout << "Unsupported number of channels" << std::endl;
+	/* Device timing is only measured on 4 paths at the default spacing,
+	 * other sizes and spacings change the filter and resampler delays */
+	if (config->mcbts && ((config->plan.size() != 4) ||
+			      (config->plan.spacing() != MCBTS_SPACING))) {
+		std::cout << "Multi-ARFCN timing not measured for "
+			  << config->plan.size() << " paths at "
+			  << config->plan.spacing() / 1e3 << " kHz spacing"
+			  << std::endl;
 		return false;
 	}
 
 	edgestr = config->edge ? "Enabled" : "Disabled";
-	mcstr = config->mcbts ? "Enabled" : "Disabled";
+	mcstr = config->mcbts ? "Enabled, " + config->plan.str() : "Disabled";
+	if (config->paths < 2)
+		divstr = "Disabled";
+	else if (config->mrc)
+		divstr = "Maximal ratio, " + std::to_string(config->paths) + " paths";
+	else
+		divstr = "Selection, " + std::to_string(config->paths) + " paths";
+	freqstr = config->freq_correction ? "Enabled" : "Disabled";
+
+	switch (config->equalizer) {
+	case EQ_DFE:
+		eqstr = "Decision feedback";
+		break;
+	case EQ_MLSE:
+		eqstr = "Reduced state MLSE";
+		break;
+	default:
+		eqstr = "Disabled";
+	}
 
 	if (config->extref)
 		refstr = "External";
@@ -144,9 +193,15 @@ bool trx_setup_config(struct trx_config *config)
 	ost << "   Reference............... " << refstr << std::endl;
 	ost << "   C0 Filler Table......... " << fillstr << std::endl;
 	ost << "   Multi-Carrier........... " << mcstr << std::endl;
+	ost << "   Receive diversity....... " << divstr << std::endl;
+	ost << "   Equalizer............... " << eqstr << std::endl;
+	ost << "   Equalizer budget (us)... " << config->eq_budget << std::endl;
+	ost << "   Frequency correction.... " << freqstr << std::endl;
 	ost << "   Tuning offset........... " << config->offset << std::endl;
 	ost << "   RSSI to dBm offset...... " << config->rssi_offset << std::endl;
 	ost << "   Swap channels........... " << config->swap_channels << std::endl;
+	ost << "   Warm restart............ " << config->warm_restart << std::endl;
+	ost << "   Cache directory......... " << config->cache_dir << std::endl;
 	std::cout << ost << std::endl;
 
 	return true;
@@ -167,7 +222,8 @@ RadioInterface *makeRadioInterface(struct trx_config *config,
 	switch (type) {
 	case RadioDevice::NORMAL:
 		radio = new RadioInterface(usrp, config->tx_sps,
-					   config->rx_sps, config->chans);
+					   config->rx_sps, config->chans,
+					   config->paths);
 		break;
 	case RadioDevice::RESAMP_64M:
 	case RadioDevice::RESAMP_100M:
@@ -176,13 +232,19 @@ RadioInterface *makeRadioInterface(struct trx_config *config,
 		break;
 	case RadioDevice::MULTI_ARFCN:
 		radio = new RadioInterfaceMulti(usrp, config->tx_sps,
-						config->rx_sps, config->chans);
+						config->rx_sps, config->plan);
 		break;
 	default:
 		LOG(ALERT) << "Unsupported radio interface configuration";
 		return NULL;
 	}
 
+	if ((config->paths > 1) && (type != RadioDevice::NORMAL)) {
+		LOG(ALERT) << "Receive diversity unavailable on this device";
+		delete radio;
+		return NULL;
+	}
+
 	if (!radio->init(type)) {
 		LOG(ALERT) << "Failed to initialize radio interface";
 		return NULL;
@@ -207,7 +269,11 @@ Transceiver *makeTransceiver(struct trx_config *config, RadioInterface *radio)
 			      config->rx_sps, config->chans, GSM::Time(3,0),
 			      radio, config->rssi_offset);
 	if (!trx->init(config->filler, config->rtsc,
-		       config->rach_delay, config->edge)) {
+		       config->rach_delay, config->edge,
+		       config->mrc ? Transceiver::COMBINE_MRC :
+				     Transceiver::COMBINE_SELECT,
+		       config->warm_restart, config->equalizer,
+		       config->eq_budget, config->freq_correction)) {
 		LOG(ALERT) << "Failed to initialize transceiver";
 		delete trx;
 		return NULL;
@@ -254,11 +320,19 @@ static void print_help()
 		"  -j    IP address of osmo-trx\n"
 		"  -p    Base port number\n"
 		"  -e    Enable EDGE receiver\n"
+		"  -D    Receive diversity paths per channel, not with -m (default=1)\n"
+		"  -d    Maximal ratio combining of diversity paths, needs -D, not with -e or -b 2\n"
+		"  -E    Equalizer on timeslots with multipath (none, dfe or mlse, default=none), not with -e or -b 2\n"
+		"  -B    Equalizer processing time limit per burst in microseconds (default=none)\n"
+		"  -F    Enable uplink carrier frequency offset correction, not with -e or -b 2\n"
 		"  -m    Enable multi-ARFCN transceiver (default=disabled)\n"
+		"  -M    Multi-ARFCN channelizer size (default=auto), timing measured for 4 only\n"
+		"  -G    Multi-ARFCN carrier spacing in kHz (default=800), timing measured for 800 only\n"
+		"  -P    Multi-ARFCN carrier offsets in spacings, comma separated (default=contiguous)\n"
 		"  -x    Enable external 10 MHz reference\n"
 		"  -g    Enable GPSDO reference\n"
 		"  -s    Tx samples-per-symbol (1 or 4)\n"
-		"  -b    Rx samples-per-symbol (1 or 4)\n"
+		"  -b    Rx samples-per-symbol (1, 2 or 4), 2 needs measured device timing\n"
 		"  -c    Number of ARFCN channels (default=1)\n"
 		"  -f    Enable C0 filler table\n"
 		"  -o    Set baseband frequency offset (default=auto)\n"
@@ -266,7 +340,9 @@ static void print_help()
 		"  -A    Random Access Burst test mode with delay\n"
 		"  -R    RSSI to dBm offset in dB (default=0)\n"
 		"  -S    Swap channels (UmTRX only)\n"
-		"  -t    SCHED_RR real-time priority (1..32)\n",
+		"  -t    SCHED_RR real-time priority (1..32)\n"
+		"  -W    Keep device running across POWEROFF (warm restart)\n"
+		"  -C    Directory for FFTW wisdom and DSP tables (default=none)\n",
 		"EMERG, ALERT, CRT, ERR, WARNING, NOTICE, INFO, DEBUG");
 }
 
@@ -281,19 +357,29 @@ static void handle_options(int argc, char **argv, struct trx_config *config)
 	config->tx_sps = DEFAULT_TX_SPS;
 	config->rx_sps = DEFAULT_RX_SPS;
 	config->chans = DEFAULT_CHANS;
+	config->paths = 1;
 	config->rtsc = 0;
 	config->rach_delay = 0;
 	config->extref = false;
 	config->gpsref = false;
 	config->filler = Transceiver::FILLER_ZERO;
 	config->mcbts = false;
+	config->mcbts_size = 0;
+	config->mcbts_spacing = MCBTS_SPACING;
+	config->mcbts_map.clear();
 	config->offset = 0.0;
 	config->rssi_offset = 0.0;
 	config->swap_channels = false;
 	config->edge = false;
 	config->sched_rr = -1;
-
-	while ((option = getopt(argc, argv, "ha:l:i:j:p:c:dmxgfo:s:b:r:A:R:Set:")) != -1) {
+	config->mrc = false;
+	config->equalizer = EQ_NONE;
+	config->eq_budget = 0;
+	config->freq_correction = false;
+	config->warm_restart = false;
+	config->cache_dir = "";
+
+	while ((option = getopt(argc, argv, "ha:l:i:j:p:c:D:dE:B:FmM:G:P:xgfo:s:b:r:A:R:Set:WC:")) != -1) {
 		switch (option) {
 		case 'h':
 			print_help();
@@ -320,6 +406,18 @@ static void handle_options(int argc, char **argv, struct trx_config *config)
 		case 'm':
 			config->mcbts = true;
 			break;
+		case 'M':
+			config->mcbts_size = atoi(optarg);
+			break;
+		case 'G':
+			config->mcbts_spacing = atof(optarg) * 1e3;
+			break;
+		case 'P':
+			if (!CarrierPlan::parseOffsets(optarg, config->mcbts_map)) {
+				printf("Invalid carrier offsets %s\n\n", optarg);
+				goto bad_config;
+			}
+			break;
 		case 'x':
 			config->extref = true;
 			break;
@@ -355,9 +453,37 @@ static void handle_options(int argc, char **argv, struct trx_config *config)
 		case 'e':
 			config->edge = true;
 			break;
+		case 'D':
+			config->paths = atoi(optarg);
+			break;
+		case 'd':
+			config->mrc = true;
+			break;
+		case 'E':
+			if (!strcmp(optarg, "dfe")) {
+				config->equalizer = EQ_DFE;
+			} else if (!strcmp(optarg, "mlse")) {
+				config->equalizer = EQ_MLSE;
+			} else if (strcmp(optarg, "none")) {
+				printf("Unknown equalizer %s\n\n", optarg);
+				goto bad_config;
+			}
+			break;
+		case 'B':
+			config->eq_budget = atoi(optarg);
+			break;
+		case 'F':
+			config->freq_correction = true;
+			break;
 		case 't':
 			config->sched_rr = atoi(optarg);
 			break;
+		case 'W':
+			config->warm_restart = true;
+			break;
+		case 'C':
+			config->cache_dir = optarg;
+			break;
 		default:
 			print_help();
 			exit(0);
@@ -384,6 +510,38 @@ static void handle_options(int argc, char **argv, struct trx_config *config)
 		goto bad_config;
 	}
 
+	if ((config->rx_sps == 2) && (config->tx_sps != 4)) {
+		printf("2 Rx samples-per-symbol requires 4 Tx samples-per-symbol\n\n");
+		goto bad_config;
+	}
+
+	if ((config->equalizer != EQ_NONE) &&
+	    (config->edge || (config->rx_sps == 2))) {
+		printf("Equalizer unavailable with EDGE or 2 Rx samples-per-symbol\n\n");
+		goto bad_config;
+	}
+
+	if (config->freq_correction &&
+	    (config->edge || (config->rx_sps == 2))) {
+		printf("Frequency correction unavailable with EDGE or 2 Rx samples-per-symbol\n\n");
+		goto bad_config;
+	}
+
+	if (!config->paths || ((config->paths > 1) && config->mcbts)) {
+		printf("Unsupported receive diversity paths %u\n\n", config->paths);
+		goto bad_config;
+	}
+
+	if (config->mrc && (config->paths < 2)) {
+		printf("Diversity combining requires multiple receive paths\n\n");
+		goto bad_config;
+	}
+
+	if (config->mrc && (config->edge || (config->rx_sps == 2))) {
+		printf("Diversity combining unavailable with EDGE or 2 Rx samples-per-symbol\n\n");
+		goto bad_config;
+	}
+
 	if (config->rtsc > 7) {
 		printf("Invalid training sequence %i\n\n", config->rtsc);
 		goto bad_config;
@@ -401,6 +559,37 @@ bad_config:
 	exit(0);
 }
 
+static double time_now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Load FFTW wisdom and point the signal processing library at its table
+ * file, so that a restart skips FFT plan measurement and table generation.
+ * Both are regenerated if missing or invalid.
+ */
+static void load_cache(struct trx_config *config)
+{
+	std::string wisdom = config->cache_dir + "/" + WISDOM_FILE;
+
+	if (fft_load_wisdom(wisdom.c_str()) < 0)
+		LOG(NOTICE) << "No FFTW wisdom at " << wisdom << ", measuring plans";
+
+	setTableFile(config->cache_dir + "/" + TABLE_FILE);
+}
+
+static void save_cache(struct trx_config *config)
+{
+	std::string wisdom = config->cache_dir + "/" + WISDOM_FILE;
+
+	if (fft_wisdom_changed() && (fft_save_wisdom(wisdom.c_str()) < 0))
+		LOG(WARNING) << "Failed to write FFTW wisdom to " << wisdom;
+}
+
 static int set_sched_rr(int prio)
 {
 	struct sched_param param;
@@ -419,6 +608,7 @@ static int set_sched_rr(int prio)
 int main(int argc, char *argv[])
 {
 	int type, chans, ref;
+	double t0, t1, t2, t3;
 	RadioDevice *usrp;
 	RadioInterface *radio = NULL;
 	Transceiver *trx = NULL;
@@ -471,6 +661,10 @@ int main(int argc, char *argv[])
 
 	srandom(time(NULL));
 
+	t0 = time_now();
+	if (!config.cache_dir.empty())
+		load_cache(&config);
+
 	/* Create the low level device object */
 	if (config.mcbts)
 		iface = RadioDevice::MULTI_ARFCN;
@@ -483,22 +677,33 @@ int main(int argc, char *argv[])
 		ref = RadioDevice::REF_INTERNAL;
 
 	usrp = RadioDevice::make(config.tx_sps, config.rx_sps, iface,
-				 config.chans, config.offset);
+				 config.chans * config.paths, config.offset,
+				 config.mcbts ? config.plan.rate() : MCBTS_SPACING * 4);
 	type = usrp->open(config.dev_args, ref, config.swap_channels);
 	if (type < 0) {
 		LOG(ALERT) << "Failed to create radio device" << std::endl;
 		goto shutdown;
 	}
+	t1 = time_now();
 
 	/* Setup the appropriate device interface */
 	radio = makeRadioInterface(&config, usrp, type);
 	if (!radio)
 		goto shutdown;
+	t2 = time_now();
 
 	/* Create the transceiver core */
 	trx = makeTransceiver(&config, radio);
 	if (!trx)
 		goto shutdown;
+	t3 = time_now();
+
+	if (!config.cache_dir.empty())
+		save_cache(&config);
+
+	LOG(NOTICE) << "Startup: device " << (t1 - t0) * 1e3
+		    << " ms, radio interface " << (t2 - t1) * 1e3
+		    << " ms, transceiver " << (t3 - t2) * 1e3 << " ms";
 
 	chans = trx->numChans();
 	std::cout << "-- Transceiver active with "
@@ -93,6 +93,38 @@ const float *RadioBuffer::getReadSegment()
 	return segments[num];
 }
 
+/*
+ * Output direction
+ *
+ * Return a pointer to the oldest segment followed by up to num - 1 further
+ * segments that are contiguous in memory. On return num holds the number of
+ * segments consumed or zero if a complete segment is not available.
+ */
+const float *RadioBuffer::getReadSegments(size_t &num)
+{
+	size_t first = readIndex / segmentLen;
+	size_t avail = availSamples / segmentLen;
+
+	if (num > avail)
+		num = avail;
+	if (num > numSegments - first)
+		num = numSegments - first;
+
+	if (!num)
+		return NULL;
+
+	const float *segment = getReadSegment();
+	if (!segment) {
+		num = 0;
+		return NULL;
+	}
+
+	availSamples -= (num - 1) * segmentLen;
+	readIndex = (readIndex + (num - 1) * segmentLen) % bufferLen;
+
+	return segment;
+}
+
 /*
  * Output direction
  *
@@ -28,6 +28,7 @@ public:
 
 	/* Output direction */
 	const float *getReadSegment();
+	const float *getReadSegments(size_t &num);
 	bool write(const float *wr, size_t len);
 	bool zero(size_t len);
 
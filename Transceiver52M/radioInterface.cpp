@@ -31,9 +31,10 @@ extern "C" {
 #define NUMCHUNKS	4
 
 RadioInterface::RadioInterface(RadioDevice *wRadio, size_t tx_sps,
-                               size_t rx_sps, size_t chans,
+                               size_t rx_sps, size_t chans, size_t paths,
                                int wReceiveOffset, GSM::Time wStartTime)
   : mRadio(wRadio), mSPSTx(tx_sps), mSPSRx(rx_sps), mChans(chans),
+    mPaths(paths),
     underrun(false), overrun(false), receiveOffset(wReceiveOffset), mOn(false)
 {
   mClock.set(wStartTime);
@@ -46,28 +47,40 @@ RadioInterface::~RadioInterface(void)
 
 bool RadioInterface::init(int type)
 {
-  if ((type != RadioDevice::NORMAL) || !mChans) {
+  if ((type != RadioDevice::NORMAL) || !mChans || !mPaths) {
     LOG(ALERT) << "Invalid configuration";
     return false;
   }
 
   close();
 
+  /*
+   * Each channel occupies mPaths consecutive device channels, the first
+   * of which transmits. Receive buffers are kept per device channel and
+   * transmit buffers per channel, with the device buffers of the other
+   * paths left zeroed.
+   */
+  size_t dev_chans = mChans * mPaths;
+
   sendBuffer.resize(mChans);
-  recvBuffer.resize(mChans);
-  convertSendBuffer.resize(mChans);
-  convertRecvBuffer.resize(mChans);
+  recvBuffer.resize(dev_chans);
+  convertSendBuffer.resize(dev_chans);
+  convertRecvBuffer.resize(dev_chans);
   mReceiveFIFO.resize(mChans);
   powerScaling.resize(mChans);
 
   for (size_t i = 0; i < mChans; i++) {
     sendBuffer[i] = new RadioBuffer(NUMCHUNKS, CHUNK * mSPSTx, 0, true);
+    powerScaling[i] = 1.0;
+  }
+
+  for (size_t i = 0; i < dev_chans; i++) {
     recvBuffer[i] = new RadioBuffer(NUMCHUNKS, CHUNK * mSPSRx, 0, false);
 
-    convertSendBuffer[i] = new short[CHUNK * mSPSTx * 2];
+    convertSendBuffer[i] = new short[NUMCHUNKS * CHUNK * mSPSTx * 2];
+    memset(convertSendBuffer[i], 0, NUMCHUNKS * CHUNK * mSPSTx * 2 *
+           sizeof(short));
     convertRecvBuffer[i] = new short[CHUNK * mSPSRx * 2];
-
-    powerScaling[i] = 1.0;
   }
 
   return true;
@@ -101,7 +114,8 @@ int RadioInterface::setPowerAttenuation(int atten, size_t chan)
   if (atten < 0.0)
     atten = 0.0;
 
-  rfGain = mRadio->setTxGain(mRadio->maxTxGain() - (double) atten, chan);
+  rfGain = mRadio->setTxGain(mRadio->maxTxGain() - (double) atten,
+                            chan * mPaths);
   digAtten = (double) atten - mRadio->maxTxGain() + rfGain;
 
   if (digAtten < 1.0)
@@ -135,14 +149,25 @@ int RadioInterface::unRadioifyVector(signalVector *newVector, size_t chan)
   return newVector->size();
 }
 
+/* Diversity paths of a channel are tuned together */
 bool RadioInterface::tuneTx(double freq, size_t chan)
 {
-  return mRadio->setTxFreq(freq, chan);
+  for (size_t i = 0; i < mPaths; i++) {
+    if (!mRadio->setTxFreq(freq, chan * mPaths + i))
+      return false;
+  }
+
+  return true;
 }
 
 bool RadioInterface::tuneRx(double freq, size_t chan)
 {
-  return mRadio->setRxFreq(freq, chan);
+  for (size_t i = 0; i < mPaths; i++) {
+    if (!mRadio->setRxFreq(freq, chan * mPaths + i))
+      return false;
+  }
+
+  return true;
 }
 
 bool RadioInterface::start()
@@ -159,10 +184,10 @@ bool RadioInterface::start()
   if (!mRadio->start())
     return false;
 
-  for (size_t i = 0; i < mChans; i++) {
+  for (size_t i = 0; i < sendBuffer.size(); i++)
     sendBuffer[i]->reset();
+  for (size_t i = 0; i < recvBuffer.size(); i++)
     recvBuffer[i]->reset();
-  }
 
   writeTimestamp = mRadio->initialWriteTimestamp();
   readTimestamp = mRadio->initialReadTimestamp();
@@ -219,6 +244,25 @@ void RadioInterface::driveTransmitRadio(std::vector<signalVector *> &bursts,
   while (pushBuffer());
 }
 
+/*
+ * Whole frame variant for idle carriers. Frame boundaries fall on chunk
+ * boundaries (157-156-156-156 symbol pattern), so the eight timeslots map
+ * onto two contiguous chunks that are flushed with a single device write.
+ */
+void RadioInterface::driveTransmitFrame(std::vector<std::vector<signalVector *> > &bursts,
+                                        std::vector<std::vector<bool> > &zeros)
+{
+  if (!mOn)
+    return;
+
+  for (size_t tn = 0; tn < bursts.size(); tn++) {
+    for (size_t i = 0; i < mChans; i++)
+      radioifyVector(*bursts[tn][i], i, zeros[tn][i]);
+  }
+
+  while (pushBuffer());
+}
+
 bool RadioInterface::driveReceiveRadio()
 {
   radioVector *burst = NULL;
@@ -238,7 +282,7 @@ bool RadioInterface::driveReceiveRadio()
   if (mSPSRx == 4)
     burstSize = 625;
   else
-    burstSize = symbolsPerSlot + (tN % 4 == 0);
+    burstSize = (symbolsPerSlot + (tN % 4 == 0)) * mSPSRx;
 
   /* 
    * Pre-allocate head room for the largest correlation size
@@ -248,12 +292,14 @@ bool RadioInterface::driveReceiveRadio()
 
   /*
    * Form receive bursts and pass up to transceiver. Use repeating
-   * pattern of 157-156-156-156 symbols per timeslot
+   * pattern of 157-156-156-156 symbols per timeslot, or 625 samples
+   * per timeslot at 4 sps
    */
   while (recvSz > burstSize) {
     for (size_t i = 0; i < mChans; i++) {
-      burst = new radioVector(rcvClock, burstSize, head);
-      unRadioifyVector(burst->getVector(), i);
+      burst = new radioVector(rcvClock, burstSize, head, mPaths);
+      for (size_t n = 0; n < mPaths; n++)
+        unRadioifyVector(burst->getVector(n), i * mPaths + n);
 
       if (mReceiveFIFO[i].size() < 32)
         mReceiveFIFO[i].write(burst);
@@ -292,12 +338,15 @@ VectorFIFO* RadioInterface::receiveFIFO(size_t chan)
 
 double RadioInterface::setRxGain(double dB, size_t chan)
 {
-  return mRadio->setRxGain(dB, chan);
+  for (size_t i = 1; i < mPaths; i++)
+    mRadio->setRxGain(dB, chan * mPaths + i);
+
+  return mRadio->setRxGain(dB, chan * mPaths);
 }
 
 double RadioInterface::getRxGain(size_t chan)
 {
-  return mRadio->getRxGain(chan);
+  return mRadio->getRxGain(chan * mPaths);
 }
 
 /* Receive a timestamped chunk from the device */
@@ -321,7 +370,7 @@ void RadioInterface::pullBuffer()
           return;
   }
 
-  for (size_t i = 0; i < mChans; i++) {
+  for (size_t i = 0; i < recvBuffer.size(); i++) {
     convert_short_float(recvBuffer[i]->getWriteSegment(),
 			convertRecvBuffer[i],
 			segmentLen * 2);
@@ -334,21 +383,32 @@ void RadioInterface::pullBuffer()
 /* Send timestamped chunk to the device with arbitrary size */
 bool RadioInterface::pushBuffer()
 {
-  size_t numSent, segmentLen = sendBuffer[0]->getSegmentLen();
+  size_t numSent, numSegments, segmentLen = sendBuffer[0]->getSegmentLen();
 
-  if (sendBuffer[0]->getAvailSegments() < 1)
+  numSegments = sendBuffer[0]->getAvailSegments();
+  if (numSegments < 1)
     return false;
 
+  /*
+   * Drain all contiguous segments, which are kept in lockstep per channel.
+   * A single timeslot completes at most one segment, so only whole idle
+   * frames from driveTransmitFrame() make this write more than one.
+   */
   for (size_t i = 0; i < mChans; i++) {
-    convert_float_short(convertSendBuffer[i],
-                        (float *) sendBuffer[i]->getReadSegment(),
+    size_t num = numSegments;
+    const float *segment = sendBuffer[i]->getReadSegments(num);
+
+    convert_float_short(convertSendBuffer[i * mPaths],
+                        (float *) segment,
                         powerScaling[i],
-                        segmentLen * 2);
+                        num * segmentLen * 2);
+    if (!i)
+      numSegments = num;
   }
 
   /* Send the all samples in the send buffer */
   numSent = mRadio->writeSamples(convertSendBuffer,
-                                 segmentLen,
+                                 numSegments * segmentLen,
                                  &underrun,
                                  writeTimestamp);
   writeTimestamp += numSent;
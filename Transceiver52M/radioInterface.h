@@ -24,6 +24,7 @@
 #include "Resampler.h"
 #include "Channelizer.h"
 #include "Synthesis.h"
+#include "CarrierPlan.h"
 
 static const unsigned gSlotLen = 148;      ///< number of symbols per slot, not counting guard periods
 
@@ -41,6 +42,7 @@ protected:
   size_t mSPSTx;
   size_t mSPSRx;
   size_t mChans;
+  size_t mPaths;                              ///< receive diversity paths per channel
 
   std::vector<RadioBuffer *> sendBuffer;
   std::vector<RadioBuffer *> recvBuffer;
@@ -85,7 +87,7 @@ public:
 
   /** constructor */
   RadioInterface(RadioDevice* wRadio, size_t tx_sps, size_t rx_sps,
-                 size_t chans = 1, int receiveOffset = 3,
+                 size_t chans = 1, size_t paths = 1, int receiveOffset = 3,
                  GSM::Time wStartTime = GSM::Time(0));
 
   /** destructor */
@@ -116,6 +118,10 @@ public:
   void driveTransmitRadio(std::vector<signalVector *> &bursts,
                           std::vector<bool> &zeros);
 
+  /** drive transmission of a full frame of GSM bursts, indexed [TN][chan] */
+  void driveTransmitFrame(std::vector<std::vector<signalVector *> > &bursts,
+                          std::vector<std::vector<bool> > &zeros);
+
   /** drive reception of GSM bursts */
   bool driveReceiveRadio();
 
@@ -168,6 +174,7 @@ class RadioInterfaceMulti : public RadioInterface {
 private:
   bool pushBuffer();
   void pullBuffer();
+  bool selectEngine();
 
   signalVector *outerSendBuffer;
   signalVector *outerRecvBuffer;
@@ -178,10 +185,11 @@ private:
   Resampler *upsampler;
   Channelizer *channelizer;
   Synthesis *synthesis;
+  CarrierPlan plan;
 
 public:
   RadioInterfaceMulti(RadioDevice* radio, size_t tx_sps,
-                      size_t rx_sps, size_t chans = 1);
+                      size_t rx_sps, const CarrierPlan &plan);
   ~RadioInterfaceMulti();
 
   bool init(int type);
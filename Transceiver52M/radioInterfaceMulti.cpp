@@ -20,6 +20,11 @@
  * See the COPYING file in the main directory for details.
  */
 
+#include <time.h>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
 #include <radioInterface.h>
 #include <Logger.h>
 
@@ -29,20 +34,29 @@ extern "C" {
 #include "convert.h"
 }
 
-/* Resampling parameters for 64 MHz clocking */
-#define RESAMP_INRATE			65
-#define RESAMP_OUTRATE			(96 / 2)
-
 /* Universal resampling parameters */
 #define NUMCHUNKS				24
 
-#define MCHANS					4
+/*
+ * Shortest inner chunk at 4 sps. Chunks hold a whole number of resampler
+ * blocks, as many as it takes to reach this length.
+ */
+#define MIN_INCHUNK				(65 * 4)
+
+/*
+ * Calibration of the per-carrier engine, which must beat the filterbank by
+ * the margin so that timing noise does not pick it for a marginal gain
+ */
+#define ENGINE_BLOCKS				8
+#define ENGINE_RUNS				5
+#define ENGINE_MARGIN				0.9
 
 RadioInterfaceMulti::RadioInterfaceMulti(RadioDevice *radio, size_t tx_sps,
-					 size_t rx_sps, size_t chans)
-	: RadioInterface(radio, tx_sps, rx_sps, chans),
+					 size_t rx_sps, const CarrierPlan &plan)
+	: RadioInterface(radio, tx_sps, rx_sps, plan.chans()),
 	  outerSendBuffer(NULL), outerRecvBuffer(NULL),
-	  dnsampler(NULL), upsampler(NULL), channelizer(NULL), synthesis(NULL)
+	  dnsampler(NULL), upsampler(NULL), channelizer(NULL), synthesis(NULL),
+	  plan(plan)
 {
 }
 
@@ -75,63 +89,84 @@ void RadioInterfaceMulti::close()
 	RadioInterface::close();
 }
 
-static int getLogicalChan(size_t pchan, size_t chans)
+static double timeNow()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Time per block of receive and transmit conversion on the current engine */
+static double blockTime(Channelizer *channelizer, Synthesis *synthesis,
+			signalVector *rx, signalVector *tx)
 {
-	switch (chans) {
-	case 1:
-		if (pchan == 0)
-			return 0;
-		else
-			return -1;
-		break;
-	case 2:
-		if (pchan == 0)
-			return 0;
-		if (pchan == 3)
-			return 1;
-		else
-			return -1;
-		break;
-	case 3:
-		if (pchan == 1)
-			return 0;
-		if (pchan == 0)
-			return 1;
-		if (pchan == 3)
-			return 2;
-		else
-			return -1;
-		break;
-	default:
-		break;
-	};
-
-	return -1;
+	double t0 = timeNow();
+
+	for (int i = 0; i < ENGINE_BLOCKS; i++) {
+		channelizer->rotate((float *) rx->begin(), rx->size());
+		synthesis->rotate((float *) tx->begin(), tx->size());
+	}
+
+	return (timeNow() - t0) / ENGINE_BLOCKS;
 }
 
-static int getFreqShift(size_t chans)
+/*
+ * Choose between the filterbank and the per-carrier engine. The per-carrier
+ * engine replaces the M-point FFT with an M lane mix of each row per active
+ * path, so layouts with more than log2(M) carriers, where that exceeds the work of
+ * the FFT, stay on the filterbank. Remaining layouts are timed on both
+ * engines with the actual carriers and switch only for a clear gain.
+ */
+bool RadioInterfaceMulti::selectEngine()
 {
-	switch (chans) {
-	case 1:
-		return 0;
-	case 2:
-		return 0;
-	case 3:
-		return 1;
-	default:
-		break;
-	};
-
-	return -1;
+	std::vector<size_t> paths;
+	double fb = DBL_MAX, pc = DBL_MAX;
+	size_t m = plan.size();
+
+	for (size_t pchan = 0; pchan < m; pchan++) {
+		if (active[pchan])
+			paths.push_back(pchan);
+	}
+
+	if (paths.size() > log2(m))
+		return false;
+
+	outerRecvBuffer->fill(0.0f);
+
+	for (int n = 0; n < ENGINE_RUNS; n++) {
+		channelizer->setCarriers(std::vector<size_t>());
+		synthesis->setCarriers(std::vector<size_t>());
+		fb = std::min(fb, blockTime(channelizer, synthesis,
+					    outerRecvBuffer, outerSendBuffer));
+
+		channelizer->setCarriers(paths);
+		synthesis->setCarriers(paths);
+		pc = std::min(pc, blockTime(channelizer, synthesis,
+					    outerRecvBuffer, outerSendBuffer));
+	}
+
+	LOG(INFO) << "Multi-ARFCN block conversion " << fb * 1e6 << " us on "
+		  << "the filterbank, " << pc * 1e6 << " us on "
+		  << paths.size() << " carriers";
+
+	if (pc < ENGINE_MARGIN * fb)
+		return true;
+
+	channelizer->setCarriers(std::vector<size_t>());
+	synthesis->setCarriers(std::vector<size_t>());
+
+	return false;
 }
 
 /* Initialize I/O specific objects */
 bool RadioInterfaceMulti::init(int type)
 {
 	float cutoff = 1.0f;
-	size_t inchunk = 0, outchunk = 0;
+	size_t inchunk = 0, outchunk = 0, blocks = 0;
+	size_t m = plan.size(), p = plan.resampP(), q = plan.resampQ();
 
-	if (mChans > MCHANS - 1) {
+	if (!m || mChans != plan.chans()) {
 		LOG(ALERT) << "Invalid channel configuration " << mChans;
 		return false;
 	}
@@ -146,35 +181,39 @@ bool RadioInterfaceMulti::init(int type)
 	mReceiveFIFO.resize(mChans);
 	powerScaling.resize(mChans);
 	history.resize(mChans);
-	active.resize(MCHANS, false);
+	active.resize(m, false);
 
-	inchunk = RESAMP_INRATE * 4;
-	outchunk = RESAMP_OUTRATE * 4;
+	blocks = (MIN_INCHUNK + p - 1) / p;
+	inchunk = p * blocks;
+	outchunk = q * blocks;
 
 	if (inchunk  * NUMCHUNKS < 625 * 2) {
 		LOG(ALERT) << "Invalid inner chunk size " << inchunk;
 		return false;
 	}
 
-	dnsampler = new Resampler(RESAMP_INRATE, RESAMP_OUTRATE);
+	LOG(INFO) << "Multi-ARFCN channelizer " << plan.str()
+		  << ", resampling " << p << "/" << q;
+
+	dnsampler = new Resampler(p, q);
 	if (!dnsampler->init(1.0)) {
 		LOG(ALERT) << "Rx resampler failed to initialize";
 		return false;
 	}
 
-	upsampler = new Resampler(RESAMP_OUTRATE, RESAMP_INRATE);
+	upsampler = new Resampler(q, p);
 	if (!upsampler->init(cutoff)) {
 		LOG(ALERT) << "Tx resampler failed to initialize";
 		return false;
 	}
 
-	channelizer = new Channelizer(MCHANS, outchunk);
+	channelizer = new Channelizer(m, outchunk);
 	if (!channelizer->init()) {
 		LOG(ALERT) << "Rx channelizer failed to initialize";
 		return false;
 	}
 
-	synthesis = new Synthesis(MCHANS, outchunk);
+	synthesis = new Synthesis(m, outchunk);
 	if (!synthesis->init()) {
 		LOG(ALERT) << "Tx synthesis filter failed to initialize";
 		return false;
@@ -202,24 +241,11 @@ bool RadioInterfaceMulti::init(int type)
 	convertSendBuffer[0] = new short[2 * synthesis->outputLen()];
 	convertRecvBuffer[0] = new short[2 * channelizer->inputLen()];
 
-	/* Configure channels */
-	switch (mChans) {
-	case 1:
-		active[0] = true;
-		break;
-	case 2:
-		active[0] = true;
-		active[3] = true;
-		break;
-	case 3:
-		active[0] = true;
-		active[1] = true;
-		active[3] = true;
-		break;
-	default:
-		LOG(ALERT) << "Unsupported channel combination";
-		return false;
-	}
+	for (size_t pchan = 0; pchan < m; pchan++)
+		active[pchan] = plan.chan(pchan) >= 0;
+
+	if (selectEngine())
+		LOG(NOTICE) << "Multi-ARFCN conversion on the per-carrier engine";
 
 	return true;
 }
@@ -254,11 +280,11 @@ void RadioInterfaceMulti::pullBuffer()
 	channelizer->rotate((float *) outerRecvBuffer->begin(),
 			    outerRecvBuffer->size());
 
-	for (size_t pchan = 0; pchan < MCHANS; pchan++) {
+	for (size_t pchan = 0; pchan < plan.size(); pchan++) {
 		if (!active[pchan])
 			continue;
 
-		int lchan = getLogicalChan(pchan, mChans);
+		int lchan = plan.chan(pchan);
 		if (lchan < 0) {
 			LOG(ALERT) << "Invalid logical channel " << pchan;
 			continue;
@@ -296,13 +322,12 @@ bool RadioInterfaceMulti::pushBuffer()
 	if (sendBuffer[0]->getAvailSegments() <= 0)
 		return false;
 
-	for (size_t pchan = 0; pchan < MCHANS; pchan++) {
-		if (!active[pchan]) {
-			synthesis->resetBuffer(pchan);
+	for (size_t pchan = 0; pchan < plan.size(); pchan++) {
+		/* Inactive inputs were cleared at init and are never written */
+		if (!active[pchan])
 			continue;
-		}
 
-		int lchan = getLogicalChan(pchan, mChans);
+		int lchan = plan.chan(pchan);
 		if (lchan < 0) {
 			LOG(ALERT) << "Invalid logical channel " << pchan;
 			continue;
@@ -349,13 +374,11 @@ bool RadioInterfaceMulti::tuneTx(double freq, size_t chan)
   if (chan >= mChans)
     return false;
 
-  double shift = (double) getFreqShift(mChans);
-
   if (!chan)
-    return mRadio->setTxFreq(freq + shift * MCBTS_SPACING);
+    return mRadio->setTxFreq(freq - plan.offset(0));
 
   double center = mRadio->getTxFreq();
-  if (!fltcmp(freq, center + (double) (chan - shift) * MCBTS_SPACING)) {
+  if (!fltcmp(freq, center + plan.offset(chan))) {
     LOG(NOTICE) << "Channel " << chan << " RF frequency offset is "
                 << freq / 1e6 << " MHz";
   }
@@ -368,13 +391,11 @@ bool RadioInterfaceMulti::tuneRx(double freq, size_t chan)
   if (chan >= mChans)
     return false;
 
-  double shift = (double) getFreqShift(mChans);
-
   if (!chan)
-    return mRadio->setRxFreq(freq + shift * MCBTS_SPACING);
+    return mRadio->setRxFreq(freq - plan.offset(0));
 
   double center = mRadio->getRxFreq();
-  if (!fltcmp(freq, center + (double) (chan - shift) * MCBTS_SPACING)) {
+  if (!fltcmp(freq, center + plan.offset(chan))) {
     LOG(NOTICE) << "Channel " << chan << " RF frequency offset is "
                 << freq / 1e6 << " MHz";
   }
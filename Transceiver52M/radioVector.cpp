@@ -74,34 +74,6 @@ bool radioVector::setVector(signalVector *vector, size_t chan)
 	return true;
 }
 
-noiseVector::noiseVector(size_t size)
-	: std::vector<float>(size), itr(0)
-{
-}
-
-float noiseVector::avg() const
-{
-	float val = 0.0;
-
-	for (size_t i = 0; i < size(); i++)
-		val += (*this)[i];
-
-	return val / (float) size();
-}
-
-bool noiseVector::insert(float val)
-{
-	if (!size())
-		return false;
-
-	if (itr >= this->size())
-		itr = 0;
-
-	(*this)[itr++] = val;
-
-	return true;
-}
-
 GSM::Time VectorQueue::nextTime() const
 {
 	GSM::Time retVal;
@@ -116,6 +88,24 @@ GSM::Time VectorQueue::nextTime() const
 	return retVal;
 }
 
+/*
+ * Non-blocking check for the absence of queued bursts in the frame starting
+ * at the target time. Stale bursts are not idle so that they are dumped
+ * through the regular per-timeslot path.
+ */
+bool VectorQueue::idleFrame(const GSM::Time& targTime) const
+{
+	bool idle = true;
+	mLock.lock();
+
+	if (mQ.size() && (mQ.top()->getTime() < targTime + 1))
+		idle = false;
+
+	mLock.unlock();
+
+	return idle;
+}
+
 radioVector* VectorQueue::getStaleBurst(const GSM::Time& targTime)
 {
 	mLock.lock();
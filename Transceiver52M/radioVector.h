@@ -46,21 +46,12 @@ private:
 	GSM::Time mTime;
 };
 
-class noiseVector : std::vector<float> {
-public:
-	noiseVector(size_t size = 0);
-	bool insert(float val);
-	float avg() const;
-
-private:
-	size_t itr;
-};
-
 class VectorFIFO : public InterthreadQueue<radioVector> { };
 
 class VectorQueue : public InterthreadPriorityQueue<radioVector> {
 public:
 	GSM::Time nextTime() const;
+	bool idleFrame(const GSM::Time& targTime) const;
 	radioVector* getStaleBurst(const GSM::Time& targTime);
 	radioVector* getCurrentBurst(const GSM::Time& targTime);
 };
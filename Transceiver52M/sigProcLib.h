@@ -15,6 +15,9 @@
 #ifndef SIGPROCLIB_H
 #define SIGPROCLIB_H
 
+#include <vector>
+#include <string>
+
 #include "Vector.h"
 #include "Complex.h"
 #include "BitVector.h"
@@ -51,8 +54,19 @@ enum SignalError {
  */
 #define BURST_THRESH    4.0
 
-/** Setup the signal processing library */
-bool sigProcLibSetup();
+/**
+        Setup the signal processing library.
+        @param rx_sps Receive samples per symbol to detect bursts at, 0 for all.
+        @param edge Also set up 8-PSK burst detection.
+*/
+bool sigProcLibSetup(int rx_sps = 0, bool edge = true);
+
+/**
+        Set the precomputed table file used by sigProcLibSetup(). Tables are
+        loaded from the file if it is valid and regenerated into it
+        otherwise. An empty path, the default, disables the file.
+*/
+void setTableFile(const std::string &path);
 
 /** Destroy the signal processing library */
 void sigProcLibDestroy(void);
@@ -60,6 +74,14 @@ void sigProcLibDestroy(void);
 /** Operate soft slicer on a soft-bit vector */
 bool vectorSlicer(SoftVector *x);
 
+/**
+        Slice -1..+1 soft bits and quantize them to 0..255 TRXD soft bits
+        in one pass, matching vectorSlicer() followed by rounding.
+        @param x The soft-bit vector.
+        @param out Byte buffer of at least x.size() entries.
+*/
+void vectorQuantize(const SoftVector &x, char *out);
+
 /** GMSK modulate a GSM burst of bits */
 signalVector *modulateBurst(const BitVector &wBurst,
                             int guardPeriodLength,
@@ -72,16 +94,16 @@ signalVector *modulateEdgeBurst(const BitVector &bits,
 /** Generate a EDGE burst with random payload - 4 SPS (625 samples) only */
 signalVector *generateEdgeBurst(int tsc);
 
-/** Generate an empty burst - 4 or 1 SPS */
+/** Generate an empty burst - 4, 2 or 1 SPS */
 signalVector *generateEmptyBurst(int sps, int tn);
 
-/** Generate a normal GSM burst with random payload - 4 or 1 SPS */
+/** Generate a normal GSM burst with random payload - 4, 2 or 1 SPS */
 signalVector *genRandNormalBurst(int tsc, int sps, int tn);
 
-/** Generate an access GSM burst with random payload - 4 or 1 SPS */
+/** Generate an access GSM burst with random payload - 4, 2 or 1 SPS */
 signalVector *genRandAccessBurst(int delay, int sps, int tn);
 
-/** Generate a dummy GSM burst - 4 or 1 SPS */
+/** Generate a dummy GSM burst - 4, 2 or 1 SPS */
 signalVector *generateDummyBurst(int sps, int tn);
 
 /**
@@ -92,6 +114,16 @@ signalVector *generateDummyBurst(int sps, int tn);
 void scaleVector(signalVector &x,
                  complex scale);
 
+/**
+        Delay a vector by a whole or fractional number of samples.
+        @param in The vector of interest.
+        @param out Output vector or NULL to allocate a new vector.
+        @param delay Delay in samples, negative values advance the vector.
+        @return The delayed vector or NULL on error.
+*/
+signalVector *delayVector(const signalVector *in, signalVector *out,
+                          float delay);
+
 /**
         Rough energy estimator.
         @param rxBurst A GSM burst.
@@ -122,8 +154,186 @@ int detectAnyBurst(const signalVector &burst,
                    float &toa,
                    unsigned max_toa);
 
+/**
+        Burst detector searching a narrow window of arrival times, such as
+        the range predicted from earlier bursts of the same timeslot. A
+        burst outside the window is not detected, nor is one whose
+        correlation peak falls outside the window, so callers fall back to
+        detectAnyBurst() on a miss.
+        @param max_toa The maximum expected time-of-arrival (in symbols).
+        @param lo Earliest expected time-of-arrival (in symbols).
+        @param hi Latest expected time-of-arrival (in symbols).
+        @return as for detectAnyBurst()
+*/
+int detectBurstWindow(const signalVector &burst, unsigned tsc,
+                      float threshold, int sps, CorrType type,
+                      complex &amp, float &toa, unsigned max_toa,
+                      float lo, float hi);
+
+/** Correlator selection for burst detection */
+enum CorrMode {
+  CORR_AUTO,   ///< FFT from the crossover window length measured at setup
+  CORR_DIRECT, ///< direct correlation for all window lengths
+  CORR_FFT,    ///< FFT correlation for all window lengths
+};
+
+/** Select the burst detection correlator, set before detection starts */
+void setCorrelationMode(CorrMode mode);
+
+/** Result of detecting one burst, see detectAnyBurst() */
+struct BurstDetection {
+  int rc;
+  complex amp;
+  float toa;
+
+  BurstDetection() : rc(SIGERR_NONE), amp(0.0f), toa(0.0f) { }
+};
+
 /** Demodulate burst basde on type and output soft bits */
 SoftVector *demodAnyBurst(const signalVector &burst, int sps,
                           complex amp, float toa, CorrType type);
 
+/**
+        Demodulate burst based on type into a caller provided vector.
+        The vector is resized if needed, so a vector kept across bursts
+        is reused without allocation for GMSK at 1 and 4 SPS.
+        @return true on success, false on error.
+*/
+bool demodAnyBurst(const signalVector &burst, int sps, complex amp,
+                   float toa, CorrType type, SoftVector &bits);
+
+/**
+        Demodulate a burst received on multiple diversity paths with
+        maximal ratio combining. GMSK bursts at 1 and 4 SPS are combined,
+        otherwise the path with the strongest channel is demodulated.
+        @param bursts The received bursts, one per diversity path.
+        @param sps The number of samples per GSM symbol.
+        @param amps The channel estimates of each path from detectAnyBurst().
+        @param toas The timing offsets of each path from detectAnyBurst().
+        @param type The burst type.
+        @return The combined soft bits or NULL on error.
+*/
+SoftVector *demodDiversityBurst(const std::vector<const signalVector *> &bursts,
+                                int sps, const std::vector<complex> &amps,
+                                const std::vector<float> &toas, CorrType type);
+
+/** Diversity demodulation into a caller provided vector, see demodAnyBurst() */
+bool demodDiversityBurst(const std::vector<const signalVector *> &bursts,
+                         int sps, const std::vector<complex> &amps,
+                         const std::vector<float> &toas, CorrType type,
+                         SoftVector &bits);
+
+/**
+        Detect the two users of a VAMOS timeslot, which share the timeslot
+        with different training sequences. Each training sequence is
+        correlated on its own as in detectAnyBurst() for a normal burst.
+        @param burst The received burst.
+        @param tsc Training sequences of the two users.
+        @param threshold The post-correlator SNR detection threshold.
+        @param sps The number of samples per GSM symbol.
+        @param max_toa The maximum expected time-of-arrival (in symbols).
+        @param results One detection result per user.
+*/
+void detectVamosBurst(const signalVector &burst, const unsigned tsc[2],
+                      float threshold, int sps, unsigned max_toa,
+                      BurstDetection results[2]);
+
+/**
+        Jointly demodulate the two users of a VAMOS timeslot. Channels of
+        both users are estimated together from both training sequences and
+        each user is separated from the other with a widely linear MMSE
+        filter. GMSK at 1 and 4 SPS only.
+        @param burst The received burst.
+        @param sps The number of samples per GSM symbol.
+        @param tsc Training sequences of the two users, which must differ.
+        @param toa Timing offset to demodulate at, in symbols.
+        @param bits0 Soft bits of the first user.
+        @param bits1 Soft bits of the second user.
+        @return true on success, false on error.
+*/
+bool demodVamosBurst(const signalVector &burst, int sps,
+                     const unsigned tsc[2], float toa,
+                     SoftVector &bits0, SoftVector &bits1);
+
+/** Equalizers for GMSK bursts with multipath, in order of cost */
+enum EqualizerType {
+  EQ_NONE,
+  EQ_DFE,
+  EQ_MLSE,
+};
+
+/** Number of taps of equalizer channel estimates */
+#define EQ_TAPS			8
+
+/**
+        Estimate the channel of a GMSK normal burst from the midamble for the
+        equalizers. 1 and 4 SPS only.
+        @param burst The received burst.
+        @param sps The number of samples per GSM symbol.
+        @param tsc The training sequence of the burst.
+        @param toa Timing offset of the burst, in symbols.
+        @param chan The channel estimate of EQ_TAPS taps.
+        @param noise The noise power per symbol.
+        @return true on success, false on error.
+*/
+bool estimateChannel(const signalVector &burst, int sps, unsigned tsc,
+                     float toa, signalVector &chan, float &noise);
+
+/** RMS delay spread of a channel estimate in symbols */
+float channelSpread(const signalVector &chan);
+
+/**
+        Design the filters of the decision feedback equalizer.
+        @param chan The channel estimate.
+        @param noise The noise power per symbol.
+        @param forward The forward filter.
+        @param feedback The feedback filter.
+        @return true on success, false on error.
+*/
+bool designDFE(const signalVector &chan, float noise,
+               signalVector &forward, signalVector &feedback);
+
+/**
+        Equalize and demodulate a GMSK normal burst. The channel estimate
+        and equalizer filters are those of the timeslot from earlier bursts
+        and are updated from this burst, with the filters only redesigned
+        when the channel has changed. Empty vectors start a new timeslot.
+        1 and 4 SPS only.
+        @param burst The received burst.
+        @param sps The number of samples per GSM symbol.
+        @param tsc The training sequence of the burst.
+        @param toa Timing offset of the burst, in symbols.
+        @param type The equalizer to use.
+        @param chan The channel estimate of the timeslot.
+        @param noise The noise power of the timeslot.
+        @param forward The DFE forward filter of the timeslot.
+        @param feedback The DFE feedback filter of the timeslot.
+        @param bits The demodulated soft bits.
+        @return true on success, false on error.
+*/
+bool equalizeBurst(const signalVector &burst, int sps, unsigned tsc,
+                   float toa, EqualizerType type, signalVector &chan,
+                   float &noise, signalVector &forward,
+                   signalVector &feedback, SoftVector &bits);
+
+/**
+        Demodulate a GMSK normal burst with carrier frequency offset
+        correction. The offset of the timeslot is tracked over bursts. Each
+        burst is estimated from its midamble and data halves after removal
+        of the tracked offset, which may be off by up to about 1.6 kHz, and
+        corrected by the tracked offset updated from that estimate.
+        1 and 4 SPS only.
+        @param burst The received burst.
+        @param sps The number of samples per GSM symbol.
+        @param tsc The training sequence of the burst.
+        @param amp The channel estimate from detectAnyBurst().
+        @param toa The timing offset from detectAnyBurst().
+        @param freq Tracked offset of the timeslot in Hz, updated.
+        @param bits The demodulated soft bits.
+        @return true on success, false on error.
+*/
+bool demodOffsetBurst(const signalVector &burst, int sps, unsigned tsc,
+                      complex amp, float toa, float &freq,
+                      SoftVector &bits);
+
 #endif /* SIGPROCLIB_H */
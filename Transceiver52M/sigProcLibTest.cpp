@@ -0,0 +1,2101 @@
+/*
+ * Signal processing library tests and benchmarks
+ *
+ * Copyright (C) 2017 Free Software Foundation, Inc.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * See the COPYING file in the main directory for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <random>
+#include <fstream>
+#include <sstream>
+
+#include "sigProcLib.h"
+#include "GSMCommon.h"
+#include "Configuration.h"
+
+extern "C" {
+#include "convolve.h"
+#include "fft.h"
+}
+
+ConfigurationTable gConfig;
+
+#define TEST_TSC		2
+#define TEST_TN			0
+#define TEST_MAX_TOA		8
+#define TEST_WIDE_TOA		40
+#define TEST_HEAD		41
+#define DOWNSAMPLE_LEN		156
+
+static std::mt19937 rng(1234);
+
+/*
+ * Software channel simulation
+ *
+ * Bursts are modulated at 4 SPS, which serves as the continuous time
+ * reference. The channel applies a timing offset in symbols, optional
+ * Rayleigh block fading (one complex gain per burst) and white Gaussian
+ * noise at the given symbol energy to noise density ratio. The result is
+ * then band limited and decimated to the receive rate with a zero phase
+ * filter, standing in for the device decimation filters. An optional
+ * multipath profile replaces the single path with delayed copies of the
+ * burst, each with its own gain, at unit total power.
+ */
+#define MAX_PATHS		6
+
+struct Multipath {
+	const char *name;
+	int paths;
+	float delay[MAX_PATHS];		/* in symbols */
+	float power[MAX_PATHS];		/* in dB */
+};
+
+struct ChannelSim {
+	float esn0;
+	float delay;
+	bool fading;
+	const Multipath *multipath;
+	float freq;			/* carrier offset in Hz */
+};
+
+/*
+ * Static two path channel with random phases, and the GSM 05.05 typical
+ * urban and hilly terrain profiles with delays converted to symbols
+ */
+#define US			(13.0f / 48.0f)
+
+static const Multipath twoRay = {
+	"two path", 2, { 0.0f, 1.5f }, { 0.0f, -3.0f },
+};
+
+static const Multipath typicalUrban = {
+	"TU", 6,
+	{ 0.0f, 0.2f * US, 0.6f * US, 1.6f * US, 2.4f * US, 5.0f * US },
+	{ -3.0f, 0.0f, -2.0f, -6.0f, -8.0f, -10.0f },
+};
+
+static const Multipath hillyTerrain = {
+	"HT", 6,
+	{ 0.0f, 0.2f * US, 0.4f * US, 0.6f * US, 15.0f * US, 17.2f * US },
+	{ 0.0f, -2.0f, -4.0f, -7.0f, -6.0f, -12.0f },
+};
+
+#define SIM_SPS			4
+#define SIM_RATE		(SIM_SPS * 1625e3 / 6)
+#define SIM_FILT_LEN		16
+
+static signalVector *decimate(const signalVector &x, int factor)
+{
+	int len = x.size() / factor;
+	int half = SIM_FILT_LEN * factor;
+	signalVector *y = new signalVector(len, TEST_HEAD);
+	std::vector<float> h(2 * half + 1);
+	float sum = 0.0f;
+
+	for (int n = -half; n <= half; n++) {
+		float arg = M_PI * n / factor;
+		float win = 0.54 + 0.46 * cos(M_PI * n / half);
+
+		h[n + half] = (n ? sinf(arg) / arg : 1.0f) * win;
+		sum += h[n + half];
+	}
+
+	for (int i = 0; i < len; i++) {
+		complex acc = 0.0f;
+
+		for (int n = -half; n <= half; n++) {
+			int k = i * factor + n;
+			if ((k >= 0) && (k < (int) x.size()))
+				acc += x[k] * (h[n + half] / sum);
+		}
+
+		(*y)[i] = acc;
+	}
+
+	return y;
+}
+
+static signalVector *applyMultipath(const signalVector &burst,
+				    const ChannelSim &sim)
+{
+	std::normal_distribution<float> gauss(0.0f, 1.0f);
+	std::uniform_real_distribution<float> uphase(0.0f, 2.0f * M_PI);
+	const Multipath *mp = sim.multipath;
+	signalVector *sum = NULL;
+	float total = 0.0f;
+
+	for (int n = 0; n < mp->paths; n++)
+		total += powf(10.0f, mp->power[n] / 10.0f);
+
+	for (int n = 0; n < mp->paths; n++) {
+		float amp = sqrtf(powf(10.0f, mp->power[n] / 10.0f) / total);
+		float phase = uphase(rng);
+		complex gain(amp * cosf(phase), amp * sinf(phase));
+
+		if (sim.fading)
+			gain = complex(gauss(rng), gauss(rng)) *
+			       (float) (amp * M_SQRT1_2);
+
+		signalVector *path = delayVector(&burst, NULL,
+				(sim.delay + mp->delay[n]) * SIM_SPS);
+		if (!path) {
+			delete sum;
+			return NULL;
+		}
+
+		if (!sum) {
+			sum = new signalVector(path->size());
+			sum->fill(0.0f);
+		}
+
+		for (size_t i = 0; i < path->size() && i < sum->size(); i++)
+			(*sum)[i] += (*path)[i] * gain;
+		delete path;
+	}
+
+	return sum;
+}
+
+static signalVector *applyChannel(const signalVector &burst, int sps,
+				  const ChannelSim &sim)
+{
+	std::normal_distribution<float> gauss(0.0f, 1.0f);
+	complex gain = 1.0f;
+	signalVector *delay;
+
+	if (sim.multipath)
+		delay = applyMultipath(burst, sim);
+	else
+		delay = delayVector(&burst, NULL, sim.delay * SIM_SPS);
+	if (!delay)
+		return NULL;
+
+	if (sim.fading && !sim.multipath)
+		gain = complex(gauss(rng), gauss(rng)) * (float) M_SQRT1_2;
+
+	float sigma = sqrtf(SIM_SPS / powf(10.0f, sim.esn0 / 10.0f) / 2.0f);
+	float w = 2.0f * M_PI * sim.freq / SIM_RATE;
+
+	for (size_t i = 0; i < delay->size(); i++) {
+		complex noise(gauss(rng) * sigma, gauss(rng) * sigma);
+		complex offset(cosf(w * i), sinf(w * i));
+		(*delay)[i] = (*delay)[i] * gain * offset + noise;
+	}
+
+	signalVector *out = decimate(*delay, SIM_SPS / sps);
+
+	delete delay;
+	return out;
+}
+
+/* Normal burst with random payload, returning the transmitted bits */
+static signalVector *genNormalBurst(BitVector &bits, unsigned tsc = TEST_TSC)
+{
+	int i = 0;
+
+	for (; i < 3; i++)
+		bits[i] = 0;
+	for (; i < 61; i++)
+		bits[i] = rng() % 2;
+	for (int n = 0; i < 87; i++, n++)
+		bits[i] = GSM::gTrainingSequence[tsc][n];
+	for (; i < 145; i++)
+		bits[i] = rng() % 2;
+	for (; i < 148; i++)
+		bits[i] = 0;
+
+	return modulateBurst(bits, 8 + !(TEST_TN % 4), SIM_SPS);
+}
+
+/* Access burst with random payload, returning the transmitted bits */
+static signalVector *genAccessBurst(BitVector &bits)
+{
+	int i = 0;
+
+	for (int n = 0; i < 49; i++, n++)
+		bits[i] = GSM::gRACHBurst[n];
+	for (; i < 85; i++)
+		bits[i] = rng() % 2;
+	for (; i < 88; i++)
+		bits[i] = 0;
+
+	return modulateBurst(bits, 68 + !(TEST_TN % 4), SIM_SPS);
+}
+
+#define PAYLOAD_BITS	116
+#define RACH_BITS	36
+
+/* Count payload bit errors, tail and training bits excluded */
+static int countErrors(const BitVector &bits, const SoftVector &soft,
+		       CorrType type)
+{
+	int errs = 0;
+
+	for (size_t i = 3; i < 145; i++) {
+		if ((type == RACH) && ((i < 49) || (i >= 85)))
+			continue;
+		if ((type == TSC) && (i >= 61) && (i < 87))
+			continue;
+		if ((soft[i] > 0.0f) != (bool) bits[i])
+			errs++;
+	}
+
+	return errs;
+}
+
+struct BurstResult {
+	bool detected;
+	float toa;
+	int errors;
+};
+
+static BurstResult runBurst(int sps, const ChannelSim &sim,
+			    CorrType type = TSC)
+{
+	BurstResult res = { false, 0.0f, 0 };
+	BitVector bits(type == RACH ? 88 : 148);
+	complex amp;
+	float toa;
+
+	signalVector *tx = (type == RACH) ? genAccessBurst(bits) :
+					    genNormalBurst(bits);
+	signalVector *rx = applyChannel(*tx, sps, sim);
+
+	res.errors = (type == RACH) ? RACH_BITS : PAYLOAD_BITS;
+
+	int rc = detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, type,
+				amp, toa, TEST_MAX_TOA);
+	if (rc > 0) {
+		SoftVector *soft = demodAnyBurst(*rx, sps, amp, toa, type);
+
+		res.detected = true;
+		res.toa = toa;
+		res.errors = countErrors(bits, *soft, type);
+		delete soft;
+	}
+
+	delete tx;
+	delete rx;
+
+	return res;
+}
+
+/*
+ * Diversity reception of one burst over independent paths with a common
+ * timing offset. Selection combining follows the transceiver, which
+ * demodulates the path with the highest energy. Maximal ratio combining
+ * detects on every path and combines the paths with a detected burst.
+ */
+#define DIV_PATHS		2
+
+static BurstResult runDiversityBurst(int sps, const ChannelSim &sim, bool mrc)
+{
+	BurstResult res = { false, 0.0f, PAYLOAD_BITS };
+	std::vector<signalVector *> rx(DIV_PATHS);
+	std::vector<const signalVector *> bursts;
+	std::vector<complex> amps;
+	std::vector<float> toas;
+	BitVector bits(148);
+	SoftVector *soft = NULL;
+	complex amp;
+	float toa, max = -1.0f;
+	size_t max_i = 0;
+
+	signalVector *tx = genNormalBurst(bits);
+	for (size_t i = 0; i < DIV_PATHS; i++) {
+		rx[i] = applyChannel(*tx, sps, sim);
+
+		float pow = energyDetect(*rx[i], 20 * sps);
+		if (pow > max) {
+			max = pow;
+			max_i = i;
+		}
+	}
+
+	if (mrc) {
+		for (size_t i = 0; i < DIV_PATHS; i++) {
+			if (detectAnyBurst(*rx[i], TEST_TSC, BURST_THRESH, sps, TSC,
+					   amp, toa, TEST_MAX_TOA) <= 0)
+				continue;
+
+			bursts.push_back(rx[i]);
+			amps.push_back(amp);
+			toas.push_back(toa);
+		}
+
+		if (!bursts.empty())
+			soft = demodDiversityBurst(bursts, sps, amps, toas, TSC);
+	} else if (detectAnyBurst(*rx[max_i], TEST_TSC, BURST_THRESH, sps, TSC,
+				  amp, toa, TEST_MAX_TOA) > 0) {
+		soft = demodAnyBurst(*rx[max_i], sps, amp, toa, TSC);
+	}
+
+	if (soft) {
+		res.detected = true;
+		res.errors = countErrors(bits, *soft, TSC);
+		delete soft;
+	}
+
+	for (size_t i = 0; i < DIV_PATHS; i++)
+		delete rx[i];
+	delete tx;
+
+	return res;
+}
+
+/*
+ * A single path passed to the combiner must demodulate identically to
+ * the single path demodulator, and combining a path with a copy of itself
+ * must not change the soft output scaling.
+ */
+static bool testCombiner(int sps)
+{
+	ChannelSim sim = { 15.0f, 2.3f, true };
+	BitVector bits(148);
+	complex amp;
+	float toa, err = 0.0f;
+	bool pass = false;
+
+	signalVector *tx = genNormalBurst(bits);
+	signalVector *rx = applyChannel(*tx, sps, sim);
+
+	if (detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, TSC,
+			   amp, toa, TEST_MAX_TOA) > 0) {
+		std::vector<const signalVector *> one(1, rx), two(2, rx);
+		std::vector<complex> amps(2, amp);
+		std::vector<float> toas(2, toa);
+
+		SoftVector *ref = demodAnyBurst(*rx, sps, amp, toa, TSC);
+		SoftVector *a = demodDiversityBurst(one, sps,
+						    std::vector<complex>(1, amp),
+						    std::vector<float>(1, toa), TSC);
+		SoftVector *b = demodDiversityBurst(two, sps, amps, toas, TSC);
+
+		pass = ref && a && b && (a->size() == ref->size()) &&
+		       (b->size() == ref->size());
+		for (size_t n = 0; pass && (n < ref->size()); n++) {
+			err = std::max(err, fabsf((*a)[n] - (*ref)[n]));
+			err = std::max(err, fabsf((*b)[n] - (*ref)[n]));
+		}
+		pass = pass && (err < 1e-5f);
+
+		delete ref;
+		delete a;
+		delete b;
+	}
+
+	delete tx;
+	delete rx;
+
+	printf("%s: diversity combiner at %i sps (max error %.2e)\n",
+	       pass ? "PASS" : "FAIL", sps, err);
+	return pass;
+}
+
+/*
+ * VAMOS reception of two users sharing a timeslot with different training
+ * sequences. The second user arrives at the given power relative to the
+ * first, both with independent random carrier phases and a common timing
+ * offset. Joint demodulation is compared against detecting and
+ * demodulating each user alone, as a receiver without VAMOS support would.
+ */
+#define VAMOS_TSC		5
+
+struct VamosResult {
+	BurstResult joint[2];
+	BurstResult single[2];
+};
+
+static VamosResult runVamosBurst(int sps, const ChannelSim &sim, float ratio)
+{
+	const unsigned tsc[2] = { TEST_TSC, VAMOS_TSC };
+	std::uniform_real_distribution<float> uphase(0.0f, 2.0f * M_PI);
+	BurstResult miss = { false, 0.0f, PAYLOAD_BITS };
+	VamosResult res = { { miss, miss }, { miss, miss } };
+	BitVector bits[2] = { BitVector(148), BitVector(148) };
+	BurstDetection det[2];
+	SoftVector soft[2];
+	complex amp;
+	float toa;
+	float p0 = uphase(rng), p1 = uphase(rng);
+	float a1 = powf(10.0f, ratio / 20.0f);
+
+	signalVector *tx0 = genNormalBurst(bits[0], tsc[0]);
+	signalVector *tx1 = genNormalBurst(bits[1], tsc[1]);
+
+	scaleVector(*tx0, complex(cosf(p0), sinf(p0)));
+	scaleVector(*tx1, complex(cosf(p1), sinf(p1)) * a1);
+	for (size_t i = 0; i < tx0->size(); i++)
+		(*tx0)[i] += (*tx1)[i];
+
+	signalVector *rx = applyChannel(*tx0, sps, sim);
+
+	/* Detected users share the timing of the stronger one */
+	detectVamosBurst(*rx, tsc, BURST_THRESH, sps, TEST_MAX_TOA, det);
+	toa = (det[0].rc > 0) ? det[0].toa : det[1].toa;
+
+	if (((det[0].rc > 0) || (det[1].rc > 0)) &&
+	    demodVamosBurst(*rx, sps, tsc, toa, soft[0], soft[1])) {
+		for (int u = 0; u < 2; u++) {
+			if (det[u].rc <= 0)
+				continue;
+
+			res.joint[u].detected = true;
+			res.joint[u].toa = toa;
+			res.joint[u].errors = countErrors(bits[u], soft[u], TSC);
+		}
+	}
+
+	for (int u = 0; u < 2; u++) {
+		if (detectAnyBurst(*rx, tsc[u], BURST_THRESH, sps, TSC,
+				   amp, toa, TEST_MAX_TOA) <= 0)
+			continue;
+
+		SoftVector *single = demodAnyBurst(*rx, sps, amp, toa, TSC);
+		res.single[u].detected = true;
+		res.single[u].toa = toa;
+		res.single[u].errors = countErrors(bits[u], *single, TSC);
+		delete single;
+	}
+
+	delete tx0;
+	delete tx1;
+	delete rx;
+
+	return res;
+}
+
+/*
+ * With the second user 3 dB below the first, joint demodulation must
+ * detect both users and separate them to a low bit error rate. Counting
+ * missed bursts as lost bits, the weaker user must come through an order
+ * of magnitude better than with single user reception of the same bursts.
+ */
+#define VAMOS_TRIALS		200
+#define VAMOS_RATIO		-3.0f
+
+static bool testVamos(int sps)
+{
+	std::uniform_real_distribution<float> udelay(0.0f, TEST_MAX_TOA / 2);
+	long errs[2] = { 0, 0 }, found[2] = { 0, 0 }, lost[2] = { 0, 0 };
+	bool pass = true;
+
+	for (int i = 0; i < VAMOS_TRIALS; i++) {
+		ChannelSim sim = { 25.0f, udelay(rng), false };
+		VamosResult res = runVamosBurst(sps, sim, VAMOS_RATIO);
+
+		for (int u = 0; u < 2; u++) {
+			if (res.joint[u].detected) {
+				errs[u] += res.joint[u].errors;
+				found[u]++;
+			}
+			lost[u] += res.single[u].errors;
+		}
+	}
+
+	for (int u = 0; u < 2; u++) {
+		float ber = (float) errs[u] / (found[u] * PAYLOAD_BITS + 1);
+		float loss = (float) (errs[u] + (VAMOS_TRIALS - found[u]) *
+			     PAYLOAD_BITS) / (VAMOS_TRIALS * PAYLOAD_BITS);
+		float ref = (float) lost[u] / (VAMOS_TRIALS * PAYLOAD_BITS);
+
+		pass &= (found[u] >= VAMOS_TRIALS * 95 / 100) && (ber < 0.01f);
+		if (u)
+			pass &= ref > 10.0f * loss;
+
+		printf("%s: VAMOS user %i at %i sps (%li of %i detected, BER "
+		       "%.2e, bits lost %.2e, single user %.2e)\n",
+		       pass ? "PASS" : "FAIL", u, sps, found[u], VAMOS_TRIALS,
+		       ber, loss, ref);
+	}
+
+	return pass;
+}
+
+/*
+ * Equalized reception over a multipath channel. Every burst is detected
+ * once and demodulated with the single tap demodulator and with each
+ * equalizer, which keep their own timeslot cache across bursts. Errors
+ * are only counted on detected bursts, as the detector is shared.
+ */
+#define EQ_MAX_DELAY		2.0f
+
+struct EqCache {
+	signalVector chan, forward, feedback;
+	float noise;
+
+	EqCache() : noise(0.0f) { }
+};
+
+struct EqResult {
+	bool detected;
+	int errors[3];
+};
+
+static EqResult runEqBurst(int sps, const ChannelSim &sim, EqCache cache[3])
+{
+	EqResult res = { false, { 0, 0, 0 } };
+	BitVector bits(148);
+	SoftVector soft;
+	complex amp;
+	float toa;
+
+	signalVector *tx = genNormalBurst(bits);
+	signalVector *rx = applyChannel(*tx, sps, sim);
+
+	if (detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, TSC,
+			   amp, toa, TEST_MAX_TOA) > 0) {
+		res.detected = true;
+
+		res.errors[EQ_NONE] = PAYLOAD_BITS;
+		if (demodAnyBurst(*rx, sps, amp, toa, TSC, soft))
+			res.errors[EQ_NONE] = countErrors(bits, soft, TSC);
+
+		for (int type = EQ_DFE; type <= EQ_MLSE; type++) {
+			EqCache &c = cache[type];
+
+			res.errors[type] = PAYLOAD_BITS;
+			if (equalizeBurst(*rx, sps, TEST_TSC, toa,
+					  (EqualizerType) type, c.chan, c.noise,
+					  c.forward, c.feedback, soft))
+				res.errors[type] = countErrors(bits, soft, TSC);
+		}
+	}
+
+	delete tx;
+	delete rx;
+
+	return res;
+}
+
+#define EQ_TRIALS		200
+
+/*
+ * On the static two path channel both equalizers must clearly beat the
+ * single tap demodulator, and on a single path they must not lose to it
+ */
+static bool testEqualizer(int sps)
+{
+	const Multipath *profiles[] = { &twoRay, NULL };
+	std::uniform_real_distribution<float> udelay(0.0f, EQ_MAX_DELAY);
+	bool pass = true;
+
+	for (size_t p = 0; p < 2; p++) {
+		long errs[3] = { 0, 0, 0 }, found = 0;
+		EqCache cache[3];
+
+		for (int i = 0; i < EQ_TRIALS; i++) {
+			ChannelSim sim = { 20.0f, udelay(rng), false, profiles[p] };
+			EqResult res = runEqBurst(sps, sim, cache);
+
+			for (int type = 0; type < 3; type++)
+				errs[type] += res.errors[type];
+			found += res.detected;
+		}
+
+		float ber[3];
+		for (int type = 0; type < 3; type++)
+			ber[type] = (float) errs[type] / (found * PAYLOAD_BITS + 1);
+
+		bool ok = found >= EQ_TRIALS / 2;
+		for (int type = EQ_DFE; type <= EQ_MLSE; type++) {
+			if (profiles[p])
+				ok &= (ber[type] < 5e-3f) && (ber[type] < 0.2f * ber[EQ_NONE]);
+			else
+				ok &= ber[type] <= ber[EQ_NONE] + 1e-3f;
+		}
+		pass &= ok;
+
+		printf("%s: equalizers at %i sps, %s (%li of %i detected, BER "
+		       "none %.2e, DFE %.2e, MLSE %.2e)\n", ok ? "PASS" : "FAIL",
+		       sps, profiles[p] ? profiles[p]->name : "single path",
+		       found, EQ_TRIALS, ber[EQ_NONE], ber[EQ_DFE], ber[EQ_MLSE]);
+	}
+
+	return pass;
+}
+
+/*
+ * A repeated burst leaves the cached channel and DFE filters as they are,
+ * while a burst through a different channel replaces both
+ */
+static signalVector *detectedBurst(const signalVector &tx, int sps,
+				   const ChannelSim &sim, float &toa)
+{
+	complex amp;
+
+	for (int i = 0; i < 100; i++) {
+		signalVector *rx = applyChannel(tx, sps, sim);
+
+		if (detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, TSC,
+				   amp, toa, TEST_MAX_TOA) > 0)
+			return rx;
+		delete rx;
+	}
+
+	return NULL;
+}
+
+static bool testEqualizerCache(int sps)
+{
+	ChannelSim sim[2] = { { 30.0f, 1.0f, false, &twoRay },
+			      { 30.0f, 1.0f, false, NULL } };
+	BitVector bits(148);
+	EqCache c;
+	SoftVector soft;
+	float toas[2];
+	bool pass = false;
+
+	signalVector *tx = genNormalBurst(bits);
+	signalVector *rx[2] = { detectedBurst(*tx, sps, sim[0], toas[0]),
+				detectedBurst(*tx, sps, sim[1], toas[1]) };
+
+	if (rx[0] && rx[1] && equalizeBurst(*rx[0], sps, TEST_TSC, toas[0], EQ_DFE, c.chan,
+			  c.noise, c.forward, c.feedback, soft)) {
+		signalVector forward = c.forward;
+		signalVector chan = c.chan;
+
+		bool same = equalizeBurst(*rx[0], sps, TEST_TSC, toas[0], EQ_DFE,
+					  c.chan, c.noise, c.forward, c.feedback,
+					  soft);
+		for (size_t t = 0; same && (t < forward.size()); t++)
+			same = forward[t] == c.forward[t];
+		for (size_t t = 0; same && (t < chan.size()); t++)
+			same = (c.chan[t] - chan[t]).abs() < 1e-5f;
+
+		bool changed = equalizeBurst(*rx[1], sps, TEST_TSC, toas[1],
+					     EQ_DFE, c.chan, c.noise, c.forward,
+					     c.feedback, soft);
+		float diff = 0.0f;
+		for (size_t t = 0; changed && (t < forward.size()); t++)
+			diff += (forward[t] - c.forward[t]).abs();
+
+		pass = same && changed && (diff > 1e-2f) &&
+		       !countErrors(bits, soft, TSC);
+	}
+
+	delete tx;
+	delete rx[0];
+	delete rx[1];
+
+	printf("%s: equalizer cache at %i sps\n", pass ? "PASS" : "FAIL", sps);
+	return pass;
+}
+
+/*
+ * Carrier frequency offset correction with the offset tracked across the
+ * bursts of a timeslot. Bit errors are counted for plain single tap
+ * demodulation and for the corrected demodulator.
+ */
+#define FREQ_TRIALS		200
+
+struct FreqResult {
+	bool detected;
+	int errors[2];
+	float freq;
+};
+
+static FreqResult runFreqBurst(int sps, const ChannelSim &sim, float &track)
+{
+	BitVector bits(148);
+	FreqResult res = { false, { PAYLOAD_BITS, PAYLOAD_BITS }, 0.0f };
+	SoftVector soft;
+	complex amp;
+	float toa;
+
+	signalVector *tx = genNormalBurst(bits);
+	signalVector *rx = applyChannel(*tx, sps, sim);
+
+	if (detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, TSC,
+			   amp, toa, TEST_MAX_TOA) > 0) {
+		res.detected = true;
+
+		if (demodAnyBurst(*rx, sps, amp, toa, TSC, soft))
+			res.errors[0] = countErrors(bits, soft, TSC);
+		if (demodOffsetBurst(*rx, sps, TEST_TSC, amp, toa, track, soft))
+			res.errors[1] = countErrors(bits, soft, TSC);
+		res.freq = track;
+	}
+
+	delete tx;
+	delete rx;
+
+	return res;
+}
+
+/*
+ * Tracking from zero must settle on the applied offset. Corrected bursts
+ * must clearly beat plain demodulation under an offset, and must not lose
+ * to it without one.
+ */
+static bool testFreqOffset(int sps)
+{
+	const float offsets[] = { 0.0f, 800.0f };
+	std::uniform_real_distribution<float> udelay(0.0f, TEST_MAX_TOA / 2);
+	bool pass = true;
+
+	for (size_t f = 0; f < 2; f++) {
+		long errs[2] = { 0, 0 }, found = 0;
+		float track = 0.0f;
+
+		for (int i = 0; i < FREQ_TRIALS; i++) {
+			ChannelSim sim = { 12.0f, udelay(rng), false, NULL,
+					   offsets[f] };
+			FreqResult res = runFreqBurst(sps, sim, track);
+
+			errs[0] += res.errors[0];
+			errs[1] += res.errors[1];
+			found += res.detected;
+		}
+
+		float ber[2];
+		for (int n = 0; n < 2; n++)
+			ber[n] = (float) errs[n] / (found * PAYLOAD_BITS + 1);
+
+		bool ok = (found >= FREQ_TRIALS / 2) &&
+			  (fabsf(track - offsets[f]) < 50.0f);
+		if (offsets[f] > 0.0f)
+			ok &= ber[1] < 0.1f * ber[0];
+		else
+			ok &= ber[1] <= ber[0] + 1e-3f;
+		pass &= ok;
+
+		printf("%s: frequency offset %.0f Hz at %i sps (tracked %.0f Hz, "
+		       "BER plain %.2e, corrected %.2e)\n", ok ? "PASS" : "FAIL",
+		       offsets[f], sps, track, ber[0], ber[1]);
+	}
+
+	return pass;
+}
+
+static double timeNow()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Functional check - high SNR bursts at several timing offsets must be
+ * detected, track the applied offset and demodulate without errors.
+ * Timing is checked relative to the zero delay estimate, which carries
+ * the rate specific filter delays. The 2 SPS path must additionally agree
+ * with the 1 SPS timing reference.
+ */
+static bool testDetectDemod(int sps, CorrType type)
+{
+	const float delays[] = { 0.0f, 0.25f, 0.5f, 1.0f, 2.75f, 5.0f };
+	static float ref[2];
+	float bias = 0.0f;
+	bool pass = true;
+
+	for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+		ChannelSim sim = { 30.0f, delays[i], false };
+		BurstResult res = runBurst(sps, sim, type);
+
+		if (!i)
+			bias = res.toa;
+
+		if (!res.detected || (fabsf(res.toa - bias - delays[i]) > 0.1f) ||
+		    res.errors) {
+			printf("FAIL: sps %i delay %.2f detected %i toa %.3f errors %i\n",
+			       sps, delays[i], res.detected, res.toa, res.errors);
+			pass = false;
+		}
+	}
+
+	if (sps == 1)
+		ref[type == RACH] = bias;
+	if ((sps == 2) && (fabsf(bias - ref[type == RACH]) > 0.1f)) {
+		printf("FAIL: 2 sps timing %.3f differs from 1 sps %.3f\n",
+		       bias, ref[type == RACH]);
+		pass = false;
+	}
+
+	printf("%s: %s detect/demod at %i sps\n", pass ? "PASS" : "FAIL",
+	       type == RACH ? "RACH" : "TSC", sps);
+	return pass;
+}
+
+/*
+ * Timing accuracy of peak refinement over the channel simulation
+ *
+ * Fractional delays are drawn uniformly over four symbols. Errors are
+ * taken against the zero delay, noise free estimate, which carries the
+ * rate specific filter delays. The noise free sweep isolates the error of
+ * the sub-sample interpolation itself, the noisy sweeps with and without
+ * fading bound the error seen in operation. Detections more than a symbol
+ * off lock onto a sidelobe rather than the peak; they are counted apart
+ * and may not exceed one percent.
+ */
+#define TOA_TRIALS		400
+
+static bool testToaAccuracy(int sps, CorrType type)
+{
+	const float esn0s[] = { 100.0f, 30.0f, 20.0f, 10.0f };
+	const float rmsBounds[] = { 0.01f, 0.03f, 0.05f, 0.15f };
+	std::uniform_real_distribution<float> uniform(0.0f, 4.0f);
+	ChannelSim ref = { 100.0f, 0.0f, false };
+	float bias = runBurst(sps, ref, type).toa;
+	bool pass = true;
+
+	for (size_t n = 0; n < sizeof(esn0s) / sizeof(esn0s[0]); n++) {
+		for (int fading = 0; fading < 2; fading++) {
+			double sum = 0.0;
+			float max = 0.0f;
+			int num = 0, outliers = 0;
+
+			if (fading && (esn0s[n] > 50.0f))
+				continue;
+
+			for (int i = 0; i < TOA_TRIALS; i++) {
+				ChannelSim sim = { esn0s[n], uniform(rng), (bool) fading };
+				BurstResult res = runBurst(sps, sim, type);
+
+				if (!res.detected)
+					continue;
+
+				float err = res.toa - bias - sim.delay;
+				if (fabsf(err) > 1.0f) {
+					outliers++;
+					continue;
+				}
+
+				sum += err * err;
+				max = std::max(max, fabsf(err));
+				num++;
+			}
+
+			float rms = num ? sqrt(sum / num) : INFINITY;
+			bool ok = rms <= rmsBounds[n] &&
+				  outliers * 100 <= num + outliers;
+
+			printf("%s: %s %i sps Es/N0 %3.0f dB%s: TOA rms %.4f max %.4f "
+			       "symbols (%i detected, %i outliers)\n",
+			       ok ? "PASS" : "FAIL", type == RACH ? "RACH" : "TSC",
+			       sps, esn0s[n], fading ? " fading" : "", rms, max,
+			       num, outliers);
+			pass &= ok;
+		}
+	}
+
+	return pass;
+}
+
+/*
+ * FFT correlation against direct correlation. Bursts span the extended
+ * range search window for RACH and the regular window for normal bursts,
+ * detection must agree within rounding.
+ */
+static bool testFftCorrelation(int sps, CorrType type)
+{
+	const float delays[] = { 0.0f, 3.3f, 20.5f, 45.25f };
+	int max_toa = (type == RACH) ? 60 : TEST_MAX_TOA;
+	int num = (type == RACH) ? 4 : 2;
+	bool pass = true;
+
+	for (int i = 0; i < num; i++) {
+		BitVector bits(148);
+		ChannelSim sim = { 10.0f, delays[i], false };
+		signalVector *tx = (type == RACH) ?
+			genAccessBurst(bits) : genNormalBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+		complex amp[2];
+		float toa[2];
+		int rc[2];
+
+		for (int n = 0; n < 2; n++) {
+			setCorrelationMode(n ? CORR_FFT : CORR_DIRECT);
+			rc[n] = detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps,
+					       type, amp[n], toa[n], max_toa);
+		}
+
+		if ((rc[0] <= 0) || (rc[0] != rc[1]) ||
+		    (fabsf(toa[0] - toa[1]) > 1e-3f) ||
+		    ((amp[0] - amp[1]).abs() > 1e-3f * amp[0].abs())) {
+			printf("FAIL: sps %i delay %.2f rc %i/%i toa %.4f/%.4f\n",
+			       sps, delays[i], rc[0], rc[1], toa[0], toa[1]);
+			pass = false;
+		}
+
+		delete tx;
+		delete rx;
+	}
+
+	setCorrelationMode(CORR_AUTO);
+
+	printf("%s: %s FFT correlation at %i sps\n", pass ? "PASS" : "FAIL",
+	       type == RACH ? "RACH" : "TSC", sps);
+	return pass;
+}
+
+/*
+ * Windowed detection against full window detection. A window around the
+ * arrival time must give the same result, a window clear of the burst
+ * must not find it, although data may still pass as a weak midamble.
+ */
+static bool testDetectWindow(int sps, CorrType type)
+{
+	const float delays[] = { 0.0f, 2.7f, 17.3f, 36.5f };
+	bool pass = true;
+
+	for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+		BitVector bits(148);
+		ChannelSim sim = { 10.0f, delays[i], false };
+		signalVector *tx = (type == RACH) ?
+			genAccessBurst(bits) : genNormalBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+		complex amp[3];
+		float toa[3], lo, hi;
+		int rc[3];
+
+		rc[0] = detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, type,
+				       amp[0], toa[0], TEST_WIDE_TOA);
+		rc[1] = detectBurstWindow(*rx, TEST_TSC, BURST_THRESH, sps,
+					  type, amp[1], toa[1], TEST_WIDE_TOA,
+					  toa[0] - 1.0f, toa[0] + 1.0f);
+
+		lo = (toa[0] < TEST_WIDE_TOA / 2) ? toa[0] + 12.0f : toa[0] - 14.0f;
+		hi = lo + 2.0f;
+		rc[2] = detectBurstWindow(*rx, TEST_TSC, BURST_THRESH, sps,
+					  type, amp[2], toa[2], TEST_WIDE_TOA,
+					  lo, hi);
+
+		if ((rc[0] <= 0) || (rc[0] != rc[1]) ||
+		    (rc[2] > 0) ||
+		    (fabsf(toa[0] - toa[1]) > 1e-3f) ||
+		    ((amp[0] - amp[1]).abs() > 1e-3f * amp[0].abs())) {
+			printf("FAIL: sps %i delay %.2f rc %i/%i/%i toa %.4f/%.4f\n",
+			       sps, delays[i], rc[0], rc[1], rc[2],
+			       toa[0], toa[1]);
+			pass = false;
+		}
+
+		delete tx;
+		delete rx;
+	}
+
+	printf("%s: %s windowed detection at %i sps\n", pass ? "PASS" : "FAIL",
+	       type == RACH ? "RACH" : "TSC", sps);
+	return pass;
+}
+
+static std::string readFile(const std::string &path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	std::ostringstream data;
+
+	data << file.rdbuf();
+	return data.str();
+}
+
+static void writeFile(const std::string &path, const std::string &data)
+{
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	file << data;
+}
+
+/*
+ * Precomputed table file - generated on first setup, loaded unchanged on
+ * the next and regenerated when corrupt. Wisdom export and import must
+ * round trip.
+ */
+static bool testTableFile()
+{
+	char dir[] = "/tmp/sigProcLibTestXXXXXX";
+	bool pass = true;
+
+	if (!mkdtemp(dir)) {
+		printf("FAIL: table file directory\n");
+		return false;
+	}
+
+	std::string tables = std::string(dir) + "/dsp-tables";
+	std::string wisdom = std::string(dir) + "/fftw-wisdom";
+
+	sigProcLibDestroy();
+	setTableFile(tables);
+	pass &= sigProcLibSetup();
+
+	std::string first = readFile(tables);
+	pass &= !first.empty();
+
+	sigProcLibDestroy();
+	pass &= sigProcLibSetup();
+	pass &= readFile(tables) == first;
+
+	std::string corrupt = first;
+	corrupt[corrupt.size() - 1] ^= 0x55;
+	writeFile(tables, corrupt);
+
+	sigProcLibDestroy();
+	pass &= sigProcLibSetup();
+
+	std::string regen = readFile(tables);
+	pass &= (regen.size() == first.size()) && (regen != corrupt);
+
+	writeFile(tables, "");
+	sigProcLibDestroy();
+	pass &= sigProcLibSetup();
+	pass &= readFile(tables).size() == first.size();
+
+	pass &= !fft_save_wisdom(wisdom.c_str());
+	pass &= !fft_wisdom_changed();
+	pass &= !fft_load_wisdom(wisdom.c_str());
+
+	setTableFile("");
+	unlink(tables.c_str());
+	unlink(wisdom.c_str());
+	rmdir(dir);
+
+	printf("%s: table file and wisdom\n", pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+/*
+ * Setup for one receive rate leaves out the correlation sequences of the
+ * others, and of 8-PSK if not enabled. Detection at a rate not set up is
+ * unsupported, and 8-PSK detection falls back to GMSK.
+ */
+static bool testSetupRates()
+{
+	BitVector bits(148);
+	ChannelSim sim = { 20.0f, 1.5f, false };
+	complex amp;
+	float toa;
+	bool pass = true;
+
+	signalVector *tx = genNormalBurst(bits);
+	signalVector *rx1 = applyChannel(*tx, 1, sim);
+	signalVector *rx2 = applyChannel(*tx, 2, sim);
+
+	sigProcLibDestroy();
+	pass &= sigProcLibSetup(1, false);
+	pass &= detectAnyBurst(*rx1, TEST_TSC, BURST_THRESH, 1, TSC,
+			       amp, toa, TEST_MAX_TOA) == TSC;
+	pass &= detectAnyBurst(*rx1, TEST_TSC, BURST_THRESH, 1, EDGE,
+			       amp, toa, TEST_MAX_TOA) == TSC;
+	pass &= detectAnyBurst(*rx2, TEST_TSC, BURST_THRESH, 2, TSC,
+			       amp, toa, TEST_MAX_TOA) == -SIGERR_UNSUPPORTED;
+
+	sigProcLibDestroy();
+	pass &= sigProcLibSetup(2, true);
+	pass &= detectAnyBurst(*rx2, TEST_TSC, BURST_THRESH, 2, TSC,
+			       amp, toa, TEST_MAX_TOA) == TSC;
+	pass &= detectAnyBurst(*rx1, TEST_TSC, BURST_THRESH, 1, TSC,
+			       amp, toa, TEST_MAX_TOA) == -SIGERR_UNSUPPORTED;
+
+	sigProcLibDestroy();
+	pass &= sigProcLibSetup();
+
+	delete tx;
+	delete rx1;
+	delete rx2;
+
+	printf("%s: setup for one receive rate\n", pass ? "PASS" : "FAIL");
+	return pass;
+}
+
+/*
+ * Cold or warm start in a fresh process, with FFTW wisdom and the table file
+ * taken from and written to the given directory. Setup is for the default
+ * receive configuration of 1 SPS without 8-PSK.
+ */
+static bool startup(const char *dir)
+{
+	std::string wisdom = std::string(dir) + "/fftw-wisdom";
+	bool warm = !fft_load_wisdom(wisdom.c_str());
+
+	setTableFile(std::string(dir) + "/dsp-tables");
+
+	double start = timeNow();
+	if (!sigProcLibSetup(1, false))
+		return false;
+	double elapsed = timeNow() - start;
+
+	if (fft_wisdom_changed())
+		fft_save_wisdom(wisdom.c_str());
+
+	printf("Setup %s: %8.2f ms\n", warm ? "with wisdom and tables" :
+	       "from scratch", elapsed * 1e3);
+
+	sigProcLibDestroy();
+	return true;
+}
+
+/*
+ * Decimating convolution kernel against a direct evaluation. The burst
+ * length and filter match the 4 SPS to 1 SPS receive decimator.
+ */
+#define DECIM_IN_LEN		625
+#define DECIM_H_LEN		16
+
+static bool testDecimator()
+{
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	signalVector x(DECIM_IN_LEN), y(DOWNSAMPLE_LEN);
+	float *h = (float *) convolve_h_alloc(DECIM_H_LEN);
+	float err = 0.0f;
+	int start = DECIM_H_LEN - 1;
+	int len = (DECIM_IN_LEN - start + 3) / 4;
+
+	for (size_t i = 0; i < x.size(); i++)
+		x[i] = complex(uniform(rng), uniform(rng));
+	for (int i = 0; i < DECIM_H_LEN; i++) {
+		h[2 * i + 0] = uniform(rng);
+		h[2 * i + 1] = 0.0f;
+	}
+
+	int rc = convolve_decim_real((float *) x.begin(), x.size(),
+				     h, DECIM_H_LEN, (float *) y.begin(),
+				     y.size(), start, len, 4);
+
+	for (int n = 0; n < len; n++) {
+		complex ref = 0.0f;
+
+		for (int k = 0; k < DECIM_H_LEN; k++)
+			ref += x[start + 4 * n - (DECIM_H_LEN - 1) + k] * h[2 * k];
+
+		err = std::max(err, (y[n] - ref).abs());
+	}
+
+	free(h);
+
+	bool pass = (rc == len) && (err < 1e-5f);
+	printf("%s: 4:1 decimation kernel (max error %.2e)\n",
+	       pass ? "PASS" : "FAIL", err);
+	return pass;
+}
+
+/*
+ * Reference GMSK demodulator made up of the individual processing stages -
+ * fractional delay, channel correction, 4:1 or half-band 2:1 decimation
+ * with the receive decimation filters, derotation and soft conversion.
+ */
+static SoftVector *demodReference(const signalVector &burst, int sps,
+				  complex amp, float toa)
+{
+	signalVector *dec, *delay = delayVector(&burst, NULL, -toa * sps);
+	float h[DECIM_H_LEN], sum = 0.0f;
+
+	scaleVector(*delay, (complex) 1.0f / amp);
+
+	if (sps == 4) {
+		for (int n = 0; n < DECIM_H_LEN; n++) {
+			float x = M_PI * (n - (DECIM_H_LEN - 1) / 2.0f) / 4.0f;
+			float N = DECIM_H_LEN - 1;
+
+			h[n] = sinf(x) / x * (0.35875 -
+					      0.48829 * cos(2 * M_PI * n / N) +
+					      0.14128 * cos(4 * M_PI * n / N) -
+					      0.01168 * cos(6 * M_PI * n / N));
+			sum += h[n];
+		}
+
+		dec = new signalVector(DOWNSAMPLE_LEN);
+		for (int n = 0; n < DOWNSAMPLE_LEN; n++) {
+			complex acc = 0.0f;
+
+			for (int k = 0; k < DECIM_H_LEN; k++) {
+				int i = 4 * n - (DECIM_H_LEN - 1) + k;
+				if ((i >= 0) && (i < (int) delay->size()))
+					acc += (*delay)[i] * (h[k] / sum);
+			}
+
+			(*dec)[n] = acc;
+		}
+
+		delete delay;
+	} else if (sps == 2) {
+		const int len = 23, center = len / 2;
+		float g[len];
+
+		for (int n = 0; n < len; n++) {
+			float x = M_PI * (n - center) / 2.0f;
+
+			g[n] = (n == center) ? 1.0f : sinf(x) / x;
+			g[n] *= 0.35875 -
+				0.48829 * cos(2 * M_PI * n / (len - 1)) +
+				0.14128 * cos(4 * M_PI * n / (len - 1)) -
+				0.01168 * cos(6 * M_PI * n / (len - 1));
+			if ((n != center) && !((n - center) % 2))
+				g[n] = 0.0f;
+			sum += g[n];
+		}
+
+		dec = new signalVector(delay->size() / 2);
+		for (size_t n = 0; n < dec->size(); n++) {
+			complex acc = 0.0f;
+
+			for (int k = 0; k < len; k++) {
+				int i = 2 * n - center + k;
+				if ((i >= 0) && (i < (int) delay->size()))
+					acc += (*delay)[i] * (g[k] / sum);
+			}
+
+			(*dec)[n] = acc;
+		}
+
+		delete delay;
+	} else {
+		dec = delay;
+	}
+
+	SoftVector *soft = new SoftVector(dec->size());
+	for (size_t n = 0; n < dec->size(); n++) {
+		complex rot(cos(-M_PI / 2.0 * n), sin(-M_PI / 2.0 * n));
+		(*soft)[n] = ((*dec)[n] * rot).real();
+	}
+
+	delete dec;
+	return soft;
+}
+
+/*
+ * Fused GMSK demodulator against the reference stages over random timing
+ * offsets and channel gains. The leading tail symbols and the guard period
+ * lie within a filter span of the burst edges, where the separate stages
+ * at 4 SPS shift in zeros that the fused filter takes from the burst.
+ * There, the first data symbol must still match closely and the other
+ * symbols within half a symbol.
+ */
+static bool testFusedDemod(int sps)
+{
+	std::uniform_real_distribution<float> udelay(0.0f, TEST_MAX_TOA);
+	std::normal_distribution<float> gauss(0.0f, 1.0f);
+	float err = 0.0f, lead = 0.0f, edge = 0.0f;
+	SoftVector out;
+	const float *storage = NULL;
+	bool reuse = true;
+
+	for (int i = 0; i < 200; i++) {
+		ChannelSim sim = { 20.0f, udelay(rng), true };
+		BitVector bits(148);
+
+		signalVector *tx = genNormalBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+		complex amp(gauss(rng), gauss(rng));
+		float toa = sim.delay + udelay(rng) / 8.0f;
+
+		/* Include whole sample offsets, which skip the delay filter */
+		if (i % 4 == 0)
+			toa = floorf(toa * sps) / sps;
+
+		SoftVector *ref = demodReference(*rx, sps, amp, toa);
+		SoftVector *soft = demodAnyBurst(*rx, sps, amp, toa, TSC);
+
+		if (!soft || (soft->size() != ref->size())) {
+			printf("FAIL: fused demod at %i sps output size\n", sps);
+			delete tx;
+			delete rx;
+			delete ref;
+			delete soft;
+			return false;
+		}
+
+		/* Caller provided output keeps its storage across bursts */
+		if (!demodAnyBurst(*rx, sps, amp, toa, TSC, out) ||
+		    (out.size() != soft->size()) ||
+		    memcmp(out.begin(), soft->begin(), soft->bytes()) ||
+		    (storage && (storage != out.begin())))
+			reuse = false;
+		storage = out.begin();
+
+		float scale = amp.abs();
+		for (size_t n = 0; n < soft->size(); n++) {
+			float diff = fabsf((*soft)[n] - (*ref)[n]) * scale;
+
+			if ((n >= 4) && (n < bits.size()))
+				err = std::max(err, diff);
+			else if (n == 3)
+				lead = std::max(lead, diff);
+			else
+				edge = std::max(edge, diff);
+		}
+
+		delete tx;
+		delete rx;
+		delete ref;
+		delete soft;
+	}
+
+	bool pass = (err < 1e-4f) && (lead < 2e-3f) && (edge < 0.5f) && reuse;
+	printf("%s: fused demod at %i sps (max error %.2e, first data %.2e, "
+	       "edges %.2e%s)\n", pass ? "PASS" : "FAIL", sps, err, lead, edge,
+	       reuse ? "" : ", output vector not reused");
+	return pass;
+}
+
+/* TRXD reference: slicer pass, then per bit rounding */
+static void quantizeReference(const SoftVector &soft, char *out)
+{
+	SoftVector sliced(soft);
+
+	vectorSlicer(&sliced);
+	for (size_t i = 0; i < sliced.size(); i++)
+		out[i] = (char) round(sliced[i] * 255.0);
+}
+
+/* Packed bits against the bit field accessors, one byte at a time */
+static void packReference(const BitVector &bits, unsigned char *out)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= bits.size(); i += 8)
+		out[i / 8] = bits.peekField(i, 8);
+	if (i < bits.size())
+		out[i / 8] = bits.peekField(i, bits.size() - i) <<
+			     (8 - (bits.size() - i));
+}
+
+static bool testTrxdBits()
+{
+	std::uniform_real_distribution<float> usoft(-1.5f, 1.5f);
+	std::uniform_int_distribution<int> ubit(0, 1);
+	const size_t lens[] = { 148, 444, 70 };
+	int quantErrs = 0, packErrs = 0;
+
+	for (int n = 0; n < 100; n++) {
+		SoftVector soft(444);
+		char ref[444], out[444];
+
+		for (size_t i = 0; i < soft.size(); i++)
+			soft[i] = usoft(rng);
+
+		/* Saturation, midpoint and exact rounding ties */
+		if (!n) {
+			const float edges[] = { -2.0f, -1.0f, 0.0f, 1.0f, 2.0f };
+			for (size_t i = 0; i < 5; i++)
+				soft[i] = edges[i];
+			for (size_t i = 5; i < soft.size(); i++)
+				soft[i] = (2.0f * (i - 5) + 1.0f) / 255.0f - 1.0f;
+		}
+
+		quantizeReference(soft, ref);
+		vectorQuantize(soft, out);
+		quantErrs += memcmp(ref, out, soft.size()) != 0;
+
+		for (size_t l = 0; l < 3; l++) {
+			BitVector bits(lens[l]), unpacked(lens[l]);
+			unsigned char packed[56], expect[56];
+
+			for (size_t i = 0; i < bits.size(); i++)
+				bits[i] = ubit(rng);
+
+			bits.pack(packed);
+			packReference(bits, expect);
+			unpacked.unpack(packed);
+
+			if (memcmp(packed, expect, (lens[l] + 7) / 8) ||
+			    memcmp(unpacked.begin(), bits.begin(), bits.size()))
+				packErrs++;
+		}
+	}
+
+	bool pass = !quantErrs && !packErrs;
+	printf("%s: TRXD bits (%i quantizer mismatches, %i pack mismatches)\n",
+	       pass ? "PASS" : "FAIL", quantErrs, packErrs);
+	return pass;
+}
+
+/* Bit error rate sweep over Es/N0 with and without flat fading */
+static void berSweep(int num, bool fading)
+{
+	const int spsList[] = { 1, 2, 4 };
+
+	printf("BER %s (%i bursts per point, random delay 0-%i symbols)\n",
+	       fading ? "Rayleigh block fading" : "AWGN", num, TEST_MAX_TOA / 2);
+	printf("  Es/N0");
+	for (size_t n = 0; n < 3; n++)
+		printf("     %i sps  (miss)", spsList[n]);
+	printf("\n");
+
+	for (int esn0 = 0; esn0 <= (fading ? 24 : 12); esn0 += 2) {
+		printf("  %3i dB", esn0);
+
+		for (size_t n = 0; n < 3; n++) {
+			std::uniform_real_distribution<float> udelay(0.0f, TEST_MAX_TOA / 2);
+			long errs = 0, miss = 0;
+
+			for (int i = 0; i < num; i++) {
+				ChannelSim sim = { (float) esn0, udelay(rng), fading };
+				BurstResult res = runBurst(spsList[n], sim);
+
+				errs += res.errors;
+				miss += !res.detected;
+			}
+
+			printf("  %9.2e (%4li)",
+			       (double) errs / (num * PAYLOAD_BITS), miss);
+		}
+		printf("\n");
+	}
+}
+
+/* Bit error rate of selection against maximal ratio combining */
+static void diversitySweep(int num)
+{
+	const int spsList[] = { 1, 4 };
+
+	printf("BER %i path Rayleigh block fading (%i bursts per point)\n",
+	       DIV_PATHS, num);
+	printf("  Es/N0");
+	for (size_t n = 0; n < 2; n++)
+		printf("  %i sps select (miss)     MRC (miss)", spsList[n]);
+	printf("\n");
+
+	for (int esn0 = 0; esn0 <= 20; esn0 += 2) {
+		printf("  %3i dB", esn0);
+
+		for (size_t n = 0; n < 2; n++) {
+			std::uniform_real_distribution<float> udelay(0.0f, TEST_MAX_TOA / 2);
+
+			for (int mrc = 0; mrc < 2; mrc++) {
+				long errs = 0, miss = 0;
+
+				for (int i = 0; i < num; i++) {
+					ChannelSim sim = { (float) esn0, udelay(rng), true };
+					BurstResult res = runDiversityBurst(spsList[n], sim, mrc);
+
+					errs += res.errors;
+					miss += !res.detected;
+				}
+
+				printf("  %9.2e (%4li)",
+				       (double) errs / (num * PAYLOAD_BITS), miss);
+			}
+		}
+		printf("\n");
+	}
+}
+
+/*
+ * Bit loss of both VAMOS users over the power of the second user, joint
+ * against single user reception, with missed bursts counted as lost
+ */
+static void vamosSweep(int num)
+{
+	const float ratios[] = { 0.0f, -3.0f, -6.0f, -10.0f };
+
+	printf("VAMOS bit loss at 4 sps (%i bursts per point)\n", num);
+	printf("  Es/N0  ratio      joint user 0/1       single user 0/1\n");
+
+	for (int esn0 = 10; esn0 <= 30; esn0 += 5) {
+		for (size_t n = 0; n < sizeof(ratios) / sizeof(ratios[0]); n++) {
+			std::uniform_real_distribution<float> udelay(0.0f, TEST_MAX_TOA / 2);
+			long joint[2] = { 0, 0 }, single[2] = { 0, 0 };
+
+			for (int i = 0; i < num; i++) {
+				ChannelSim sim = { (float) esn0, udelay(rng), false };
+				VamosResult res = runVamosBurst(4, sim, ratios[n]);
+
+				for (int u = 0; u < 2; u++) {
+					joint[u] += res.joint[u].errors;
+					single[u] += res.single[u].errors;
+				}
+			}
+
+			printf("  %3i dB %3.0f dB  %9.2e %9.2e  %9.2e %9.2e\n",
+			       esn0, ratios[n],
+			       (double) joint[0] / (num * PAYLOAD_BITS),
+			       (double) joint[1] / (num * PAYLOAD_BITS),
+			       (double) single[0] / (num * PAYLOAD_BITS),
+			       (double) single[1] / (num * PAYLOAD_BITS));
+		}
+	}
+}
+
+/* Bit error rate of the equalizers over multipath profiles */
+static void equalizerSweep(int num)
+{
+	const Multipath *profiles[] = { &twoRay, &typicalUrban, &hillyTerrain };
+	const int spsList[] = { 1, 4 };
+
+	for (size_t p = 0; p < 3; p++) {
+		bool fading = profiles[p] != &twoRay;
+
+		printf("BER %s%s (%i bursts per point)\n", profiles[p]->name,
+		       fading ? " Rayleigh block fading" : " static", num);
+		printf("  Es/N0  sps       none        DFE       MLSE  (miss)\n");
+
+		for (int esn0 = 5; esn0 <= 30; esn0 += 5) {
+			for (size_t n = 0; n < 2; n++) {
+				std::uniform_real_distribution<float> udelay(0.0f, EQ_MAX_DELAY);
+				long errs[3] = { 0, 0, 0 }, miss = 0;
+				EqCache cache[3];
+
+				for (int i = 0; i < num; i++) {
+					ChannelSim sim = { (float) esn0, udelay(rng),
+							   fading, profiles[p] };
+					EqResult res = runEqBurst(spsList[n], sim, cache);
+
+					for (int type = 0; type < 3; type++)
+						errs[type] += res.errors[type];
+					miss += !res.detected;
+				}
+
+				printf("  %3i dB  %3i", esn0, spsList[n]);
+				for (int type = 0; type < 3; type++)
+					printf("  %9.2e", (double) errs[type] /
+					       ((num - miss) * PAYLOAD_BITS + 1));
+				printf("  (%4li)\n", miss);
+			}
+		}
+	}
+}
+
+/* Frequency offset correction over offsets and Es/N0 with tracking */
+static void freqSweep(int num)
+{
+	const float offsets[] = { 0.0f, 200.0f, 500.0f, 1000.0f };
+	const int spsList[] = { 1, 4 };
+
+	for (size_t f = 0; f < sizeof(offsets) / sizeof(offsets[0]); f++) {
+		printf("BER %.0f Hz offset, static (%i bursts per point)\n",
+		       offsets[f], num);
+		printf("  Es/N0  sps      plain  corrected   estimate  (miss)\n");
+
+		for (int esn0 = 5; esn0 <= 30; esn0 += 5) {
+			for (size_t n = 0; n < 2; n++) {
+				std::uniform_real_distribution<float> udelay(0.0f, TEST_MAX_TOA / 2);
+				long errs[2] = { 0, 0 }, miss = 0;
+				double est = 0.0;
+				float track = 0.0f;
+
+				for (int i = 0; i < num; i++) {
+					ChannelSim sim = { (float) esn0, udelay(rng),
+							   false, NULL, offsets[f] };
+					FreqResult res = runFreqBurst(spsList[n], sim, track);
+
+					errs[0] += res.errors[0];
+					errs[1] += res.errors[1];
+					est += res.freq;
+					miss += !res.detected;
+				}
+
+				printf("  %3i dB  %3i  %9.2e  %9.2e  %6.0f Hz  (%4li)\n",
+				       esn0, spsList[n],
+				       (double) errs[0] / ((num - miss) * PAYLOAD_BITS + 1),
+				       (double) errs[1] / ((num - miss) * PAYLOAD_BITS + 1),
+				       est / (num - miss + 1e-9), miss);
+			}
+		}
+	}
+}
+
+/* Receive path timing - detection plus demodulation per burst */
+static void benchmark(const char *prog, int num)
+{
+	const int spsList[] = { 1, 2, 4 };
+
+	for (size_t n = 0; n < 3; n++) {
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.5f, false };
+		complex amp;
+		float toa;
+
+		signalVector *tx = genNormalBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+
+		double start = timeNow();
+		for (int i = 0; i < num; i++) {
+			detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, TSC,
+				       amp, toa, TEST_MAX_TOA);
+			delete demodAnyBurst(*rx, sps, amp, toa, TSC);
+		}
+		double elapsed = timeNow() - start;
+
+		printf("Rx %i sps: %8.2f us per burst (detect + demod)\n",
+		       sps, elapsed / num * 1e6);
+
+		delete tx;
+		delete rx;
+	}
+
+	for (size_t n = 0; n < 3; n++) {
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.5f, false };
+		complex amp = 1.0f;
+		float toa = 1.8f;
+
+		signalVector *tx = genNormalBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+
+		SoftVector out;
+
+		double start = timeNow();
+		for (int i = 0; i < num; i++)
+			delete demodAnyBurst(*rx, sps, amp, toa, TSC);
+		double fused = timeNow() - start;
+
+		start = timeNow();
+		for (int i = 0; i < num; i++)
+			demodAnyBurst(*rx, sps, amp, toa, TSC, out);
+		double reused = timeNow() - start;
+
+		start = timeNow();
+		for (int i = 0; i < num; i++)
+			delete demodReference(*rx, sps, amp, toa);
+		double chain = timeNow() - start;
+
+		printf("Demod %i sps: %8.2f us fused, %8.2f us fused into caller "
+		       "vector, %8.2f us chained\n", sps, fused / num * 1e6,
+		       reused / num * 1e6, chain / num * 1e6);
+
+		delete tx;
+		delete rx;
+	}
+
+	for (size_t n = 0; n < 3; n += 2) {
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.5f, false };
+		std::vector<signalVector *> rx(DIV_PATHS);
+		complex amp;
+		float toa;
+
+		signalVector *tx = genNormalBurst(bits);
+		for (size_t i = 0; i < DIV_PATHS; i++)
+			rx[i] = applyChannel(*tx, sps, sim);
+
+		double start = timeNow();
+		for (int i = 0; i < num; i++) {
+			float max = -1.0f;
+			size_t max_i = 0;
+
+			for (size_t p = 0; p < DIV_PATHS; p++) {
+				float pow = energyDetect(*rx[p], 20 * sps);
+				if (pow > max) {
+					max = pow;
+					max_i = p;
+				}
+			}
+
+			detectAnyBurst(*rx[max_i], TEST_TSC, BURST_THRESH, sps, TSC,
+				       amp, toa, TEST_MAX_TOA);
+			delete demodAnyBurst(*rx[max_i], sps, amp, toa, TSC);
+		}
+		double select = timeNow() - start;
+
+		start = timeNow();
+		for (int i = 0; i < num; i++) {
+			std::vector<const signalVector *> bursts;
+			std::vector<complex> amps;
+			std::vector<float> toas;
+
+			for (size_t p = 0; p < DIV_PATHS; p++) {
+				detectAnyBurst(*rx[p], TEST_TSC, BURST_THRESH, sps, TSC,
+					       amp, toa, TEST_MAX_TOA);
+				bursts.push_back(rx[p]);
+				amps.push_back(amp);
+				toas.push_back(toa);
+			}
+
+			delete demodDiversityBurst(bursts, sps, amps, toas, TSC);
+		}
+		double mrc = timeNow() - start;
+
+		printf("Rx %i sps %i paths: %8.2f us select, %8.2f us MRC\n",
+		       sps, DIV_PATHS, select / num * 1e6, mrc / num * 1e6);
+
+		for (size_t i = 0; i < DIV_PATHS; i++)
+			delete rx[i];
+		delete tx;
+	}
+
+	for (size_t n = 0; n < 3; n += 2) {
+		const unsigned tsc[2] = { TEST_TSC, VAMOS_TSC };
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.5f, false };
+		BurstDetection det[2];
+		SoftVector soft[2];
+
+		signalVector *tx = genNormalBurst(bits);
+		signalVector *tx1 = genNormalBurst(bits, VAMOS_TSC);
+		for (size_t i = 0; i < tx->size(); i++)
+			(*tx)[i] += (*tx1)[i] * complex(0.0f, 0.7f);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+
+		double start = timeNow();
+		for (int i = 0; i < num; i++) {
+			detectVamosBurst(*rx, tsc, BURST_THRESH, sps, TEST_MAX_TOA,
+					 det);
+			demodVamosBurst(*rx, sps, tsc, det[0].toa, soft[0], soft[1]);
+		}
+		double elapsed = timeNow() - start;
+
+		printf("VAMOS %i sps: %8.2f us per slot (detect + demod of both "
+		       "users)\n", sps, elapsed / num * 1e6);
+
+		delete tx;
+		delete tx1;
+		delete rx;
+	}
+
+	/*
+	 * Equalized demodulation per burst after detection, with the timeslot
+	 * cache kept on a static channel and redesigned on every burst
+	 */
+	for (size_t n = 0; n < 3; n += 2) {
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.0f, false, &twoRay };
+		SoftVector soft;
+		complex amp;
+		float toa;
+
+		signalVector *tx = genNormalBurst(bits);
+		signalVector *rx = detectedBurst(*tx, sps, sim, toa);
+		if (!rx) {
+			delete tx;
+			continue;
+		}
+
+		double start = timeNow();
+		for (int i = 0; i < num; i++)
+			demodAnyBurst(*rx, sps, amp, toa, TSC, soft);
+		double single = timeNow() - start;
+
+		printf("Equalizer %i sps: %8.2f us single tap", sps,
+		       single / num * 1e6);
+
+		for (int type = EQ_DFE; type <= EQ_MLSE; type++) {
+			EqCache c, fresh;
+
+			start = timeNow();
+			for (int i = 0; i < num; i++)
+				equalizeBurst(*rx, sps, TEST_TSC, toa,
+					      (EqualizerType) type, c.chan, c.noise,
+					      c.forward, c.feedback, soft);
+			double cached = timeNow() - start;
+
+			start = timeNow();
+			for (int i = 0; i < num; i++) {
+				c = fresh;
+				equalizeBurst(*rx, sps, TEST_TSC, toa,
+					      (EqualizerType) type, c.chan, c.noise,
+					      c.forward, c.feedback, soft);
+			}
+			double design = timeNow() - start;
+
+			printf(", %8.2f us %s (%.2f us new channel)",
+			       cached / num * 1e6, type == EQ_DFE ? "DFE" : "MLSE",
+			       design / num * 1e6);
+		}
+		printf("\n");
+
+		delete tx;
+		delete rx;
+	}
+
+	/* Added cost of frequency offset correction per burst */
+	for (size_t n = 0; n < 3; n += 2) {
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.5f, false, NULL, 500.0f };
+		SoftVector soft;
+		complex amp;
+		float toa, freq = 0.0f;
+
+		signalVector *tx = genNormalBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+
+		detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, TSC,
+			       amp, toa, TEST_MAX_TOA);
+
+		double start = timeNow();
+		for (int i = 0; i < num; i++)
+			demodAnyBurst(*rx, sps, amp, toa, TSC, soft);
+		double plain = timeNow() - start;
+
+		start = timeNow();
+		for (int i = 0; i < num; i++)
+			demodOffsetBurst(*rx, sps, TEST_TSC, amp, toa, freq, soft);
+		double corrected = timeNow() - start;
+
+		printf("Frequency offset %i sps: %8.2f us plain demod, %8.2f us "
+		       "corrected\n", sps, plain / num * 1e6,
+		       corrected / num * 1e6);
+
+		delete tx;
+		delete rx;
+	}
+
+	/* TRXD soft bit encoding and hard bit packing per burst */
+	for (size_t l = 0; l < 2; l++) {
+		const size_t lens[] = { 148, 444 };
+		std::uniform_real_distribution<float> usoft(-1.5f, 1.5f);
+		SoftVector soft(lens[l]);
+		BitVector bits(lens[l]);
+		char buf[444];
+		unsigned char packed[56];
+
+		for (size_t i = 0; i < soft.size(); i++) {
+			soft[i] = usoft(rng);
+			bits[i] = soft[i] > 0.0f;
+		}
+
+		double start = timeNow();
+		for (int i = 0; i < num; i++)
+			quantizeReference(soft, buf);
+		double sliced = timeNow() - start;
+
+		start = timeNow();
+		for (int i = 0; i < num; i++)
+			vectorQuantize(soft, buf);
+		double fused = timeNow() - start;
+
+		start = timeNow();
+		for (int i = 0; i < num; i++)
+			packReference(bits, packed);
+		double fields = timeNow() - start;
+
+		start = timeNow();
+		for (int i = 0; i < num; i++) {
+			bits.pack(packed);
+			bits.unpack(packed);
+		}
+		double words = timeNow() - start;
+
+		printf("TRXD %3zu bits: %8.3f us slice + round, %8.3f us fused, "
+		       "%8.3f us field pack, %8.3f us word pack + unpack\n",
+		       lens[l], sliced / num * 1e6, fused / num * 1e6,
+		       fields / num * 1e6, words / num * 1e6);
+	}
+
+	/* Tracked timing searches three symbols around the last arrival */
+	for (size_t n = 0; n < 3; n += 2) {
+		const int maxToas[] = { 8, 16, 32, 63 };
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.5f, false };
+		complex amp;
+		float toa, track;
+
+		signalVector *tx = genNormalBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+
+		detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps, TSC,
+			       amp, track, TEST_MAX_TOA);
+
+		for (size_t m = 0; m < sizeof(maxToas) / sizeof(maxToas[0]); m++) {
+			double start = timeNow();
+			for (int i = 0; i < num; i++)
+				detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps,
+					       TSC, amp, toa, maxToas[m]);
+			double full = timeNow() - start;
+
+			start = timeNow();
+			for (int i = 0; i < num; i++)
+				detectBurstWindow(*rx, TEST_TSC, BURST_THRESH, sps,
+						  TSC, amp, toa, maxToas[m],
+						  track - 1.5f, track + 1.5f);
+			double window = timeNow() - start;
+
+			printf("Detect %i sps max delay %2i: %8.2f us full window, "
+			       "%8.2f us tracked\n", sps, maxToas[m],
+			       full / num * 1e6, window / num * 1e6);
+		}
+
+		delete tx;
+		delete rx;
+	}
+
+	for (size_t n = 0; n < 3; n++) {
+		const int maxToas[] = { 8, 32, 64, 128, 256 };
+		int sps = spsList[n];
+		BitVector bits(148);
+		ChannelSim sim = { 20.0f, 1.5f, false };
+		complex amp;
+		float toa;
+
+		signalVector *tx = genAccessBurst(bits);
+		signalVector *rx = applyChannel(*tx, sps, sim);
+
+		for (size_t m = 0; m < sizeof(maxToas) / sizeof(maxToas[0]); m++) {
+			const CorrMode modes[] = { CORR_DIRECT, CORR_FFT, CORR_AUTO };
+			double elapsed[3];
+
+			for (int k = 0; k < 3; k++) {
+				setCorrelationMode(modes[k]);
+
+				double start = timeNow();
+				for (int i = 0; i < num; i++)
+					detectAnyBurst(*rx, TEST_TSC, BURST_THRESH, sps,
+						       RACH, amp, toa, maxToas[m]);
+				elapsed[k] = timeNow() - start;
+			}
+
+			printf("RACH %i sps max delay %3i: %8.2f us direct, %8.2f us "
+			       "FFT, %8.2f us auto\n", sps, maxToas[m],
+			       elapsed[0] / num * 1e6, elapsed[1] / num * 1e6,
+			       elapsed[2] / num * 1e6);
+		}
+
+		delete tx;
+		delete rx;
+	}
+
+	signalVector x(DECIM_IN_LEN), y(DOWNSAMPLE_LEN);
+	float *h = (float *) convolve_h_alloc(DECIM_H_LEN);
+	memset(h, 0, DECIM_H_LEN * 2 * sizeof(float));
+
+	double start = timeNow();
+	for (int i = 0; i < num; i++) {
+		convolve_decim_real((float *) x.begin(), x.size(), h,
+				    DECIM_H_LEN, (float *) y.begin(), y.size(),
+				    DECIM_H_LEN - 1, y.size() - 4, 4);
+	}
+	double elapsed = timeNow() - start;
+
+	printf("Decimate 4:1: %8.2f us per burst\n", elapsed / num * 1e6);
+
+	/*
+	 * Downlink modulation runs inline on the socket reactor. A TDMA frame
+	 * lasts 120/26 ms and carries 8 bursts per channel, so report the
+	 * share of the reactor taken by fully loaded channels.
+	 */
+	BitVector gmsk(148), psk(EDGE_BURST_NBITS);
+	double mod[2];
+
+	start = timeNow();
+	for (int i = 0; i < num; i++)
+		delete modulateBurst(gmsk, 8, 4);
+	mod[0] = (timeNow() - start) / num;
+
+	start = timeNow();
+	for (int i = 0; i < num; i++)
+		delete modulateEdgeBurst(psk, 4);
+	mod[1] = (timeNow() - start) / num;
+
+	for (int k = 0; k < 2; k++) {
+		printf("Modulate 4 sps %s: %8.2f us per burst, reactor load "
+		       "%.1f%% at 1, %.1f%% at 8 channels\n",
+		       k ? "8-PSK" : "GMSK ", mod[k] * 1e6,
+		       mod[k] * 8 / (120e-3 / 26) * 100,
+		       mod[k] * 64 / (120e-3 / 26) * 100);
+	}
+
+	/* Restart timing needs fresh processes, FFTW wisdom is process wide */
+	char dir[] = "/tmp/sigProcLibTestXXXXXX";
+	if (mkdtemp(dir)) {
+		std::string cmd = std::string(prog) + " startup " + dir;
+
+		for (int i = 0; i < 2; i++) {
+			fflush(stdout);
+			if (system(cmd.c_str()))
+				printf("Setup failed\n");
+		}
+
+		unlink((std::string(dir) + "/fftw-wisdom").c_str());
+		unlink((std::string(dir) + "/dsp-tables").c_str());
+		rmdir(dir);
+	}
+
+	free(h);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [test|ber|div|vamos|eq|freq|bench] [count]\n", prog);
+	printf("       %s startup <directory>\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *mode = (argc > 1) ? argv[1] : "test";
+	int count = (argc > 2) ? atoi(argv[2]) : 0;
+	bool pass = true;
+
+	convolve_init();
+
+	if (!strcmp(mode, "startup") && (argc > 2))
+		return startup(argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	if (!sigProcLibSetup()) {
+		printf("Signal processing library setup failed\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!strcmp(mode, "test")) {
+		pass &= testDecimator();
+		pass &= testFusedDemod(1);
+		pass &= testFusedDemod(2);
+		pass &= testFusedDemod(4);
+		pass &= testTrxdBits();
+		pass &= testCombiner(1);
+		pass &= testCombiner(4);
+		pass &= testVamos(1);
+		pass &= testVamos(4);
+		pass &= testEqualizer(1);
+		pass &= testEqualizer(4);
+		pass &= testEqualizerCache(1);
+		pass &= testEqualizerCache(4);
+		pass &= testFreqOffset(1);
+		pass &= testFreqOffset(4);
+		pass &= testDetectDemod(1, TSC);
+		pass &= testDetectDemod(2, TSC);
+		pass &= testDetectDemod(4, TSC);
+		pass &= testDetectDemod(1, RACH);
+		pass &= testDetectDemod(2, RACH);
+		pass &= testDetectDemod(4, RACH);
+		pass &= testToaAccuracy(1, TSC);
+		pass &= testToaAccuracy(4, TSC);
+		pass &= testToaAccuracy(1, RACH);
+		pass &= testFftCorrelation(1, TSC);
+		pass &= testFftCorrelation(2, TSC);
+		pass &= testFftCorrelation(4, TSC);
+		pass &= testFftCorrelation(1, RACH);
+		pass &= testFftCorrelation(2, RACH);
+		pass &= testFftCorrelation(4, RACH);
+		pass &= testDetectWindow(1, TSC);
+		pass &= testDetectWindow(2, TSC);
+		pass &= testDetectWindow(4, TSC);
+		pass &= testDetectWindow(1, RACH);
+		pass &= testTableFile();
+		pass &= testSetupRates();
+	} else if (!strcmp(mode, "ber")) {
+		berSweep(count ? count : 500, false);
+		berSweep(count ? count : 500, true);
+	} else if (!strcmp(mode, "div")) {
+		diversitySweep(count ? count : 500);
+	} else if (!strcmp(mode, "vamos")) {
+		vamosSweep(count ? count : 500);
+	} else if (!strcmp(mode, "eq")) {
+		equalizerSweep(count ? count : 500);
+	} else if (!strcmp(mode, "freq")) {
+		freqSweep(count ? count : 500);
+	} else if (!strcmp(mode, "bench")) {
+		benchmark(argv[0], count ? count : 10000);
+	} else {
+		usage(argv[0]);
+		pass = false;
+	}
+
+	sigProcLibDestroy();
+
+	return pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
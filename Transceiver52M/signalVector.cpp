@@ -1,26 +1,36 @@
 #include "signalVector.h"
 
+#include <utility>
+
 signalVector::signalVector(size_t size)
 	: Vector<complex>(size),
-	  real(false), aligned(false), symmetry(NONE)
+	  real(false), symmetry(NONE)
 {
 }
 
 signalVector::signalVector(size_t size, size_t start)
 	: Vector<complex>(size + start),
-	  real(false), aligned(false), symmetry(NONE)
+	  real(false), symmetry(NONE)
+{
+	mStart = mData + start;
+}
+
+signalVector::signalVector(size_t size, size_t start,
+			   VectorAllocator *allocator)
+	: Vector<complex>(size + start, allocator),
+	  real(false), symmetry(NONE)
 {
 	mStart = mData + start;
 }
 
 signalVector::signalVector(complex *data, size_t start, size_t span)
 	: Vector<complex>(NULL, data + start, data + start + span),
-	  real(false), aligned(false), symmetry(NONE)
+	  real(false), symmetry(NONE)
 {
 }
 
 signalVector::signalVector(const signalVector &vector)
-	: Vector<complex>(vector.size() + vector.getStart()), aligned(false)
+	: Vector<complex>(vector.size() + vector.getStart())
 {
 	mStart = mData + vector.getStart();
 	vector.copyTo(*this);
@@ -30,7 +40,7 @@ signalVector::signalVector(const signalVector &vector)
 
 signalVector::signalVector(const signalVector &vector,
 			   size_t start, size_t tail)
-	: Vector<complex>(start + vector.size() + tail), aligned(false)
+	: Vector<complex>(start + vector.size() + tail)
 {
 	mStart = mData + start;
 	vector.copyTo(*this);
@@ -38,11 +48,29 @@ signalVector::signalVector(const signalVector &vector,
 	real = vector.isReal();
 };
 
-void signalVector::operator=(const signalVector& vector)
+signalVector::signalVector(signalVector &&vector)
+	: Vector<complex>(std::move(vector)),
+	  real(vector.real), symmetry(vector.symmetry)
+{
+}
+
+signalVector &signalVector::operator=(const signalVector& vector)
 {
+	if (this == &vector)
+		return *this;
+
 	resize(vector.size() + vector.getStart());
 	memcpy(mData, vector.mData, bytes());
 	mStart = mData + vector.getStart();
+	return *this;
+}
+
+signalVector &signalVector::operator=(signalVector &&vector)
+{
+	Vector<complex>::operator=(std::move(vector));
+	real = vector.real;
+	symmetry = vector.symmetry;
+	return *this;
 }
 
 signalVector signalVector::segment(size_t start, size_t span)
@@ -86,10 +114,5 @@ void signalVector::isReal(bool wOnly)
 
 bool signalVector::isAligned() const
 {
-	return aligned;
-}
-
-void signalVector::setAligned(bool aligned)
-{
-	this->aligned = aligned;
+	return Vector<complex>::isAligned(16);
 }
@@ -18,17 +18,26 @@ public:
 	/** Construct with head room */
 	signalVector(size_t size, size_t start);
 
+	/** Construct with head room and storage from an allocator */
+	signalVector(size_t size, size_t start, VectorAllocator *allocator);
+
 	/** Construct from existing buffer data (buffer not managed) */
 	signalVector(complex *data, size_t start, size_t span);
 
 	/** Construct by from existing vector */
 	signalVector(const signalVector &vector);
 
+	/** Construct by taking the storage of an existing vector */
+	signalVector(signalVector &&vector);
+
 	/** Construct by from existing vector and append head-tail room */
 	signalVector(const signalVector &vector, size_t start, size_t tail = 0);
 
 	/** Override base assignment operator to include start offsets */
-	void operator=(const signalVector& vector);
+	signalVector &operator=(const signalVector& vector);
+
+	/** Take the storage, head room and properties of another vector */
+	signalVector &operator=(signalVector &&vector);
 
 	/** Return an alias to a segment of this signalVector. */
 	signalVector segment(size_t start, size_t span);
@@ -43,12 +52,11 @@ public:
 	bool isReal() const;
 	void isReal(bool real);
 
+	/** Return true if the samples are aligned for SIMD filter taps */
 	bool isAligned() const;
-	void setAligned(bool aligned);
 
 private:
 	bool real;
-	bool aligned;
 	Symmetry symmetry;
 };
 
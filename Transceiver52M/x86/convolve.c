@@ -49,6 +49,14 @@ struct convolve_cpu_context {
 			     int, int, int, int, int);
 	void (*conv_real) (const float *, int, const float *, int, float *, int,
 			   int, int, int, int);
+	void (*conv_decim_real4n) (const float *, int, const float *, int,
+				   float *, int, int, int, int);
+	void (*conv_decim_real) (const float *, int, const float *, int,
+				 float *, int, int, int, int);
+	void (*conv_real_lanes2n) (const float *, int, const float *, int,
+				   float *, int, int);
+	void (*conv_real_lanes) (const float *, int, const float *, int,
+				 float *, int, int);
 };
 static struct convolve_cpu_context c;
 
@@ -65,9 +73,23 @@ int _base_convolve_complex(const float *x, int x_len,
 			   int start, int len,
 			   int step, int offset);
 
+int _base_convolve_decim_real(const float *x, int x_len,
+			      const float *h, int h_len,
+			      float *y, int y_len,
+			      int start, int len, int decim);
+
+int _base_convolve_real_lanes(const float *x, int x_len,
+			      const float *h, int h_len,
+			      float *y, int len, int lanes);
+
 int bounds_check(int x_len, int h_len, int y_len,
 		 int start, int len, int step);
 
+int decim_bounds_check(int x_len, int h_len, int y_len,
+		       int start, int len, int decim);
+
+int lanes_bounds_check(int x_len, int h_len, int len, int lanes);
+
 /* API: Initalize convolve module */
 void convolve_init(void)
 {
@@ -81,6 +103,10 @@ void convolve_init(void)
 	c.conv_real20 = (void *)_base_convolve_real;
 	c.conv_real4n = (void *)_base_convolve_real;
 	c.conv_real = (void *)_base_convolve_real;
+	c.conv_decim_real4n = (void *)_base_convolve_decim_real;
+	c.conv_decim_real = (void *)_base_convolve_decim_real;
+	c.conv_real_lanes2n = (void *)_base_convolve_real_lanes;
+	c.conv_real_lanes = (void *)_base_convolve_real_lanes;
 
 #if defined(HAVE_SSE3) && defined(HAVE___BUILTIN_CPU_SUPPORTS)
 	if (__builtin_cpu_supports("sse3")) {
@@ -92,6 +118,8 @@ void convolve_init(void)
 		c.conv_real16 = sse_conv_real16;
 		c.conv_real20 = sse_conv_real20;
 		c.conv_real4n = sse_conv_real4n;
+		c.conv_decim_real4n = sse_conv_decim_real4n;
+		c.conv_real_lanes2n = sse_conv_real_lanes2n;
 	}
 #endif
 }
@@ -143,6 +171,45 @@ int convolve_real(const float *x, int x_len,
 	return len;
 }
 
+/* API: Aligned decimating complex-real */
+int convolve_decim_real(const float *x, int x_len,
+			const float *h, int h_len,
+			float *y, int y_len,
+			int start, int len, int decim)
+{
+	if (decim_bounds_check(x_len, h_len, y_len, start, len, decim) < 0)
+		return -1;
+
+	memset(y, 0, len * 2 * sizeof(float));
+
+	if (!(h_len % 4))
+		c.conv_decim_real4n(x, x_len, h, h_len, y, y_len,
+				    start, len, decim);
+	else
+		c.conv_decim_real(x, x_len, h, h_len, y, y_len,
+				  start, len, decim);
+
+	return len;
+}
+
+/* API: Complex-real across lanes with per lane taps */
+int convolve_real_lanes(const float *x, int x_len,
+			const float *h, int h_len,
+			float *y, int len, int lanes)
+{
+	if (lanes_bounds_check(x_len, h_len, len, lanes) < 0)
+		return -1;
+
+	memset(y, 0, len * lanes * 2 * sizeof(float));
+
+	if (!(lanes % 2))
+		c.conv_real_lanes2n(x, x_len, h, h_len, y, len, lanes);
+	else
+		c.conv_real_lanes(x, x_len, h, h_len, y, len, lanes);
+
+	return len;
+}
+
 /* API: Aligned complex-complex */
 int convolve_complex(const float *x, int x_len,
 		     const float *h, int h_len,
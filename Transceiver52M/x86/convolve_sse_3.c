@@ -404,6 +404,120 @@ void sse_conv_real4n(const float *x, int x_len,
 	}
 }
 
+/* 4*N-tap SSE complex-real decimating convolution */
+void sse_conv_decim_real4n(const float *x, int x_len,
+			   const float *h, int h_len,
+			   float *y, int y_len,
+			   int start, int len, int decim)
+{
+	/* NOTE: x_len and y_len are ignored, see decim_bounds_check() */
+
+	__m128 m0, m1, m2, m4, m5, m6, m7;
+
+	const float *_x = &x[2 * (-(h_len - 1) + start)];
+
+	for (int i = 0; i < len; i++) {
+		/* Zero */
+		m6 = _mm_setzero_ps();
+		m7 = _mm_setzero_ps();
+
+		for (int n = 0; n < h_len / 4; n++) {
+			/* Load (aligned) filter taps */
+			m0 = _mm_load_ps(&h[8 * n + 0]);
+			m1 = _mm_load_ps(&h[8 * n + 4]);
+			m2 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 2, 0, 2));
+
+			/* Load (unaligned) input data at the decimated offset */
+			m0 = _mm_loadu_ps(&_x[2 * decim * i + 8 * n + 0]);
+			m1 = _mm_loadu_ps(&_x[2 * decim * i + 8 * n + 4]);
+			m4 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 2, 0, 2));
+			m5 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 3, 1, 3));
+
+			/* Quad multiply */
+			m0 = _mm_mul_ps(m2, m4);
+			m1 = _mm_mul_ps(m2, m5);
+
+			/* Accumulate */
+			m6 = _mm_add_ps(m6, m0);
+			m7 = _mm_add_ps(m7, m1);
+		}
+
+		m0 = _mm_hadd_ps(m6, m7);
+		m0 = _mm_hadd_ps(m0, m0);
+
+		_mm_store_ss(&y[2 * i + 0], m0);
+		m0 = _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(0, 3, 2, 1));
+		_mm_store_ss(&y[2 * i + 1], m0);
+	}
+}
+
+/*
+ * SSE complex-real convolution across 2*N lanes with per lane taps. Rows
+ * are processed in groups of four registers while they last, so that four
+ * independent sums are in flight, and the remainder one register at a
+ * time. Buffers need not be aligned.
+ */
+void sse_conv_real_lanes2n(const float *x, int x_len,
+			   const float *h, int h_len,
+			   float *y, int len, int lanes)
+{
+	/* NOTE: x_len is ignored, see lanes_bounds_check() */
+
+	__m128 m0, m1, m2, m3, m4, m5, m6, m7;
+	int width = 2 * lanes;
+
+	for (int i = 0; i < len; i++) {
+		const float *_x = &x[i * width];
+		float *_y = &y[i * width];
+		int n = 0;
+
+		for (; n + 16 <= width; n += 16) {
+			/* Zero */
+			m4 = _mm_setzero_ps();
+			m5 = _mm_setzero_ps();
+			m6 = _mm_setzero_ps();
+			m7 = _mm_setzero_ps();
+
+			for (int k = 0; k < h_len; k++) {
+				const float *xk = &_x[k * width + n];
+				const float *hk = &h[k * width + n];
+
+				/* Multiply and accumulate */
+				m0 = _mm_mul_ps(_mm_loadu_ps(&xk[0]),
+						_mm_loadu_ps(&hk[0]));
+				m1 = _mm_mul_ps(_mm_loadu_ps(&xk[4]),
+						_mm_loadu_ps(&hk[4]));
+				m2 = _mm_mul_ps(_mm_loadu_ps(&xk[8]),
+						_mm_loadu_ps(&hk[8]));
+				m3 = _mm_mul_ps(_mm_loadu_ps(&xk[12]),
+						_mm_loadu_ps(&hk[12]));
+
+				m4 = _mm_add_ps(m4, m0);
+				m5 = _mm_add_ps(m5, m1);
+				m6 = _mm_add_ps(m6, m2);
+				m7 = _mm_add_ps(m7, m3);
+			}
+
+			_mm_storeu_ps(&_y[n + 0], m4);
+			_mm_storeu_ps(&_y[n + 4], m5);
+			_mm_storeu_ps(&_y[n + 8], m6);
+			_mm_storeu_ps(&_y[n + 12], m7);
+		}
+
+		for (; n < width; n += 4) {
+			m4 = _mm_setzero_ps();
+
+			for (int k = 0; k < h_len; k++) {
+				m0 = _mm_mul_ps(_mm_loadu_ps(&_x[k * width + n]),
+						_mm_loadu_ps(&h[k * width + n]));
+				m4 = _mm_add_ps(m4, m0);
+			}
+
+			_mm_storeu_ps(&_y[n], m4);
+		}
+	}
+}
+
 /* 4*N-tap SSE complex-complex convolution */
 void sse_conv_cmplx_4n(const float *x, int x_len,
 		       const float *h, int h_len,
@@ -55,6 +55,17 @@ void sse_conv_real4n(const float *x, int x_len,
 		     float *y, int y_len,
 		     int start, int len, int step, int offset);
 
+/* 4*N-tap SSE complex-real decimating convolution */
+void sse_conv_decim_real4n(const float *x, int x_len,
+			   const float *h, int h_len,
+			   float *y, int y_len,
+			   int start, int len, int decim);
+
+/* SSE complex-real convolution across 2*N lanes with per lane taps */
+void sse_conv_real_lanes2n(const float *x, int x_len,
+			   const float *h, int h_len,
+			   float *y, int len, int lanes);
+
 /* 4*N-tap SSE complex-complex convolution */
 void sse_conv_cmplx_4n(const float *x, int x_len,
 		       const float *h, int h_len,